@@ -0,0 +1,27 @@
+// Timing and reporting helpers shared by the benchmarks
+
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * Monotonic wall clock time in seconds.
+ */
+double bench_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * Print the throughput of operations done in seconds.
+ */
+void bench_report(const char* name, size_t operations, double seconds) {
+    printf("%-16s %12zu ops %8.3f s %8.2f Mops/s\n", name, operations, seconds, operations / seconds / 1e6);
+}
+
+/**
+ * Print the time per item of a traversal over items in seconds.
+ */
+void bench_report_per_item(const char* name, size_t items, double seconds) {
+    printf("  %-28s %8.2f ns/item\n", name, seconds * 1e9 / items);
+}
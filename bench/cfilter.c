@@ -0,0 +1,64 @@
+// Insert, lookup and delete throughput of cfilter_t, run with `make bench` or bin/bench/cfilter [keys]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/bench.h"
+
+#define IMPL_HMAP
+#include "src/hmap.h"
+
+#define IMPL_CFILTER
+#include "src/cfilter.h"
+
+size_t bench_hash(void* ptr) {
+    return *(size_t*)ptr;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+
+    cfilter_t f;
+    cfilter_init(&f, bench_hash, n);
+    printf("cfilter: %zu keys, %zu slots, %.1f MiB\n", n, cfilter_capacity(&f),
+           cfilter_capacity(&f) * sizeof(uint16_t) / 1048576.);
+
+    // keys are scattered by hmap_hash_mix inside the filter, sequential keys are as good as random ones
+    double start = bench_seconds();
+    size_t added = 0;
+    for (size_t i = 0; i < n; i++) {
+        added += cfilter_add(&f, &i);
+    }
+    bench_report("add", n, bench_seconds() - start);
+    if (added != n) {
+        printf("filter full after %zu keys\n", added);
+    }
+
+    start = bench_seconds();
+    size_t hits = 0;
+    for (size_t i = 0; i < n; i++) {
+        hits += cfilter_has(&f, &i);
+    }
+    bench_report("has (present)", n, bench_seconds() - start);
+
+    start = bench_seconds();
+    size_t false_positives = 0;
+    for (size_t i = n; i < 2 * n; i++) {
+        false_positives += cfilter_has(&f, &i);
+    }
+    bench_report("has (missing)", n, bench_seconds() - start);
+
+    start = bench_seconds();
+    size_t deleted = 0;
+    for (size_t i = 0; i < added; i++) {
+        deleted += cfilter_delete(&f, &i);
+    }
+    bench_report("delete", added, bench_seconds() - start);
+
+    printf("load %.3f, hits %zu, deleted %zu, false positive rate %.2e (estimated %.2e)\n",
+           added / (float)cfilter_capacity(&f), hits, deleted, false_positives / (double)n,
+           added * 2. * CFILTER_BUCKET_SLOTS / cfilter_capacity(&f) / 65535.);
+
+    cfilter_destroy(&f);
+    return 0;
+}
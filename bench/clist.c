@@ -0,0 +1,89 @@
+// Push, shift and unlink throughput of clist_t compared to list_t, run with `make bench` or bin/bench/clist [items]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/bench.h"
+
+#define IMPL_LIST
+#include "src/list.h"
+
+#define IMPL_CLIST
+#include "src/clist.h"
+
+typedef struct {
+    size_t value;
+    LISTITEM_PROP();
+    CLISTITEM_PROP();
+} event_t;
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000;
+    size_t rounds = 100000000 / n;
+
+    event_t* events = calloc(n, sizeof(event_t));
+    size_t* order = malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        events[i].value = i;
+        order[i] = i;
+    }
+    // unlink in a random order, the branches of list_t depend on the position of the item
+    srand(1);
+    for (size_t i = n - 1; i > 0; i--) {
+        size_t j = rand() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    printf("clist: %zu items, %zu rounds\n", n, rounds);
+
+    size_t sum = 0;
+    list_t l;
+    list_init(&l);
+    for (size_t i = 0; i < n; i++) {
+        listitem_init(LISTITEM_OF(event_t, &events[i]));
+    }
+
+    double start = bench_seconds();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            list_push(&l, LISTITEM_OF(event_t, &events[i]));
+        }
+        for (size_t i = 0; i < n / 2; i++) {
+            sum += LIST_SHIFT(event_t, &l)->value;
+        }
+        for (size_t i = 0; i < n; i++) {
+            listitem_t* item = LISTITEM_OF(event_t, &events[order[i]]);
+            if (listitem_in_list(item)) {
+                listitem_unlink(item);
+            }
+        }
+    }
+    bench_report("list_t", rounds * n * 2, bench_seconds() - start);
+
+    clist_t c;
+    clist_init(&c);
+    for (size_t i = 0; i < n; i++) {
+        clistitem_init(CLISTITEM_OF(event_t, &events[i]));
+    }
+
+    start = bench_seconds();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < n; i++) {
+            clist_push(&c, CLISTITEM_OF(event_t, &events[i]));
+        }
+        for (size_t i = 0; i < n / 2; i++) {
+            sum += CLISTITEM_AS(event_t, clist_shift(&c))->value;
+        }
+        // unlinking an unlinked item is a no-op, no check needed
+        for (size_t i = 0; i < n; i++) {
+            clistitem_unlink(CLISTITEM_OF(event_t, &events[order[i]]));
+        }
+    }
+    bench_report("clist_t", rounds * n * 2, bench_seconds() - start);
+
+    printf("checksum %zu\n", sum);
+    free(order);
+    free(events);
+    return 0;
+}
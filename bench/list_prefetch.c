@@ -0,0 +1,101 @@
+// Traversal throughput of LIST_ITER compared to LIST_ITER_PREFETCH(_DATA) and list_foreach_prefetch for lists whose
+// items are scattered in memory, run with `make bench` or bin/bench/list_prefetch [max items]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench/bench.h"
+
+#define IMPL_LIST
+#include "src/list.h"
+
+// the payload is on another cache line than the list item
+typedef struct {
+    LISTITEM_PROP();
+    char padding[64];
+    uint64_t value;
+} node_t;
+
+// some work per item which the prefetches can overlap with the misses of the items ahead
+uint64_t bench_work(uint64_t value) {
+    for (int r = 0; r < 16; r++) {
+        value = value * 0x9E3779B97F4A7C15ull + (value >> 29);
+    }
+    return value;
+}
+
+void bench_sum(listitem_t* i, void* userdata) {
+    *(uint64_t*)userdata += bench_work(LISTITEM_AS(node_t, i)->value);
+}
+
+int main(int argc, char** argv) {
+    size_t max = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    uint64_t checksum = 0;
+
+    for (size_t n = 1000; n <= max; n *= 10) {
+        node_t* nodes = malloc(n * sizeof(node_t));
+        size_t* order = malloc(n * sizeof(size_t));
+        for (size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        // link the nodes in a random order so the hardware prefetcher can not follow
+        srand(1);
+        for (size_t i = n - 1; i > 0; i--) {
+            size_t j = ((size_t)rand() * RAND_MAX + rand()) % (i + 1);
+            size_t tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+
+        list_t l;
+        list_init(&l);
+        for (size_t i = 0; i < n; i++) {
+            node_t* node = &nodes[order[i]];
+            listitem_init(LISTITEM_OF(node_t, node));
+            node->value = i;
+            list_push(&l, LISTITEM_OF(node_t, node));
+        }
+
+        size_t rounds = max / n;
+        printf("list_prefetch: %zu items, %zu rounds\n", n, rounds);
+
+        double start = bench_seconds();
+        for (size_t r = 0; r < rounds; r++) {
+            LIST_ITER(elem, l.first) { checksum += bench_work(LISTITEM_AS(node_t, elem)->value); }
+        }
+        bench_report_per_item("LIST_ITER", n * rounds, bench_seconds() - start);
+
+        start = bench_seconds();
+        for (size_t r = 0; r < rounds; r++) {
+            LIST_ITER_PREFETCH(elem, l.first) { checksum += bench_work(LISTITEM_AS(node_t, elem)->value); }
+        }
+        bench_report_per_item("LIST_ITER_PREFETCH", n * rounds, bench_seconds() - start);
+
+        start = bench_seconds();
+        for (size_t r = 0; r < rounds; r++) {
+            LIST_ITER_PREFETCH_DATA(elem, l.first, LISTITEM_OFFSET(node_t)) {
+                checksum += bench_work(LISTITEM_AS(node_t, elem)->value);
+            }
+        }
+        bench_report_per_item("LIST_ITER_PREFETCH_DATA", n * rounds, bench_seconds() - start);
+
+        start = bench_seconds();
+        for (size_t r = 0; r < rounds; r++) {
+            list_foreach(&l, bench_sum, &checksum);
+        }
+        bench_report_per_item("list_foreach", n * rounds, bench_seconds() - start);
+
+        start = bench_seconds();
+        for (size_t r = 0; r < rounds; r++) {
+            list_foreach_prefetch(&l, bench_sum, &checksum, LISTITEM_OFFSET(node_t));
+        }
+        bench_report_per_item("list_foreach_prefetch", n * rounds, bench_seconds() - start);
+
+        free(order);
+        free(nodes);
+    }
+
+    printf("checksum %lu\n", (unsigned long)checksum);
+    return 0;
+}
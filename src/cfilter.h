@@ -0,0 +1,348 @@
+/*
+
+# Cuckoo Filter
+
+An approximate membership filter which supports deletes. Instead of the keys the filter stores a 16 bit fingerprint of
+every key in one of two candidate buckets of CFILTER_BUCKET_SLOTS fingerprints, which takes about 2.1 bytes per key at
+the default load of CFILTER_MAX_LOAD. Lookups of added keys are always true, lookups of other keys are true with a
+probability of roughly 8 * load / 2^16 (about 1 in 8600 for a full filter), see cfilter_stats_false_positive_rate.
+A hit should therefore be confirmed against the authoritative hmap_t or storage, a miss never has to be.
+
+The filter uses the hash functions of hmap.h, the fingerprint and both buckets are derived from hmap_hash_mix of the
+hash value. Use a hash function which produces 64 bit values for large filters, two keys with the same hash value are
+indistinguishable to the filter.
+
+The capacity is fixed at initialization since the keys are not kept and the filter can not be rebuilt. cfilter_add
+returns false once the filter is full. Adding a key twice stores two fingerprints and needs two deletes. Only delete
+keys which were added, deleting a key which was not added may remove the fingerprint of another key.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_CFILTER` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_CFILTER
+#include "cfilter.h"
+```
+
+After that include cfilter.h like a normal header everywhere the declarations are needed
+```
+#include "cfilter.h"
+```
+
+### Basic Usage
+
+```
+cfilter_t seen;
+cfilter_init(&seen, hmap_hash_str, 1000000);
+
+cfilter_add(&seen, "alex");
+
+if (cfilter_has(&seen, name) && hmap_has(&people, name)) {
+    ...
+}
+
+cfilter_delete(&seen, "alex");
+cfilter_destroy(&seen);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_CFILTER_H
+#define DS_CFILTER_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hmap.h"
+
+/**
+ * The number of fingerprints per bucket.
+ */
+#define CFILTER_BUCKET_SLOTS 4
+
+/**
+ * The load factor the buckets are sized for, higher loads make cfilter_add fail more often before the filter is full.
+ */
+#define CFILTER_MAX_LOAD 0.95f
+
+/**
+ * The maximum number of fingerprints cfilter_add moves to their alternative bucket before it gives up.
+ */
+#define CFILTER_MAX_KICKS 500
+
+typedef struct cfilter_s {
+    size_t length;
+    size_t buckets_length;  // always a power of two
+    uint16_t* fingerprints;  // CFILTER_BUCKET_SLOTS per bucket, 0 marks an empty slot
+    bool victim_used;  // the fingerprint which could not be placed by the last failed kick sequence
+    uint16_t victim_fingerprint;
+    size_t victim_bucket;
+    uint64_t random;
+    HMAP_HASH_TYPE(hash);
+} cfilter_t;
+
+/**
+ * Initialize a filter with room for at least capacity keys.
+ */
+void cfilter_init(cfilter_t* f, HMAP_HASH_TYPE(hash), size_t capacity);
+
+/**
+ * Free all resources allocated by a call to cfilter_init.
+ */
+void cfilter_destroy(cfilter_t* f);
+
+/**
+ * Return the number of fingerprints in the filter.
+ */
+size_t cfilter_length(cfilter_t* f);
+
+/**
+ * Return the number of fingerprint slots of the filter.
+ */
+size_t cfilter_capacity(cfilter_t* f);
+
+/**
+ * Calculate the load factor (length/capacity = [0, 1]) of the filter.
+ */
+float cfilter_stats_load_factor(cfilter_t* f);
+
+/**
+ * Estimate the probability that cfilter_has returns true for a key which was not added.
+ */
+float cfilter_stats_false_positive_rate(cfilter_t* f);
+
+/**
+ * Add the key to the filter. Return false if the filter is full, the key is not added in this case.
+ */
+bool cfilter_add(cfilter_t* f, void* key);
+
+/**
+ * Return true if the key might have been added, false if it was not.
+ */
+bool cfilter_has(cfilter_t* f, void* key);
+
+/**
+ * Remove one fingerprint of the key from the filter. Return false if the filter did not contain the key.
+ */
+bool cfilter_delete(cfilter_t* f, void* key);
+
+#if defined(IMPL_CFILTER) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * internal use only: return the fingerprint of a mixed hash value, never 0.
+ */
+uint16_t cfilter_internal_fingerprint(size_t mixed) {
+    uint16_t fingerprint = (uint16_t)(mixed >> 48);
+    return fingerprint == 0 ? 1 : fingerprint;
+}
+
+/**
+ * internal use only: return the other candidate bucket of a fingerprint. Applying it twice yields the given bucket.
+ */
+size_t cfilter_internal_alternative(cfilter_t* f, size_t bucket, uint16_t fingerprint) {
+    return (bucket ^ hmap_hash_mix(fingerprint)) & (f->buckets_length - 1);
+}
+
+/**
+ * internal use only: store the fingerprint in a free slot of the bucket. Return false if the bucket is full.
+ */
+bool cfilter_internal_insert(cfilter_t* f, size_t bucket, uint16_t fingerprint) {
+    uint16_t* slots = &f->fingerprints[bucket * CFILTER_BUCKET_SLOTS];
+    for (size_t s = 0; s < CFILTER_BUCKET_SLOTS; s++) {
+        if (slots[s] == 0) {
+            slots[s] = fingerprint;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * internal use only: return true if the bucket contains the fingerprint.
+ */
+bool cfilter_internal_contains(cfilter_t* f, size_t bucket, uint16_t fingerprint) {
+    uint16_t* slots = &f->fingerprints[bucket * CFILTER_BUCKET_SLOTS];
+    bool found = false;
+    for (size_t s = 0; s < CFILTER_BUCKET_SLOTS; s++) {
+        found |= slots[s] == fingerprint;
+    }
+    return found;
+}
+
+/**
+ * internal use only: remove one copy of the fingerprint from the bucket. Return false if there was none.
+ */
+bool cfilter_internal_remove(cfilter_t* f, size_t bucket, uint16_t fingerprint) {
+    uint16_t* slots = &f->fingerprints[bucket * CFILTER_BUCKET_SLOTS];
+    for (size_t s = 0; s < CFILTER_BUCKET_SLOTS; s++) {
+        if (slots[s] == fingerprint) {
+            slots[s] = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * internal use only: place a fingerprint in the bucket or its alternative, kicking other fingerprints to their
+ * alternative bucket if both are full. The fingerprint left over after CFILTER_MAX_KICKS moves becomes the victim.
+ */
+void cfilter_internal_place(cfilter_t* f, size_t bucket, uint16_t fingerprint) {
+    if (cfilter_internal_insert(f, bucket, fingerprint)) {
+        return;
+    }
+    bucket = cfilter_internal_alternative(f, bucket, fingerprint);
+    if (cfilter_internal_insert(f, bucket, fingerprint)) {
+        return;
+    }
+
+    for (size_t kick = 0; kick < CFILTER_MAX_KICKS; kick++) {
+        // xorshift, a random slot avoids cycling between the same fingerprints
+        f->random ^= f->random << 13;
+        f->random ^= f->random >> 7;
+        f->random ^= f->random << 17;
+
+        uint16_t* slot = &f->fingerprints[bucket * CFILTER_BUCKET_SLOTS + f->random % CFILTER_BUCKET_SLOTS];
+        uint16_t kicked = *slot;
+        *slot = fingerprint;
+        fingerprint = kicked;
+
+        bucket = cfilter_internal_alternative(f, bucket, fingerprint);
+        if (cfilter_internal_insert(f, bucket, fingerprint)) {
+            return;
+        }
+    }
+
+    f->victim_used = true;
+    f->victim_fingerprint = fingerprint;
+    f->victim_bucket = bucket;
+}
+
+void cfilter_init(cfilter_t* f, HMAP_HASH_TYPE(hash), size_t capacity) {
+    assert(f != NULL);
+    assert(hash != NULL);
+
+    memset(f, 0, sizeof(cfilter_t));
+    f->buckets_length = 1;
+    while (f->buckets_length * CFILTER_BUCKET_SLOTS * CFILTER_MAX_LOAD < capacity) {
+        f->buckets_length *= 2;
+    }
+
+    size_t size = f->buckets_length * CFILTER_BUCKET_SLOTS * sizeof(uint16_t);
+    size = (size + HMAP_CACHE_LINE_SIZE - 1) / HMAP_CACHE_LINE_SIZE * HMAP_CACHE_LINE_SIZE;
+    f->fingerprints = aligned_alloc(HMAP_CACHE_LINE_SIZE, size);
+    assert(f->fingerprints != NULL);
+    memset(f->fingerprints, 0, size);
+
+    f->random = 0x9E3779B97F4A7C15ull;
+    f->hash = hash;
+}
+
+void cfilter_destroy(cfilter_t* f) {
+    assert(f != NULL);
+    free(f->fingerprints);
+    memset(f, 0, sizeof(cfilter_t));
+}
+
+size_t cfilter_length(cfilter_t* f) {
+    assert(f != NULL);
+    return f->length;
+}
+
+size_t cfilter_capacity(cfilter_t* f) {
+    assert(f != NULL);
+    return f->buckets_length * CFILTER_BUCKET_SLOTS;
+}
+
+float cfilter_stats_load_factor(cfilter_t* f) {
+    assert(f != NULL);
+    return f->length / (float)cfilter_capacity(f);
+}
+
+float cfilter_stats_false_positive_rate(cfilter_t* f) {
+    assert(f != NULL);
+
+    // a lookup compares against the occupied slots of two buckets, each matches with probability 1 / (2^16 - 1)
+    float compared = 2 * CFILTER_BUCKET_SLOTS * cfilter_stats_load_factor(f);
+    return compared / 65535.f;
+}
+
+bool cfilter_add(cfilter_t* f, void* key) {
+    assert(f != NULL);
+
+    if (f->victim_used) {
+        return false;
+    }
+
+    size_t mixed = hmap_hash_mix(f->hash(key));
+    cfilter_internal_place(f, mixed & (f->buckets_length - 1), cfilter_internal_fingerprint(mixed));
+    f->length++;
+    return true;
+}
+
+bool cfilter_has(cfilter_t* f, void* key) {
+    assert(f != NULL);
+
+    size_t mixed = hmap_hash_mix(f->hash(key));
+    uint16_t fingerprint = cfilter_internal_fingerprint(mixed);
+    size_t first = mixed & (f->buckets_length - 1);
+    size_t second = cfilter_internal_alternative(f, first, fingerprint);
+
+    bool victim = f->victim_used && f->victim_fingerprint == fingerprint &&
+                  (f->victim_bucket == first || f->victim_bucket == second);
+    return victim || cfilter_internal_contains(f, first, fingerprint) ||
+           cfilter_internal_contains(f, second, fingerprint);
+}
+
+bool cfilter_delete(cfilter_t* f, void* key) {
+    assert(f != NULL);
+
+    size_t mixed = hmap_hash_mix(f->hash(key));
+    uint16_t fingerprint = cfilter_internal_fingerprint(mixed);
+    size_t first = mixed & (f->buckets_length - 1);
+    size_t second = cfilter_internal_alternative(f, first, fingerprint);
+
+    if (f->victim_used && f->victim_fingerprint == fingerprint &&
+        (f->victim_bucket == first || f->victim_bucket == second)) {
+        f->victim_used = false;
+        f->length--;
+        return true;
+    }
+
+    if (!cfilter_internal_remove(f, first, fingerprint) && !cfilter_internal_remove(f, second, fingerprint)) {
+        return false;
+    }
+    f->length--;
+
+    // the freed slot may make room for the victim
+    if (f->victim_used) {
+        f->victim_used = false;
+        cfilter_internal_place(f, f->victim_bucket, f->victim_fingerprint);
+    }
+    return true;
+}
+
+#endif
+#endif
@@ -0,0 +1,331 @@
+/*
+
+# Circular List
+
+A circular doubly linked list with a sentinel head, like the list_head of the Linux kernel. The head is an item which
+is always linked, an empty list is a head pointing to itself. Every item therefore always has a prev and a next item,
+linking and unlinking are four stores without any branches on empty lists, single items or list ends.
+
+Compared to list.h the items do not know their list and the length is not stored, clist_length walks the list. The
+sentinel points to itself, so a clist_t must not be copied or moved after clist_init.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting IMPL_CLIST before. Do this only once e.g. in main.c
+
+```
+#define IMPL_CLIST
+#include "clist.h"
+```
+
+After that include clist.h like a normal header everywhere the declarations are needed
+```
+#include "clist.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    int fd;
+    CLISTITEM_PROP();
+} event;
+
+clist_t queue;
+clist_init(&queue);
+
+event e = {0};
+clistitem_init(CLISTITEM_OF(event, &e));
+clist_push(&queue, CLISTITEM_OF(event, &e));
+
+CLIST_ITER(elem, &queue) {
+    event* ev = CLISTITEM_AS(event, elem);
+    ...
+}
+
+clistitem_unlink(CLISTITEM_OF(event, &e));
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_CLIST_H
+#define DS_CLIST_H
+#include <stddef.h>
+
+// Remove an item from the end of the list and return a pointer to the struct holding the item.
+#define CLIST_POP_s(type, list, property_name) \
+    (!clist_is_empty(list) ? CLISTITEM_AS_s(type, clist_pop(list), property_name) : NULL)
+
+// Remove an item from the end of the list and return a pointer to the struct holding the item using the default item
+// property name.
+#define CLIST_POP(type, list) CLIST_POP_s(type, list, default_clist_item_name)
+
+// Remove an item from the beginning of the list and return a pointer to the struct holding the item.
+#define CLIST_SHIFT_s(type, list, property_name) \
+    (!clist_is_empty(list) ? CLISTITEM_AS_s(type, clist_shift(list), property_name) : NULL)
+
+// Remove an item from the beginning of the list and return a pointer to the struct holding the item using the default
+// item property name.
+#define CLIST_SHIFT(type, list) CLIST_SHIFT_s(type, list, default_clist_item_name)
+
+/**
+ * Inject a clistitem_t property with a given name into a struct.
+ */
+#define CLISTITEM_PROP_s(item_name) clistitem_t item_name
+
+/**
+ * Inject a clistitem_t struct with the default property name into a struct.
+ */
+#define CLISTITEM_PROP() CLISTITEM_PROP_s(default_clist_item_name)
+
+/**
+ * Convert a type + pointer + property name to a list item.
+ */
+#define CLISTITEM_OF_s(type, data_ptr, item_name) (clistitem_t*)(((char*)data_ptr) + offsetof(type, item_name))
+
+/**
+ * Convert a type + pointer to a list item using the default property name.
+ */
+#define CLISTITEM_OF(type, data_ptr) CLISTITEM_OF_s(type, data_ptr, default_clist_item_name)
+
+/**
+ * Convert a clistitem_t to a pointer to its holding struct using the offset of the given property's name.
+ */
+#define CLISTITEM_AS_s(type, ptr, property_name) ((type*)(((char*)ptr) - ((char*)offsetof(type, property_name))))
+
+/**
+ * Convert a clistitem_t to a pointer to its holding struct using the offset of the default property name.
+ */
+#define CLISTITEM_AS(type, ptr) CLISTITEM_AS_s(type, ptr, default_clist_item_name)
+
+/**
+ * Iterate over the items of a list. The current item must not be unlinked inside the loop.
+ */
+#define CLIST_ITER(iter_name, list) \
+    for (clistitem_t* iter_name = (list)->head.next; iter_name != &(list)->head; iter_name = iter_name->next)
+
+/**
+ * Iterate in reverse order over the items of a list. The current item must not be unlinked inside the loop.
+ */
+#define CLIST_ITER_REVERSE(iter_name, list) \
+    for (clistitem_t* iter_name = (list)->head.prev; iter_name != &(list)->head; iter_name = iter_name->prev)
+
+typedef struct clistitem_s {
+    struct clistitem_s* prev;
+    struct clistitem_s* next;
+} clistitem_t;
+
+typedef struct {
+    clistitem_t head;  // the sentinel, head.next is the first and head.prev the last item
+} clist_t;
+
+/**
+ * Initialize a list.
+ */
+void clist_init(clist_t* l);
+
+/**
+ * Check if the list has no items.
+ */
+bool clist_is_empty(clist_t* l);
+
+/**
+ * Return the number of items in the list. Runtime O(n).
+ */
+size_t clist_length(clist_t* l);
+
+/**
+ * Return the first item of the list or NULL if the list is empty.
+ */
+clistitem_t* clist_first(clist_t* l);
+
+/**
+ * Return the last item of the list or NULL if the list is empty.
+ */
+clistitem_t* clist_last(clist_t* l);
+
+/**
+ * Add an item to the end of the list.
+ */
+void clist_push(clist_t* l, clistitem_t* i);
+
+/**
+ * Remove an item from the end of the list and return it or NULL if the list is empty.
+ */
+clistitem_t* clist_pop(clist_t* l);
+
+/**
+ * Add an item to the beginning of the list.
+ */
+void clist_unshift(clist_t* l, clistitem_t* i);
+
+/**
+ * Remove an item from the beginning of the list and return it or NULL if the list is empty.
+ */
+clistitem_t* clist_shift(clist_t* l);
+
+/**
+ * Insert the item i in front of the item pos.
+ */
+void clist_insert_before(clistitem_t* pos, clistitem_t* i);
+
+/**
+ * Insert the item i after the item pos.
+ */
+void clist_insert_after(clistitem_t* pos, clistitem_t* i);
+
+/**
+ * Initialize a list item, an initialized item is linked to itself.
+ */
+void clistitem_init(clistitem_t* i);
+
+/**
+ * Remove the item from the list it currently is contained in, the item is linked to itself afterwards.
+ */
+void clistitem_unlink(clistitem_t* i);
+
+/**
+ * Check if the item is currently in a list.
+ */
+bool clistitem_in_list(clistitem_t* i);
+
+#if defined(IMPL_CLIST) || defined(_CLANGD)
+#include <assert.h>
+
+/**
+ * internal use only: link i between the adjacent items prev and next.
+ */
+void clist_internal_link(clistitem_t* prev, clistitem_t* next, clistitem_t* i) {
+    i->prev = prev;
+    i->next = next;
+    prev->next = i;
+    next->prev = i;
+}
+
+/**
+ * internal use only: unlink i from its neighbours and link it to itself, unlinking the head of an empty list is a no-op.
+ */
+void clist_internal_unlink(clistitem_t* i) {
+    i->prev->next = i->next;
+    i->next->prev = i->prev;
+    i->prev = i;
+    i->next = i;
+}
+
+void clist_init(clist_t* l) {
+    assert(l != NULL);
+
+    clistitem_init(&l->head);
+}
+
+bool clist_is_empty(clist_t* l) {
+    assert(l != NULL);
+
+    return l->head.next == &l->head;
+}
+
+size_t clist_length(clist_t* l) {
+    assert(l != NULL);
+
+    size_t length = 0;
+    CLIST_ITER(elem, l) { length++; }
+    return length;
+}
+
+clistitem_t* clist_first(clist_t* l) {
+    assert(l != NULL);
+
+    return clist_is_empty(l) ? NULL : l->head.next;
+}
+
+clistitem_t* clist_last(clist_t* l) {
+    assert(l != NULL);
+
+    return clist_is_empty(l) ? NULL : l->head.prev;
+}
+
+void clist_push(clist_t* l, clistitem_t* i) {
+    assert(l != NULL);
+    assert(i != NULL);
+    assert(!clistitem_in_list(i));
+
+    clist_internal_link(l->head.prev, &l->head, i);
+}
+
+clistitem_t* clist_pop(clist_t* l) {
+    assert(l != NULL);
+
+    clistitem_t* i = l->head.prev;
+    clist_internal_unlink(i);
+    return i != &l->head ? i : NULL;
+}
+
+void clist_unshift(clist_t* l, clistitem_t* i) {
+    assert(l != NULL);
+    assert(i != NULL);
+    assert(!clistitem_in_list(i));
+
+    clist_internal_link(&l->head, l->head.next, i);
+}
+
+clistitem_t* clist_shift(clist_t* l) {
+    assert(l != NULL);
+
+    clistitem_t* i = l->head.next;
+    clist_internal_unlink(i);
+    return i != &l->head ? i : NULL;
+}
+
+void clist_insert_before(clistitem_t* pos, clistitem_t* i) {
+    assert(pos != NULL);
+    assert(i != NULL);
+    assert(!clistitem_in_list(i));
+
+    clist_internal_link(pos->prev, pos, i);
+}
+
+void clist_insert_after(clistitem_t* pos, clistitem_t* i) {
+    assert(pos != NULL);
+    assert(i != NULL);
+    assert(!clistitem_in_list(i));
+
+    clist_internal_link(pos, pos->next, i);
+}
+
+void clistitem_init(clistitem_t* i) {
+    assert(i != NULL);
+
+    i->prev = i;
+    i->next = i;
+}
+
+void clistitem_unlink(clistitem_t* i) {
+    assert(i != NULL);
+
+    clist_internal_unlink(i);
+}
+
+bool clistitem_in_list(clistitem_t* i) {
+    assert(i != NULL);
+
+    return i->next != i;
+}
+
+#endif
+#endif
@@ -18,6 +18,8 @@ After that include hmap.h like a normal header everywhere the declarations are n
 ```
 #include "hmap.h"
 ```
+
+The parallel functions (hmap_*_parallel) use C11 threads, link with `-pthread` if your libc needs it.
 ### Basic Usage
 
 ```
@@ -77,6 +79,7 @@ You should have received a copy of the GNU Affero General Public License along w
 #ifndef DS_MAP_H
 #define DS_MAP_H
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -85,6 +88,21 @@ You should have received a copy of the GNU Affero General Public License along w
  */
 #define HMAP_INITIAL_CAPACITY 32
 
+/**
+ * The cache line size in bytes used to align the slot ranges of the parallel functions.
+ */
+#define HMAP_CACHE_LINE_SIZE 64
+
+/**
+ * The number of Bloom filter bits per slot of maps with an enabled filter, see hmap_filter.
+ */
+#define HMAP_FILTER_BITS_PER_SLOT 16
+
+/**
+ * The number of bits a key sets in its Bloom filter word.
+ */
+#define HMAP_FILTER_HASHES 4
+
 /**
  * The name of the default property name.
  */
@@ -142,6 +160,37 @@ You should have received a copy of the GNU Affero General Public License along w
  */
 #define HMAPITEM_AS_s(type, ptr, property_name) ((type*)(((char*)ptr) - ((char*)offsetof(type, property_name))))
 
+/**
+ * Inject a hmapmultiitem_t property with the default property name into a struct.
+ */
+#define HMAPMULTIITEM_PROP() HMAPMULTIITEM_PROP_s(HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Inject a hmapmultiitem_t property with a given name into a struct.
+ */
+#define HMAPMULTIITEM_PROP_s(property_name) hmapmultiitem_t property_name
+
+/**
+ * Convert a type + pointer to a hmapmultiitem_t* using the default item property name.
+ */
+#define HMAPMULTIITEM_OF(type, ptr) HMAPMULTIITEM_OF_s(type, ptr, HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Convert a type + pointer + property name to a hmapmultiitem_t*.
+ */
+#define HMAPMULTIITEM_OF_s(type, ptr, property_name) \
+    (hmapmultiitem_t*)(((char*)ptr) + offsetof(type, property_name))
+
+/**
+ * Convert a hmapmultiitem_t to a pointer to its holding struct using the offset of the default property name.
+ */
+#define HMAPMULTIITEM_AS(type, ptr) HMAPITEM_AS_s(type, ptr, HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Convert a hmapmultiitem_t to a pointer to its holding struct using the offset of the given property's name.
+ */
+#define HMAPMULTIITEM_AS_s(type, ptr, property_name) HMAPITEM_AS_s(type, ptr, property_name)
+
 /**
  * internal use only: function parameter type generator for the hash function
  */
@@ -152,11 +201,27 @@ You should have received a copy of the GNU Affero General Public License along w
  */
 #define HMAP_EQUALS_TYPE(name) bool (*name)(void* a, void* b)
 
+/**
+ * internal use only: function parameter type generator for the slot array allocation function, which has to return
+ * size bytes of zeroed memory
+ */
+#define HMAP_ALLOC_TYPE(name) void* (*name)(size_t size, void* userdata)
+
+/**
+ * internal use only: function parameter type generator for the slot array release function
+ */
+#define HMAP_RELEASE_TYPE(name) void (*name)(void* ptr, size_t size, void* userdata)
+
 typedef struct hmapitem_s {
     void* map_ptr;
     void* key;
 } hmapitem_t;
 
+typedef struct hmapmultiitem_s {
+    hmapitem_t item;
+    struct hmapmultiitem_s* next;
+} hmapmultiitem_t;
+
 typedef struct hmapstat_s {
     void* map_ptr;
     void* key;
@@ -173,6 +238,12 @@ typedef struct hmap_s {
     hmapitem_t** data;
     HMAP_HASH_TYPE(hash);
     HMAP_EQUALS_TYPE(equals);
+    HMAP_ALLOC_TYPE(alloc);
+    HMAP_RELEASE_TYPE(release);
+    void* allocator_userdata;
+    uint64_t* filter;  // NULL if the Bloom filter is disabled
+    size_t filter_words;
+    size_t filter_deletes;  // deletes since the filter was built
 } hmap_t;
 
 /**
@@ -180,6 +251,12 @@ typedef struct hmap_s {
  */
 #define HMAP_ITER(entry, map) for (hmapitem_t** entry = (map)->data; entry < ((map)->data + (map)->capacity); entry++)
 
+/**
+ * Iterate over all items associated with key in a multimap.
+ */
+#define HMAP_MULTI_ITER(entry, map, key) \
+    for (hmapmultiitem_t* entry = hmap_multi_get(map, key); entry != NULL; entry = entry->next)
+
 /**
  * Convert a key value entry coming from an iterator to a key.
  */
@@ -231,6 +308,21 @@ int hmap_manage(hmap_t* m);
  */
 void hmap_adjust_capacity(hmap_t* m, size_t capacity);
 
+/**
+ * Allocate the slot array with alloc and free it with release instead of calloc and free, e.g. to place it on a
+ * specific NUMA node. The current slot array is moved immediately. Passing NULL for both restores calloc and free.
+ */
+void hmap_allocator(hmap_t* m, HMAP_ALLOC_TYPE(alloc), HMAP_RELEASE_TYPE(release), void* userdata);
+
+/**
+ * Enable or disable a Bloom filter in front of the slot array. The filter keeps one 64 bit word per four slots and every
+ * key sets HMAP_FILTER_HASHES bits in a single word, so most lookups of missing keys cost one cache line instead of a
+ * walk over a probe cluster with an equals call per entry. The filter is updated by hmap_set and rebuilt when the
+ * capacity changes or after deletes of a quarter of the capacity, since deleted keys can not be removed from it.
+ * Lookups only read the filter.
+ */
+void hmap_filter(hmap_t* m, bool enabled);
+
 /**
  * Set the hash and equals function and reposition all items accordingly to the new hash values.
  */
@@ -260,6 +352,12 @@ size_t hmap_capacity(hmap_t* m);
  * Calculate the load factor (length/capacity = [0, 1]) of the map.
  */
 float hmap_stats_load_factor(hmap_t* m);
+/**
+ * Estimate the probability that the Bloom filter lets a lookup of a missing key through to the slot array, from the
+ * share of set bits per filter word. 1 if the filter is disabled.
+ */
+float hmap_stats_filter_false_positive_rate(hmap_t* m);
+
 /**
  * Return the number of hash collision the last call to hmap_set produced.
  */
@@ -270,6 +368,22 @@ size_t hmap_stats_last_set_collisions(hmap_t* m);
  */
 void hmap_set(hmap_t* m, void* key, hmapitem_t* i);
 
+/**
+ * Associate keys[k] with items[k] for every k < n. The result is the same as calling hmap_set for every pair in order,
+ * but a managed map is resized at most once up front and its load factor is only checked once at the end.
+ */
+void hmap_set_many(hmap_t* m, void** keys, hmapitem_t** items, size_t n);
+
+/**
+ * Associate keys[k] with items[k] for every k < n using nthreads threads. The result is the same as calling hmap_set
+ * for every pair in order. The map is presized once, the keys are hashed in parallel, partitioned by their home slot
+ * into one contiguous slot region per thread and every region is filled by its own thread without locking. Items which
+ * would probe past the end of their region are inserted sequentially afterwards.
+ * Needs 2 * n * sizeof(size_t) bytes of scratch memory. Return 0 on success, -1 if the scratch memory could not be
+ * allocated, in which case the map is left untouched.
+ */
+int hmap_build_parallel(hmap_t* m, void** keys, hmapitem_t** items, size_t n, size_t nthreads);
+
 /**
  * Return true if the given key is associated with a value in the map, false otherwise.
  */
@@ -290,6 +404,56 @@ hmapitem_t* hmap_delete(hmap_t* m, void* key);
  */
 void hmap_foreach(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void*), void* userdata);
 
+/**
+ * Call iter on every key value entry in the map using nthreads threads. Every thread walks its own contiguous, cache
+ * line aligned range of slots. All threads share the same userdata, iter has to synchronize access to it. The map must
+ * not be modified until the function returns.
+ */
+void hmap_foreach_parallel(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void*), void* userdata, size_t nthreads);
+
+/**
+ * Like hmap_foreach_parallel but every thread gets its own accumulator: thread t calls iter with
+ * (char*)accumulators + t * accumulator_size, so accumulators must point to nthreads initialized accumulators. Combine
+ * them after the call returns. Use a multiple of HMAP_CACHE_LINE_SIZE as accumulator_size to avoid false sharing.
+ */
+void hmap_reduce_parallel(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void* accumulator), void* accumulators,
+                          size_t accumulator_size, size_t nthreads);
+
+/**
+ * Associate the given key with the item in addition to all items already associated with it. The map then holds the
+ * key once and links all its items, so all of them are found with a single probe. hmap_length counts keys, not items.
+ * Keys must only be used with the hmap_multi_* functions, hmap_set and hmap_delete would drop the linked items.
+ */
+void hmap_multi_add(hmap_t* m, void* key, hmapmultiitem_t* i);
+
+/**
+ * Return the first item associated with the given key, follow next to reach the others (see HMAP_MULTI_ITER). Null if
+ * the key has no association. Items of a key are returned in no particular order.
+ */
+hmapmultiitem_t* hmap_multi_get(hmap_t* m, void* key);
+
+/**
+ * Return the number of items associated with the given key.
+ */
+size_t hmap_multi_count(hmap_t* m, void* key);
+
+/**
+ * Remove the association of a single item. Return true if the item was associated in the map, false otherwise.
+ */
+bool hmap_multi_delete_item(hmap_t* m, hmapmultiitem_t* i);
+
+/**
+ * Remove all associations of the given key. Return the first disassociated item, the others are still reachable
+ * through next. Null if the key had no association.
+ */
+hmapmultiitem_t* hmap_multi_delete(hmap_t* m, void* key);
+
+/**
+ * Scramble a hash value so that every input bit affects every output bit. Useful to derive bucket indices from weak
+ * hash functions which only produce small or sequential values.
+ */
+size_t hmap_hash_mix(size_t h);
+
 /**
  * Initialize a hmapitem_t.
  */
@@ -300,9 +464,84 @@ void hmapitem_init(hmapitem_t* i);
  */
 bool hmapitem_in_map(hmapitem_t* i, hmap_t* m);
 
+/**
+ * Initialize a hmapmultiitem_t.
+ */
+void hmapmultiitem_init(hmapmultiitem_t* i);
+
 #if defined(IMPL_HMAP) || defined(_CLANGD)
 #include <assert.h>
 #include <stdio.h>
+#include <threads.h>
+
+/**
+ * internal use only: allocate a zeroed slot array using the allocator of the map.
+ */
+hmapitem_t** hmap_internal_alloc_data(hmap_t* m, size_t capacity) {
+    if (m->alloc == NULL) {
+        return calloc(capacity, sizeof(hmapitem_t*));
+    }
+    return m->alloc(capacity * sizeof(hmapitem_t*), m->allocator_userdata);
+}
+
+/**
+ * internal use only: release a slot array allocated by hmap_internal_alloc_data.
+ */
+void hmap_internal_release_data(hmap_t* m, hmapitem_t** data, size_t capacity) {
+    if (m->release == NULL) {
+        free(data);
+        return;
+    }
+    m->release(data, capacity * sizeof(hmapitem_t*), m->allocator_userdata);
+}
+
+/**
+ * internal use only: return the bits a hash value sets in its filter word.
+ */
+uint64_t hmap_internal_filter_mask(size_t mixed) {
+    size_t bits = hmap_hash_mix(mixed ^ (size_t)0x9E3779B97F4A7C15ull);
+    uint64_t mask = 0;
+    for (int k = 0; k < HMAP_FILTER_HASHES; k++) {
+        mask |= (uint64_t)1 << (bits & 63);
+        bits >>= 6;
+    }
+    return mask;
+}
+
+/**
+ * internal use only: add a hash value to the filter.
+ */
+void hmap_internal_filter_add(hmap_t* m, size_t hash) {
+    size_t mixed = hmap_hash_mix(hash);
+    m->filter[mixed % m->filter_words] |= hmap_internal_filter_mask(mixed);
+}
+
+/**
+ * internal use only: return false if no key with the hash value is in the map, true if it might be.
+ */
+bool hmap_internal_filter_contains(hmap_t* m, size_t hash) {
+    size_t mixed = hmap_hash_mix(hash);
+    uint64_t mask = hmap_internal_filter_mask(mixed);
+    return (m->filter[mixed % m->filter_words] & mask) == mask;
+}
+
+/**
+ * internal use only: replace the filter by one sized for the current capacity holding the current keys.
+ */
+void hmap_internal_filter_rebuild(hmap_t* m) {
+    free(m->filter);
+    m->filter_words = m->capacity * HMAP_FILTER_BITS_PER_SLOT / 64;
+    m->filter_words = m->filter_words == 0 ? 1 : m->filter_words;
+    m->filter = calloc(m->filter_words, sizeof(uint64_t));
+    assert(m->filter != NULL);
+    m->filter_deletes = 0;
+
+    for (size_t i = 0; i < m->capacity; i++) {
+        if (m->data[i] != NULL) {
+            hmap_internal_filter_add(m, m->hash(m->data[i]->key));
+        }
+    }
+}
 
 void hmap_init_unmanaged(hmap_t* m, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t initial_capacity) {
     assert(m != NULL);
@@ -311,7 +550,7 @@ void hmap_init_unmanaged(hmap_t* m, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equal
     m->managed = false;
     m->managed_min_load = 0.;
     m->managed_max_load = 1.;
-    m->data = calloc(initial_capacity, sizeof(hmapitem_t*));
+    m->data = hmap_internal_alloc_data(m, initial_capacity);
     m->capacity = initial_capacity;
     m->hash = hash;
     m->equals = equals;
@@ -337,26 +576,37 @@ void hmap_unmanaged(hmap_t* m) {
     m->managed = false;
 }
 
+/**
+ * internal use only: return the capacity a managed table should be adjusted to, half the capacity if the load factor is
+ * below min_load, twice the capacity if it exceeds max_load and the current capacity otherwise. Shared with hset.h.
+ */
+size_t hmap_internal_managed_capacity(size_t length, size_t capacity, float min_load, float max_load,
+                                      size_t min_capacity) {
+    float lf = length / (float)capacity;
+    if (lf < min_load && (capacity / 2) >= min_capacity) {  // only shrink if new capacity would be > min_mc
+        return capacity / 2;
+    } else if (lf > max_load) {  // only grow if load factor exceeds max load factor
+        return capacity * 2;
+    }
+    return capacity;
+}
+
 int hmap_manage(hmap_t* m) {
     assert(m != NULL);
 
     float min_lf = m->managed_min_load;
     float max_lf = m->managed_max_load;
     size_t min_mc = m->managed_min_capacity;
-    float lf = hmap_stats_load_factor(m);
-
-    int ret = 0;
-    if (lf < min_lf && (m->capacity / 2) >= min_mc) {  // only shrink if new capacity would be > min_mc
-        hmap_unmanaged(m);
-        hmap_adjust_capacity(m, m->capacity / 2.);
-        hmap_managed(m, min_lf, max_lf, min_mc);
-        ret = -1;
-    } else if (lf > max_lf) {  // only grow if load factor exceeds max load factor
-        hmap_unmanaged(m);
-        hmap_adjust_capacity(m, m->capacity * 2.);
-        hmap_managed(m, min_lf, max_lf, min_mc);
-        ret = 1;
+    size_t capacity = hmap_internal_managed_capacity(m->length, m->capacity, min_lf, max_lf, min_mc);
+
+    if (capacity == m->capacity) {
+        return 0;
     }
+
+    int ret = capacity < m->capacity ? -1 : 1;
+    hmap_unmanaged(m);
+    hmap_adjust_capacity(m, capacity);
+    hmap_managed(m, min_lf, max_lf, min_mc);
     return ret;
 }
 
@@ -369,7 +619,11 @@ void hmap_adjust_capacity(hmap_t* m, size_t new_capacity) {
     size_t capacity = hmap_capacity(m);
     hmapitem_t** data = m->data;
 
-    m->data = calloc(new_capacity, sizeof(hmapitem_t*));
+    // the filter is rebuilt for the new capacity afterwards, do not fill the old one while reinserting
+    uint64_t* filter = m->filter;
+    m->filter = NULL;
+
+    m->data = hmap_internal_alloc_data(m, new_capacity);
     m->capacity = new_capacity;
     m->length = 0;
 
@@ -385,8 +639,44 @@ void hmap_adjust_capacity(hmap_t* m, size_t new_capacity) {
     }
 
     assert(length == hmap_length(m));
+    ((void)length);
+
+    hmap_internal_release_data(m, data, capacity);
 
-    free(data);
+    if (filter != NULL) {
+        m->filter = filter;
+        hmap_internal_filter_rebuild(m);
+    }
+}
+
+void hmap_allocator(hmap_t* m, HMAP_ALLOC_TYPE(alloc), HMAP_RELEASE_TYPE(release), void* userdata) {
+    assert(m != NULL);
+    assert((alloc == NULL) == (release == NULL));
+
+    hmapitem_t** data = m->data;
+    size_t capacity = m->capacity;
+    hmap_t previous = *m;
+
+    m->alloc = alloc;
+    m->release = release;
+    m->allocator_userdata = userdata;
+    m->data = hmap_internal_alloc_data(m, capacity);
+    memcpy(m->data, data, capacity * sizeof(hmapitem_t*));
+
+    hmap_internal_release_data(&previous, data, capacity);
+}
+
+void hmap_filter(hmap_t* m, bool enabled) {
+    assert(m != NULL);
+
+    if (enabled) {
+        hmap_internal_filter_rebuild(m);
+    } else {
+        free(m->filter);
+        m->filter = NULL;
+        m->filter_words = 0;
+        m->filter_deletes = 0;
+    }
 }
 
 void hmap_rehash(hmap_t* m, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals)) {
@@ -421,7 +711,8 @@ void hmap_rehash_to(hmap_t* source, hmap_t* target) {
 
 void hmap_destroy(hmap_t* m) {
     assert(m != NULL);
-    free(m->data);
+    hmap_internal_release_data(m, m->data, m->capacity);
+    free(m->filter);
     memset(m, 0, sizeof(hmap_t));
 }
 
@@ -440,6 +731,26 @@ float hmap_stats_load_factor(hmap_t* m) {
     return m->length / (float)m->capacity;
 }
 
+float hmap_stats_filter_false_positive_rate(hmap_t* m) {
+    assert(m != NULL);
+
+    if (m->filter == NULL) {
+        return 1;
+    }
+
+    // a missing key passes if all its bits are set in its word
+    double rate = 0;
+    for (size_t w = 0; w < m->filter_words; w++) {
+        double fill = __builtin_popcountll(m->filter[w]) / 64.;
+        double pass = 1;
+        for (int k = 0; k < HMAP_FILTER_HASHES; k++) {
+            pass *= fill;
+        }
+        rate += pass;
+    }
+    return rate / m->filter_words;
+}
+
 size_t hmap_stats_last_set_collisions(hmap_t* m) {
     assert(m != NULL);
     return m->last_set_collisions;
@@ -456,7 +767,8 @@ void hmap_set(hmap_t* m, void* key, hmapitem_t* i) {
 
     size_t length = m->length;
     size_t collisions = 0;
-    size_t index = m->hash(key) % m->capacity;
+    size_t hash = m->hash(key);
+    size_t index = hash % m->capacity;
     while (m->data[index] != NULL && !m->equals(m->data[index]->key, key)) {
         index = (index + 1) % m->capacity;
         collisions++;
@@ -474,33 +786,331 @@ void hmap_set(hmap_t* m, void* key, hmapitem_t* i) {
     m->length++;
     m->last_set_collisions = collisions;
 
+    if (m->filter != NULL && length != m->length) {
+        hmap_internal_filter_add(m, hash);
+    }
+
     if (m->managed && length != m->length) {
         hmap_manage(m);
     }
 }
 
-hmapitem_t** hmap_internal_find(hmap_t* m, void* key) {
+/**
+ * internal use only: return the capacity a managed map grows to when n more items are added, using the same growth
+ * steps as hmap_manage. Unmanaged maps keep their capacity.
+ */
+size_t hmap_internal_reserved_capacity(hmap_t* m, size_t n) {
+    size_t capacity = m->capacity;
+    if (m->managed) {
+        while ((m->length + n) / (float)capacity > m->managed_max_load) {
+            capacity *= 2;
+        }
+    }
+    return capacity;
+}
+
+void hmap_set_many(hmap_t* m, void** keys, hmapitem_t** items, size_t n) {
     assert(m != NULL);
+    assert(n == 0 || (keys != NULL && items != NULL));
+    assert(m->managed || n <= hmap_capacity(m) - hmap_length(m));
 
-    if (hmap_length(m) == 0) {
-        return NULL;
+    if (n == 0) {
+        return;
     }
 
-    size_t hash = m->hash(key);
-    size_t start_index = hash % m->capacity;
+    bool managed = m->managed;
+    float min_load = m->managed_min_load;
+    float max_load = m->managed_max_load;
+    size_t min_capacity = m->managed_min_capacity;
+    size_t capacity = hmap_internal_reserved_capacity(m, n);
+
+    hmap_unmanaged(m);
+    if (capacity != m->capacity) {
+        hmap_adjust_capacity(m, capacity);
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        hmap_set(m, keys[k], items[k]);
+    }
+
+    if (managed) {
+        hmap_managed(m, min_load, max_load, min_capacity);
+        hmap_manage(m);
+    }
+}
+
+typedef struct hmap_internal_worker_s {
+    void* shared;
+    size_t id;
+} hmap_internal_worker_t;
+
+/**
+ * internal use only: run fn once for every worker in workers. Worker 0 runs on the calling thread, if a thread can not
+ * be started its worker runs on the calling thread too.
+ */
+void hmap_internal_parallel(int (*fn)(void*), hmap_internal_worker_t* workers, size_t nthreads) {
+    thrd_t threads[nthreads];
+    bool started[nthreads];
+
+    for (size_t t = 1; t < nthreads; t++) {
+        started[t] = thrd_create(&threads[t], fn, &workers[t]) == thrd_success;
+    }
+
+    fn(&workers[0]);
+
+    for (size_t t = 1; t < nthreads; t++) {
+        if (started[t]) {
+            thrd_join(threads[t], NULL);
+        } else {
+            fn(&workers[t]);
+        }
+    }
+}
+
+typedef struct hmap_internal_build_s {
+    hmap_t* m;
+    void** keys;
+    hmapitem_t** items;
+    size_t n;
+    size_t nthreads;
+    size_t region_size;
+    size_t* homes;
+    size_t* order;
+    size_t* offsets;        // nthreads x nthreads: per input chunk and region, later the write cursor
+    size_t* region_begin;   // nthreads + 1
+    size_t* deferred;       // per region: number of items which did not fit into the region
+    size_t* length_delta;   // per region: number of new associations
+} hmap_internal_build_t;
+
+int hmap_internal_build_hash(void* arg) {
+    hmap_internal_worker_t* w = arg;
+    hmap_internal_build_t* b = w->shared;
+
+    size_t begin = b->n * w->id / b->nthreads;
+    size_t end = b->n * (w->id + 1) / b->nthreads;
+    size_t* histogram = &b->offsets[w->id * b->nthreads];
+
+    for (size_t k = begin; k < end; k++) {
+        b->homes[k] = b->m->hash(b->keys[k]) % b->m->capacity;
+        histogram[b->homes[k] / b->region_size]++;
+    }
+    return 0;
+}
+
+int hmap_internal_build_scatter(void* arg) {
+    hmap_internal_worker_t* w = arg;
+    hmap_internal_build_t* b = w->shared;
+
+    size_t begin = b->n * w->id / b->nthreads;
+    size_t end = b->n * (w->id + 1) / b->nthreads;
+    size_t* cursor = &b->offsets[w->id * b->nthreads];
+
+    for (size_t k = begin; k < end; k++) {
+        b->order[cursor[b->homes[k] / b->region_size]++] = k;
+    }
+    return 0;
+}
+
+int hmap_internal_build_insert(void* arg) {
+    hmap_internal_worker_t* w = arg;
+    hmap_internal_build_t* b = w->shared;
+    hmap_t* m = b->m;
+
+    size_t slot_end = (w->id + 1) * b->region_size;
+    if (slot_end > m->capacity) {
+        slot_end = m->capacity;
+    }
+
+    // deferred items are compacted into the front of the region's part of order, behind the read position
+    size_t* deferred = &b->order[b->region_begin[w->id]];
+    size_t deferred_count = 0;
+    size_t length_delta = 0;
+
+    for (size_t o = b->region_begin[w->id]; o < b->region_begin[w->id + 1]; o++) {
+        size_t k = b->order[o];
+        assert(b->items[k]->map_ptr == NULL);
+        assert(b->items[k]->key == NULL);
+
+        size_t index = b->homes[k];
+        while (index < slot_end && m->data[index] != NULL && !m->equals(m->data[index]->key, b->keys[k])) {
+            index++;
+        }
+
+        if (index == slot_end) {
+            deferred[deferred_count++] = k;
+            continue;
+        }
+
+        if (m->data[index] != NULL) {
+            m->data[index]->map_ptr = NULL;
+            m->data[index]->key = NULL;
+        } else {
+            length_delta++;
+        }
+
+        m->data[index] = b->items[k];
+        m->data[index]->map_ptr = m;
+        m->data[index]->key = b->keys[k];
+    }
+
+    b->deferred[w->id] = deferred_count;
+    b->length_delta[w->id] = length_delta;
+    return 0;
+}
+
+int hmap_build_parallel(hmap_t* m, void** keys, hmapitem_t** items, size_t n, size_t nthreads) {
+    assert(m != NULL);
+    assert(m->hash != NULL);
+    assert(m->equals != NULL);
+    assert(n == 0 || (keys != NULL && items != NULL));
+    assert(m->managed || n <= hmap_capacity(m) - hmap_length(m));
+
+    if (n == 0) {
+        return 0;
+    }
+
+    bool managed = m->managed;
+    size_t capacity = hmap_internal_reserved_capacity(m, n);
+
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+    if (nthreads > capacity) {
+        nthreads = capacity;
+    }
+
+    hmap_internal_build_t b = {0};
+    b.m = m;
+    b.keys = keys;
+    b.items = items;
+    b.n = n;
+    b.nthreads = nthreads;
+    b.region_size = (capacity + nthreads - 1) / nthreads;
+    b.homes = malloc(n * sizeof(size_t));
+    b.order = malloc(n * sizeof(size_t));
+    b.offsets = calloc(nthreads * nthreads + 3 * nthreads + 1, sizeof(size_t));
+
+    if (b.homes == NULL || b.order == NULL || b.offsets == NULL) {
+        free(b.homes);
+        free(b.order);
+        free(b.offsets);
+        return -1;
+    }
+
+    b.region_begin = b.offsets + nthreads * nthreads;
+    b.deferred = b.region_begin + nthreads + 1;
+    b.length_delta = b.deferred + nthreads;
+
+    float min_load = m->managed_min_load;
+    float max_load = m->managed_max_load;
+    size_t min_capacity = m->managed_min_capacity;
+    hmap_unmanaged(m);
+    if (capacity != m->capacity) {
+        hmap_adjust_capacity(m, capacity);
+    }
+
+    hmap_internal_worker_t workers[nthreads];
+    for (size_t t = 0; t < nthreads; t++) {
+        workers[t].shared = &b;
+        workers[t].id = t;
+    }
+
+    hmap_internal_parallel(hmap_internal_build_hash, workers, nthreads);
+
+    // turn the per chunk histograms into stable write cursors: region major, input chunk minor
+    size_t offset = 0;
+    for (size_t r = 0; r < nthreads; r++) {
+        b.region_begin[r] = offset;
+        for (size_t t = 0; t < nthreads; t++) {
+            size_t count = b.offsets[t * nthreads + r];
+            b.offsets[t * nthreads + r] = offset;
+            offset += count;
+        }
+    }
+    b.region_begin[nthreads] = offset;
+
+    hmap_internal_parallel(hmap_internal_build_scatter, workers, nthreads);
+    hmap_internal_parallel(hmap_internal_build_insert, workers, nthreads);
+
+    for (size_t r = 0; r < nthreads; r++) {
+        m->length += b.length_delta[r];
+    }
+
+    for (size_t r = 0; r < nthreads; r++) {
+        for (size_t d = 0; d < b.deferred[r]; d++) {
+            size_t k = b.order[b.region_begin[r] + d];
+            hmap_set(m, keys[k], items[k]);
+        }
+    }
+
+    // the region threads bypass hmap_set
+    if (m->filter != NULL) {
+        hmap_internal_filter_rebuild(m);
+    }
+
+    free(b.homes);
+    free(b.order);
+    free(b.offsets);
+
+    if (managed) {
+        hmap_managed(m, min_load, max_load, min_capacity);
+        hmap_manage(m);
+    }
+
+    return 0;
+}
+
+/**
+ * internal use only: probe the slots of a linear probing table for key. Return the index of the slot holding an equal
+ * key, of the empty slot ending the probe sequence or capacity if the table is full and holds no equal key. The slots
+ * hold hmapitem_t pointers or, if key_only is set, the keys themselves like in hset.h.
+ */
+size_t hmap_internal_probe(void** data, size_t capacity, size_t hash, void* key, HMAP_EQUALS_TYPE(equals),
+                           bool key_only) {
+    size_t start_index = hash % capacity;
     size_t index = start_index;
-    while (m->data[index] != NULL) {
-        if (m->equals(m->data[index]->key, key)) {
-            return &m->data[index];
+    do {
+        if (data[index] == NULL || equals(key_only ? data[index] : ((hmapitem_t*)data[index])->key, key)) {
+            return index;
         }
+        index = (index + 1) % capacity;
+    } while (index != start_index);
+    return capacity;
+}
 
-        if (((index + 1) % m->capacity) == start_index) {
-            return m->equals(m->data[index]->key, key) ? &m->data[index] : NULL;
+/**
+ * internal use only: empty the slot hole of a linear probing table and shift the following entries of its probe
+ * cluster back unless their home slot lies cyclically between the hole and themselves, this includes entries whose
+ * home slot lies before the one of the removed entry. See hmap_internal_probe for key_only.
+ */
+void hmap_internal_backshift(void** data, size_t capacity, size_t hole, HMAP_HASH_TYPE(hash), bool key_only) {
+    data[hole] = NULL;
+    size_t index = hole;
+    while (data[index = (index + 1) % capacity] != NULL) {
+        size_t home = hash(key_only ? data[index] : ((hmapitem_t*)data[index])->key) % capacity;
+        bool stays = hole < index ? (home > hole && home <= index) : (home > hole || home <= index);
+        if (!stays) {
+            data[hole] = data[index];
+            data[index] = NULL;
+            hole = index;
         }
+    }
+}
 
-        index = (index + 1) % m->capacity;
+hmapitem_t** hmap_internal_find(hmap_t* m, void* key) {
+    assert(m != NULL);
+
+    if (hmap_length(m) == 0) {
+        return NULL;
+    }
+
+    size_t hash = m->hash(key);
+    if (m->filter != NULL && !hmap_internal_filter_contains(m, hash)) {
+        return NULL;
     }
-    return NULL;
+
+    size_t index = hmap_internal_probe((void**)m->data, m->capacity, hash, key, m->equals, false);
+    return index < m->capacity && m->data[index] != NULL ? &m->data[index] : NULL;
 }
 
 bool hmap_has(hmap_t* m, void* key) {
@@ -529,53 +1139,24 @@ hmapitem_t* hmap_delete(hmap_t* m, void* key) {
     }
 
     hmapitem_t* item = *item_ptr;
-    *item_ptr = NULL;
-
     item->map_ptr = NULL;
     item->key = NULL;
     m->length--;
 
-    /*
-    Lets assume a scenario like this:
-
-    hash(a) = 3 = x
-    hash(b) = 2 = y
-    hash(c) = 3 = x
-    hash(d) = 3 = x
-    set(a)
-    set(b)
-    set(c)
-    set(d)
-
-    [b, c, d, a]
-
-    When delete(a): resetting rel0 to 3 maps the data to:
+    hmap_internal_backshift((void**)m->data, m->capacity, item_ptr - m->data, m->hash, false);
 
-    [a, b, c, d]
-
-    Now the running index will always grow and the checks for b, c and d are easier, since we only need to check if they
-    need to be moved left (WITHOUT wrapping to counter the modulo operation) [0, b, c, d]
-     */
-
-    size_t rel0 = m->hash(key) % m->capacity;
-    size_t index = (item_ptr - m->data - rel0) % m->capacity;
-    size_t shift_to_index = index;
-
-    while ((++index) < m->capacity && m->data[(index + rel0) % m->capacity] != NULL) {
-        size_t hash_index = ((m->hash(m->data[(index + rel0) % m->capacity]->key) - rel0) % m->capacity);
-        if (hash_index > shift_to_index) {
-            continue;
-        }
-
-        m->data[(shift_to_index + rel0) % m->capacity] = m->data[(index + rel0) % m->capacity];
-        m->data[(index + rel0) % m->capacity] = NULL;
-        shift_to_index = index;
+    if (m->filter != NULL) {
+        m->filter_deletes++;
     }
 
     if (m->managed) {  // no need to check for length change here since short circuit if key not found
         hmap_manage(m);
     }
 
+    if (m->filter != NULL && m->filter_deletes > m->capacity / 4) {
+        hmap_internal_filter_rebuild(m);
+    }
+
     return item;
 }
 
@@ -590,6 +1171,168 @@ void hmap_foreach(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void*), void*
     }
 }
 
+typedef struct hmap_internal_reduce_s {
+    hmap_t* m;
+    void (*iter)(void* key, hmapitem_t*, void*);
+    char* accumulators;
+    size_t accumulator_size;
+    size_t nthreads;
+} hmap_internal_reduce_t;
+
+/**
+ * internal use only: return the slot index at which the range of the given worker starts, moved forward to the next
+ * cache line boundary.
+ */
+size_t hmap_internal_range_begin(hmap_t* m, size_t worker, size_t nthreads) {
+    if (worker == 0) {
+        return 0;
+    }
+    if (worker >= nthreads) {
+        return m->capacity;
+    }
+
+    uintptr_t base = (uintptr_t)m->data;
+    uintptr_t addr = base + (m->capacity * worker / nthreads) * sizeof(hmapitem_t*);
+    addr = (addr + HMAP_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(HMAP_CACHE_LINE_SIZE - 1);
+
+    size_t index = (addr - base) / sizeof(hmapitem_t*);
+    return index < m->capacity ? index : m->capacity;
+}
+
+int hmap_internal_reduce(void* arg) {
+    hmap_internal_worker_t* w = arg;
+    hmap_internal_reduce_t* r = w->shared;
+    hmapitem_t** data = r->m->data;
+    void* accumulator = r->accumulators + w->id * r->accumulator_size;
+
+    size_t end = hmap_internal_range_begin(r->m, w->id + 1, r->nthreads);
+    for (size_t i = hmap_internal_range_begin(r->m, w->id, r->nthreads); i < end; i++) {
+        if (data[i] != NULL) {
+            r->iter(data[i]->key, data[i], accumulator);
+        }
+    }
+    return 0;
+}
+
+void hmap_foreach_parallel(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void*), void* userdata, size_t nthreads) {
+    hmap_reduce_parallel(m, iter, userdata, 0, nthreads);
+}
+
+void hmap_reduce_parallel(hmap_t* m, void (*iter)(void* key, hmapitem_t*, void* accumulator), void* accumulators,
+                          size_t accumulator_size, size_t nthreads) {
+    assert(m != NULL);
+    assert(iter != NULL);
+
+    if (nthreads == 0) {
+        nthreads = 1;
+    }
+
+    hmap_internal_reduce_t r = {
+        .m = m,
+        .iter = iter,
+        .accumulators = accumulators,
+        .accumulator_size = accumulator_size,
+        .nthreads = nthreads,
+    };
+
+    hmap_internal_worker_t workers[nthreads];
+    for (size_t t = 0; t < nthreads; t++) {
+        workers[t].shared = &r;
+        workers[t].id = t;
+    }
+
+    hmap_internal_parallel(hmap_internal_reduce, workers, nthreads);
+}
+
+void hmap_multi_add(hmap_t* m, void* key, hmapmultiitem_t* i) {
+    assert(m != NULL);
+    assert(i != NULL);
+    assert(i->item.map_ptr == NULL);
+
+    hmapitem_t** head = hmap_internal_find(m, key);
+    if (head == NULL) {
+        i->next = NULL;
+        hmap_set(m, key, &i->item);
+        return;
+    }
+
+    // link behind the head, the slot keeps pointing to the same item
+    hmapmultiitem_t* first = (hmapmultiitem_t*)*head;
+    i->item.map_ptr = m;
+    i->item.key = key;
+    i->next = first->next;
+    first->next = i;
+}
+
+hmapmultiitem_t* hmap_multi_get(hmap_t* m, void* key) {
+    assert(m != NULL);
+
+    return (hmapmultiitem_t*)hmap_get(m, key);
+}
+
+size_t hmap_multi_count(hmap_t* m, void* key) {
+    assert(m != NULL);
+
+    size_t count = 0;
+    HMAP_MULTI_ITER(i, m, key) {
+        count++;
+    }
+    return count;
+}
+
+bool hmap_multi_delete_item(hmap_t* m, hmapmultiitem_t* i) {
+    assert(m != NULL);
+    assert(i != NULL);
+
+    if (i->item.map_ptr != m) {
+        return false;
+    }
+
+    hmapitem_t** head = hmap_internal_find(m, i->item.key);
+    assert(head != NULL);
+    hmapmultiitem_t* first = (hmapmultiitem_t*)*head;
+
+    if (first == i && i->next == NULL) {
+        hmap_delete(m, i->item.key);
+    } else if (first == i) {
+        // the next item takes over the slot
+        *head = &i->next->item;
+    } else {
+        hmapmultiitem_t* previous = first;
+        while (previous->next != i) {
+            previous = previous->next;
+        }
+        previous->next = i->next;
+    }
+
+    i->item.map_ptr = NULL;
+    i->item.key = NULL;
+    i->next = NULL;
+    return true;
+}
+
+hmapmultiitem_t* hmap_multi_delete(hmap_t* m, void* key) {
+    assert(m != NULL);
+
+    hmapmultiitem_t* first = (hmapmultiitem_t*)hmap_delete(m, key);
+    for (hmapmultiitem_t* i = first; i != NULL; i = i->next) {
+        i->item.map_ptr = NULL;
+        i->item.key = NULL;
+    }
+    return first;
+}
+
+size_t hmap_hash_mix(size_t h) {
+    // finalizer of MurmurHash3
+    uint64_t x = (uint64_t)h;
+    x ^= x >> 33;
+    x *= UINT64_C(0xff51afd7ed558ccd);
+    x ^= x >> 33;
+    x *= UINT64_C(0xc4ceb9fe1a85ec53);
+    x ^= x >> 33;
+    return (size_t)x;
+}
+
 void hmapitem_init(hmapitem_t* i) {
     assert(i != NULL);
     i->key = NULL;
@@ -602,5 +1345,11 @@ bool hmapitem_in_map(hmapitem_t* i, hmap_t* m) {
     return i->map_ptr == m;
 }
 
+void hmapmultiitem_init(hmapmultiitem_t* i) {
+    assert(i != NULL);
+    hmapitem_init(&i->item);
+    i->next = NULL;
+}
+
 #endif
 #endif
@@ -0,0 +1,318 @@
+
+/*
+
+# Hash Map Combining Insert Buffers
+
+Insert into a shared hmap_t from many threads without handing the map lock over for every single insert. Every thread
+appends its (key, item) pairs to its own buffer. When a buffer is full its thread takes the map lock and becomes the
+combiner: it drains the buffers of all threads and inserts everything with one hmap_set_many call, which presizes the
+map once and checks the load factor once. Threads which wait for the lock usually find their buffer already drained.
+
+A thread sees its own pending inserts through hmap_combine_get, pending inserts of other threads become visible after
+the next flush.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_COMBINE` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_COMBINE
+#include "hmap_combine.h"
+```
+
+After that include hmap_combine.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_combine.h"
+```
+
+hmap_combine.h uses C11 threads and atomics, link with `-pthread` if your libc needs it.
+
+### Basic Usage
+
+```
+hmap_t sessions;
+hmap_init(&sessions, hash_session_id, equals_session_id);
+
+hmap_combine_t c;
+hmap_combine_init(&c, &sessions, 16);
+
+// worker thread
+hmap_combine_buffer_t* b = hmap_combine_register(&c);
+hmap_combine_set(&c, b, &s->id, HMAPITEM_OF(session, s));
+...
+hmap_combine_unregister(&c, b);
+
+// exclusive access to the map, e.g. for hmap_delete
+hmap_t* m = hmap_combine_lock(&c);
+hmap_delete(m, &id);
+hmap_combine_unlock(&c);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_COMBINE_H
+#define DS_HMAP_COMBINE_H
+#include <stdatomic.h>
+#include <stddef.h>
+#include <threads.h>
+
+#include "hmap.h"
+
+/**
+ * The number of pending inserts a thread buffers before it flushes.
+ */
+#define HMAP_COMBINE_BUFFER_CAPACITY 256
+
+typedef struct hmap_combine_buffer_s {
+    mtx_t lock;
+    atomic_bool registered;
+    size_t length;
+    void* keys[HMAP_COMBINE_BUFFER_CAPACITY];
+    hmapitem_t* items[HMAP_COMBINE_BUFFER_CAPACITY];
+} hmap_combine_buffer_t;
+
+typedef struct hmap_combine_s {
+    hmap_t* m;
+    mtx_t map_lock;
+    size_t buffers_length;
+    hmap_combine_buffer_t* buffers;
+    void** batch_keys;
+    hmapitem_t** batch_items;
+    size_t flushes;
+} hmap_combine_t;
+
+/**
+ * Initialize a combining layer in front of the map m for up to max_threads registered threads.
+ */
+void hmap_combine_init(hmap_combine_t* c, hmap_t* m, size_t max_threads);
+
+/**
+ * Flush all pending inserts and free all resources allocated by hmap_combine_init. The map itself is not destroyed.
+ */
+void hmap_combine_destroy(hmap_combine_t* c);
+
+/**
+ * Register the calling thread and return its buffer. Return NULL if max_threads buffers are in use.
+ */
+hmap_combine_buffer_t* hmap_combine_register(hmap_combine_t* c);
+
+/**
+ * Flush the pending inserts of the buffer and release it.
+ */
+void hmap_combine_unregister(hmap_combine_t* c, hmap_combine_buffer_t* b);
+
+/**
+ * Queue the association of key with the item. The item must not be in a map. Possible existing associations will be
+ * overwritten when the insert is flushed. Flushes all buffers if the buffer of the calling thread is full.
+ */
+void hmap_combine_set(hmap_combine_t* c, hmap_combine_buffer_t* b, void* key, hmapitem_t* i);
+
+/**
+ * Return the item associated with the key, taking the pending inserts of the given buffer into account. Null if the key
+ * has no association.
+ */
+hmapitem_t* hmap_combine_get(hmap_combine_t* c, hmap_combine_buffer_t* b, void* key);
+
+/**
+ * Insert the pending items of all buffers into the map.
+ */
+void hmap_combine_flush(hmap_combine_t* c);
+
+/**
+ * Flush all buffers and return the map locked for exclusive use by the calling thread.
+ */
+hmap_t* hmap_combine_lock(hmap_combine_t* c);
+
+/**
+ * Release the map locked by hmap_combine_lock.
+ */
+void hmap_combine_unlock(hmap_combine_t* c);
+
+/**
+ * Return the number of batched flushes performed so far.
+ */
+size_t hmap_combine_stats_flushes(hmap_combine_t* c);
+
+#if defined(IMPL_HMAP_COMBINE) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+
+void hmap_combine_init(hmap_combine_t* c, hmap_t* m, size_t max_threads) {
+    assert(c != NULL);
+    assert(m != NULL);
+    assert(max_threads > 0);
+
+    c->m = m;
+    c->buffers_length = max_threads;
+    c->buffers = calloc(max_threads, sizeof(hmap_combine_buffer_t));
+    c->batch_keys = malloc(max_threads * HMAP_COMBINE_BUFFER_CAPACITY * sizeof(void*));
+    c->batch_items = malloc(max_threads * HMAP_COMBINE_BUFFER_CAPACITY * sizeof(hmapitem_t*));
+    c->flushes = 0;
+    assert(c->buffers != NULL && c->batch_keys != NULL && c->batch_items != NULL);
+
+    mtx_init(&c->map_lock, mtx_plain);
+    for (size_t i = 0; i < max_threads; i++) {
+        mtx_init(&c->buffers[i].lock, mtx_plain);
+        atomic_init(&c->buffers[i].registered, false);
+    }
+}
+
+void hmap_combine_destroy(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    hmap_combine_flush(c);
+
+    for (size_t i = 0; i < c->buffers_length; i++) {
+        mtx_destroy(&c->buffers[i].lock);
+    }
+    mtx_destroy(&c->map_lock);
+    free(c->buffers);
+    free(c->batch_keys);
+    free(c->batch_items);
+    memset(c, 0, sizeof(hmap_combine_t));
+}
+
+hmap_combine_buffer_t* hmap_combine_register(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    for (size_t i = 0; i < c->buffers_length; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&c->buffers[i].registered, &expected, true)) {
+            return &c->buffers[i];
+        }
+    }
+    return NULL;
+}
+
+void hmap_combine_unregister(hmap_combine_t* c, hmap_combine_buffer_t* b) {
+    assert(c != NULL);
+    assert(b != NULL);
+
+    hmap_combine_flush(c);
+    atomic_store(&b->registered, false);
+}
+
+/**
+ * internal use only: drain all buffers into the map, the map lock must be held.
+ */
+void hmap_combine_internal_drain(hmap_combine_t* c) {
+    size_t n = 0;
+    for (size_t i = 0; i < c->buffers_length; i++) {
+        hmap_combine_buffer_t* b = &c->buffers[i];
+
+        mtx_lock(&b->lock);
+        memcpy(&c->batch_keys[n], b->keys, b->length * sizeof(void*));
+        memcpy(&c->batch_items[n], b->items, b->length * sizeof(hmapitem_t*));
+        n += b->length;
+        b->length = 0;
+        mtx_unlock(&b->lock);
+    }
+
+    if (n > 0) {
+        hmap_set_many(c->m, c->batch_keys, c->batch_items, n);
+        c->flushes++;
+    }
+}
+
+void hmap_combine_set(hmap_combine_t* c, hmap_combine_buffer_t* b, void* key, hmapitem_t* i) {
+    assert(c != NULL);
+    assert(b != NULL);
+    assert(i != NULL);
+    assert(i->map_ptr == NULL);
+
+    mtx_lock(&b->lock);
+    while (b->length == HMAP_COMBINE_BUFFER_CAPACITY) {
+        mtx_unlock(&b->lock);
+
+        // the thread holding the map lock might be draining this buffer already
+        mtx_lock(&c->map_lock);
+        mtx_lock(&b->lock);
+        bool full = b->length == HMAP_COMBINE_BUFFER_CAPACITY;
+        mtx_unlock(&b->lock);
+        if (full) {
+            hmap_combine_internal_drain(c);
+        }
+        mtx_unlock(&c->map_lock);
+
+        mtx_lock(&b->lock);
+    }
+
+    b->keys[b->length] = key;
+    b->items[b->length] = i;
+    b->length++;
+    mtx_unlock(&b->lock);
+}
+
+hmapitem_t* hmap_combine_get(hmap_combine_t* c, hmap_combine_buffer_t* b, void* key) {
+    assert(c != NULL);
+    assert(b != NULL);
+
+    // the newest pending insert wins
+    mtx_lock(&b->lock);
+    for (size_t k = b->length; k > 0; k--) {
+        if (c->m->equals(b->keys[k - 1], key)) {
+            hmapitem_t* i = b->items[k - 1];
+            mtx_unlock(&b->lock);
+            return i;
+        }
+    }
+    mtx_unlock(&b->lock);
+
+    mtx_lock(&c->map_lock);
+    hmapitem_t* i = hmap_get(c->m, key);
+    mtx_unlock(&c->map_lock);
+    return i;
+}
+
+void hmap_combine_flush(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    mtx_lock(&c->map_lock);
+    hmap_combine_internal_drain(c);
+    mtx_unlock(&c->map_lock);
+}
+
+hmap_t* hmap_combine_lock(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    mtx_lock(&c->map_lock);
+    hmap_combine_internal_drain(c);
+    return c->m;
+}
+
+void hmap_combine_unlock(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    mtx_unlock(&c->map_lock);
+}
+
+size_t hmap_combine_stats_flushes(hmap_combine_t* c) {
+    assert(c != NULL);
+
+    mtx_lock(&c->map_lock);
+    size_t flushes = c->flushes;
+    mtx_unlock(&c->map_lock);
+    return flushes;
+}
+
+#endif
+#endif
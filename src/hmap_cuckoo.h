@@ -0,0 +1,549 @@
+
+/*
+
+# Hash Map Cuckoo
+
+A bucketized cuckoo hash table using the same intrusive hmapitem_t items and hash/equals functions as hmap_t. Every key
+has two candidate buckets of HMAP_CUCKOO_BUCKET_SLOTS slots each. A bucket stores the full hash value next to every
+item pointer and fills exactly one cache line on 64 bit platforms, so a lookup touches at most two cache lines (plus
+the item of a matching hash) regardless of the load factor. If both buckets of a new key are full a breadth first
+search looks for the shortest chain of items which can be moved to their alternative bucket to make room.
+
+Loads of 0.9 and above stay practical, the default maximum load factor is HMAP_CUCKOO_MAX_LOAD. Keys whose hash
+values collide too often to be placed (e.g. because of a constant hash function) are kept in a small stash which is
+searched linearly.
+
+Bucket indices are derived from hmap_hash_mix of the hash value, weak hash functions work as long as different keys get
+different hash values.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_CUCKOO` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_CUCKOO
+#include "hmap_cuckoo.h"
+```
+
+After that include hmap_cuckoo.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_cuckoo.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    char* name;
+    int age;
+    HMAPITEM_PROP();
+} person;
+
+hmap_cuckoo_t people;
+hmap_cuckoo_init(&people, hmap_hash_str, hmap_equals_str);
+
+person alex = {.name = "alex", .age = 34};
+hmap_cuckoo_set(&people, alex.name, HMAPITEM_OF(person, &alex));
+
+person* p = HMAP_CUCKOO_GET(person, &people, "alex");
+
+hmap_cuckoo_destroy(&people);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_CUCKOO_H
+#define DS_HMAP_CUCKOO_H
+#include <stddef.h>
+
+#include "hmap.h"
+
+/**
+ * The number of slots per bucket.
+ */
+#define HMAP_CUCKOO_BUCKET_SLOTS 4
+
+/**
+ * The default maximum load factor, the table doubles its number of buckets before it exceeds it.
+ */
+#define HMAP_CUCKOO_MAX_LOAD 0.95f
+
+/**
+ * The maximum number of buckets the displacement search visits before the table grows.
+ */
+#define HMAP_CUCKOO_SEARCH_LIMIT 256
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item using the default
+ * item property name.
+ */
+#define HMAP_CUCKOO_GET(type, map, key) HMAP_CUCKOO_GET_s(type, map, key, HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item.
+ */
+#define HMAP_CUCKOO_GET_s(type, map, key, property_name) \
+    (hmap_cuckoo_has(map, key) ? HMAPITEM_AS_s(type, hmap_cuckoo_get(map, key), property_name) : NULL)
+
+typedef struct hmap_cuckoo_bucket_s {
+    size_t hashes[HMAP_CUCKOO_BUCKET_SLOTS];
+    hmapitem_t* items[HMAP_CUCKOO_BUCKET_SLOTS];
+} hmap_cuckoo_bucket_t;
+
+typedef struct hmap_cuckoo_s {
+    float max_load;
+    size_t length;
+    size_t buckets_length;  // always a power of two
+    hmap_cuckoo_bucket_t* buckets;
+    size_t stash_length;
+    size_t stash_capacity;
+    hmapitem_t** stash;
+    HMAP_HASH_TYPE(hash);
+    HMAP_EQUALS_TYPE(equals);
+} hmap_cuckoo_t;
+
+/**
+ * Initialize a cuckoo map with room for HMAP_INITIAL_CAPACITY items.
+ */
+void hmap_cuckoo_init(hmap_cuckoo_t* c, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals));
+
+/**
+ * Initialize a cuckoo map with room for at least capacity items before it grows for the first time.
+ */
+void hmap_cuckoo_init_capacity(hmap_cuckoo_t* c, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t capacity);
+
+/**
+ * Set the maximum load factor (0, 1]. The map grows when an insert would exceed it.
+ */
+void hmap_cuckoo_max_load(hmap_cuckoo_t* c, float max_load);
+
+/**
+ * Free all resources allocated by a call to hmap_cuckoo_init*() functions.
+ */
+void hmap_cuckoo_destroy(hmap_cuckoo_t* c);
+
+/**
+ * Return the number of items in the map.
+ */
+size_t hmap_cuckoo_length(hmap_cuckoo_t* c);
+
+/**
+ * Return the number of slots of the map.
+ */
+size_t hmap_cuckoo_capacity(hmap_cuckoo_t* c);
+
+/**
+ * Calculate the load factor (length/capacity = [0, 1]) of the map.
+ */
+float hmap_cuckoo_stats_load_factor(hmap_cuckoo_t* c);
+
+/**
+ * Return the number of items which could not be placed in one of their buckets and are kept in the stash.
+ */
+size_t hmap_cuckoo_stats_stash_length(hmap_cuckoo_t* c);
+
+/**
+ * Associate the given key with the item and store it in the map. Possible existing associations will be overwritten.
+ */
+void hmap_cuckoo_set(hmap_cuckoo_t* c, void* key, hmapitem_t* i);
+
+/**
+ * Return true if the given key is associated with a value in the map, false otherwise.
+ */
+bool hmap_cuckoo_has(hmap_cuckoo_t* c, void* key);
+
+/**
+ * Return the item associated with the given key. Null if the key has no association.
+ */
+hmapitem_t* hmap_cuckoo_get(hmap_cuckoo_t* c, void* key);
+
+/**
+ * Remove an association between a key and an item from the map. Return a pointer to the disassociated item if a
+ * association existed, null otherwise.
+ */
+hmapitem_t* hmap_cuckoo_delete(hmap_cuckoo_t* c, void* key);
+
+/**
+ * Call iter on every key value entry in the map.
+ */
+void hmap_cuckoo_foreach(hmap_cuckoo_t* c, void (*iter)(void* key, hmapitem_t*, void*), void* userdata);
+
+/**
+ * Return true if the item has an association in the given cuckoo map.
+ */
+bool hmapitem_in_cuckoo(hmapitem_t* i, hmap_cuckoo_t* c);
+
+#if defined(IMPL_HMAP_CUCKOO) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * internal use only: return the number of buckets needed to hold capacity items below the maximum load factor.
+ */
+size_t hmap_cuckoo_internal_buckets_for(hmap_cuckoo_t* c, size_t capacity) {
+    size_t buckets = 2;
+    while (buckets * HMAP_CUCKOO_BUCKET_SLOTS * c->max_load < capacity) {
+        buckets *= 2;
+    }
+    return buckets;
+}
+
+/**
+ * internal use only: allocate a zeroed, cache line aligned bucket array.
+ */
+hmap_cuckoo_bucket_t* hmap_cuckoo_internal_alloc_buckets(size_t buckets_length) {
+    size_t size = buckets_length * sizeof(hmap_cuckoo_bucket_t);
+    size = (size + HMAP_CACHE_LINE_SIZE - 1) / HMAP_CACHE_LINE_SIZE * HMAP_CACHE_LINE_SIZE;
+    hmap_cuckoo_bucket_t* buckets = aligned_alloc(HMAP_CACHE_LINE_SIZE, size);
+    assert(buckets != NULL);
+    memset(buckets, 0, size);
+    return buckets;
+}
+
+/**
+ * internal use only: return the first candidate bucket of a hash value.
+ */
+size_t hmap_cuckoo_internal_first(hmap_cuckoo_t* c, size_t hash) {
+    return hmap_hash_mix(hash) & (c->buckets_length - 1);
+}
+
+/**
+ * internal use only: return the second candidate bucket of a hash value.
+ */
+size_t hmap_cuckoo_internal_second(hmap_cuckoo_t* c, size_t hash) {
+    return hmap_hash_mix(hmap_hash_mix(hash) ^ (size_t)0x9E3779B97F4A7C15ull) & (c->buckets_length - 1);
+}
+
+/**
+ * internal use only: return the candidate bucket of a hash value which is not the given one.
+ */
+size_t hmap_cuckoo_internal_alternative(hmap_cuckoo_t* c, size_t hash, size_t bucket) {
+    size_t first = hmap_cuckoo_internal_first(c, hash);
+    return first == bucket ? hmap_cuckoo_internal_second(c, hash) : first;
+}
+
+/**
+ * internal use only: return the index of a free slot in the bucket, HMAP_CUCKOO_BUCKET_SLOTS if the bucket is full.
+ */
+size_t hmap_cuckoo_internal_free_slot(hmap_cuckoo_bucket_t* b) {
+    size_t slot = 0;
+    while (slot < HMAP_CUCKOO_BUCKET_SLOTS && b->items[slot] != NULL) {
+        slot++;
+    }
+    return slot;
+}
+
+typedef struct hmap_cuckoo_internal_node_s {
+    size_t bucket;
+    int parent;       // index of the node whose item moves into this bucket, -1 for the two candidate buckets
+    int parent_slot;  // slot of the moving item in the bucket of the parent node
+} hmap_cuckoo_internal_node_t;
+
+/**
+ * internal use only: place an item with the given hash in one of its buckets, moving other items to their alternative
+ * bucket if needed. Return false if no free slot was found within HMAP_CUCKOO_SEARCH_LIMIT buckets.
+ */
+bool hmap_cuckoo_internal_place(hmap_cuckoo_t* c, size_t hash, hmapitem_t* i) {
+    hmap_cuckoo_internal_node_t nodes[HMAP_CUCKOO_SEARCH_LIMIT];
+    size_t nodes_length = 0;
+
+    nodes[nodes_length++] = (hmap_cuckoo_internal_node_t){hmap_cuckoo_internal_first(c, hash), -1, -1};
+    size_t second = hmap_cuckoo_internal_second(c, hash);
+    if (second != nodes[0].bucket) {
+        nodes[nodes_length++] = (hmap_cuckoo_internal_node_t){second, -1, -1};
+    }
+
+    // breadth first search for the shortest path to a free slot
+    int found = -1;
+    size_t free_slot = HMAP_CUCKOO_BUCKET_SLOTS;
+    for (size_t n = 0; n < nodes_length && found < 0; n++) {
+        hmap_cuckoo_bucket_t* b = &c->buckets[nodes[n].bucket];
+        free_slot = hmap_cuckoo_internal_free_slot(b);
+        if (free_slot < HMAP_CUCKOO_BUCKET_SLOTS) {
+            found = (int)n;
+            break;
+        }
+
+        for (size_t s = 0; s < HMAP_CUCKOO_BUCKET_SLOTS && nodes_length < HMAP_CUCKOO_SEARCH_LIMIT; s++) {
+            size_t alternative = hmap_cuckoo_internal_alternative(c, b->hashes[s], nodes[n].bucket);
+
+            // a path must not visit a bucket twice, an item would be moved out of a slot which was filled before
+            bool visited = false;
+            for (int p = (int)n; p >= 0 && !visited; p = nodes[p].parent) {
+                visited = nodes[p].bucket == alternative;
+            }
+            if (!visited) {
+                nodes[nodes_length++] = (hmap_cuckoo_internal_node_t){alternative, (int)n, (int)s};
+            }
+        }
+    }
+
+    if (found < 0) {
+        return false;
+    }
+
+    // move the items along the path backwards, every move frees the slot the next one fills
+    int n = found;
+    while (nodes[n].parent >= 0) {
+        hmap_cuckoo_bucket_t* to = &c->buckets[nodes[n].bucket];
+        hmap_cuckoo_bucket_t* from = &c->buckets[nodes[nodes[n].parent].bucket];
+        size_t from_slot = (size_t)nodes[n].parent_slot;
+
+        to->hashes[free_slot] = from->hashes[from_slot];
+        to->items[free_slot] = from->items[from_slot];
+        from->items[from_slot] = NULL;
+
+        free_slot = from_slot;
+        n = nodes[n].parent;
+    }
+
+    hmap_cuckoo_bucket_t* b = &c->buckets[nodes[n].bucket];
+    b->hashes[free_slot] = hash;
+    b->items[free_slot] = i;
+    return true;
+}
+
+/**
+ * internal use only: append an item to the stash.
+ */
+void hmap_cuckoo_internal_stash(hmap_cuckoo_t* c, hmapitem_t* i) {
+    if (c->stash_length == c->stash_capacity) {
+        c->stash_capacity = c->stash_capacity == 0 ? 4 : c->stash_capacity * 2;
+        c->stash = realloc(c->stash, c->stash_capacity * sizeof(hmapitem_t*));
+        assert(c->stash != NULL);
+    }
+    c->stash[c->stash_length++] = i;
+}
+
+/**
+ * internal use only: move all items into a bucket array with the given number of buckets.
+ */
+void hmap_cuckoo_internal_resize(hmap_cuckoo_t* c, size_t buckets_length) {
+    hmap_cuckoo_bucket_t* old_buckets = c->buckets;
+    size_t old_buckets_length = c->buckets_length;
+    hmapitem_t** old_stash = c->stash;
+    size_t old_stash_length = c->stash_length;
+
+    c->buckets = hmap_cuckoo_internal_alloc_buckets(buckets_length);
+    c->buckets_length = buckets_length;
+    c->stash = NULL;
+    c->stash_length = 0;
+    c->stash_capacity = 0;
+
+    for (size_t b = 0; b < old_buckets_length; b++) {
+        for (size_t s = 0; s < HMAP_CUCKOO_BUCKET_SLOTS; s++) {
+            hmapitem_t* i = old_buckets[b].items[s];
+            if (i != NULL && !hmap_cuckoo_internal_place(c, old_buckets[b].hashes[s], i)) {
+                hmap_cuckoo_internal_stash(c, i);
+            }
+        }
+    }
+    for (size_t k = 0; k < old_stash_length; k++) {
+        hmapitem_t* i = old_stash[k];
+        if (!hmap_cuckoo_internal_place(c, c->hash(i->key), i)) {
+            hmap_cuckoo_internal_stash(c, i);
+        }
+    }
+
+    free(old_buckets);
+    free(old_stash);
+}
+
+/**
+ * internal use only: return a pointer to the slot holding the item associated with key, NULL if there is none.
+ */
+hmapitem_t** hmap_cuckoo_internal_find(hmap_cuckoo_t* c, void* key, size_t hash) {
+    hmap_cuckoo_bucket_t* first = &c->buckets[hmap_cuckoo_internal_first(c, hash)];
+    hmap_cuckoo_bucket_t* second = &c->buckets[hmap_cuckoo_internal_second(c, hash)];
+
+    for (size_t s = 0; s < HMAP_CUCKOO_BUCKET_SLOTS; s++) {
+        if (first->items[s] != NULL && first->hashes[s] == hash && c->equals(first->items[s]->key, key)) {
+            return &first->items[s];
+        }
+    }
+    for (size_t s = 0; s < HMAP_CUCKOO_BUCKET_SLOTS; s++) {
+        if (second->items[s] != NULL && second->hashes[s] == hash && c->equals(second->items[s]->key, key)) {
+            return &second->items[s];
+        }
+    }
+    for (size_t k = 0; k < c->stash_length; k++) {
+        if (c->equals(c->stash[k]->key, key)) {
+            return &c->stash[k];
+        }
+    }
+    return NULL;
+}
+
+void hmap_cuckoo_init(hmap_cuckoo_t* c, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals)) {
+    hmap_cuckoo_init_capacity(c, hash, equals, HMAP_INITIAL_CAPACITY);
+}
+
+void hmap_cuckoo_init_capacity(hmap_cuckoo_t* c, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t capacity) {
+    assert(c != NULL);
+    assert(hash != NULL);
+    assert(equals != NULL);
+
+    c->max_load = HMAP_CUCKOO_MAX_LOAD;
+    c->length = 0;
+    c->buckets_length = hmap_cuckoo_internal_buckets_for(c, capacity);
+    c->buckets = hmap_cuckoo_internal_alloc_buckets(c->buckets_length);
+    c->stash_length = 0;
+    c->stash_capacity = 0;
+    c->stash = NULL;
+    c->hash = hash;
+    c->equals = equals;
+}
+
+void hmap_cuckoo_max_load(hmap_cuckoo_t* c, float max_load) {
+    assert(c != NULL);
+    assert(max_load > 0 && max_load <= 1);
+
+    c->max_load = max_load;
+    size_t buckets_length = hmap_cuckoo_internal_buckets_for(c, c->length);
+    if (buckets_length > c->buckets_length) {
+        hmap_cuckoo_internal_resize(c, buckets_length);
+    }
+}
+
+void hmap_cuckoo_destroy(hmap_cuckoo_t* c) {
+    assert(c != NULL);
+
+    free(c->buckets);
+    free(c->stash);
+    memset(c, 0, sizeof(hmap_cuckoo_t));
+}
+
+size_t hmap_cuckoo_length(hmap_cuckoo_t* c) {
+    assert(c != NULL);
+    return c->length;
+}
+
+size_t hmap_cuckoo_capacity(hmap_cuckoo_t* c) {
+    assert(c != NULL);
+    return c->buckets_length * HMAP_CUCKOO_BUCKET_SLOTS;
+}
+
+float hmap_cuckoo_stats_load_factor(hmap_cuckoo_t* c) {
+    assert(c != NULL);
+    return c->length / (float)hmap_cuckoo_capacity(c);
+}
+
+size_t hmap_cuckoo_stats_stash_length(hmap_cuckoo_t* c) {
+    assert(c != NULL);
+    return c->stash_length;
+}
+
+void hmap_cuckoo_set(hmap_cuckoo_t* c, void* key, hmapitem_t* i) {
+    assert(c != NULL);
+    assert(i != NULL);
+    assert(i->map_ptr == NULL);
+    assert(i->key == NULL);
+
+    size_t hash = c->hash(key);
+
+    hmapitem_t** existing = hmap_cuckoo_internal_find(c, key, hash);
+    if (existing != NULL) {
+        (*existing)->map_ptr = NULL;
+        (*existing)->key = NULL;
+        *existing = i;
+        i->map_ptr = c;
+        i->key = key;
+        return;
+    }
+
+    if (c->length + 1 > hmap_cuckoo_capacity(c) * c->max_load) {
+        hmap_cuckoo_internal_resize(c, c->buckets_length * 2);
+    }
+
+    i->map_ptr = c;
+    i->key = key;
+    while (!hmap_cuckoo_internal_place(c, hash, i)) {
+        // a failing search in a lightly loaded table hints at colliding hash values, growing would not help
+        if (c->length < hmap_cuckoo_capacity(c) / 2) {
+            hmap_cuckoo_internal_stash(c, i);
+            break;
+        }
+        hmap_cuckoo_internal_resize(c, c->buckets_length * 2);
+    }
+    c->length++;
+}
+
+bool hmap_cuckoo_has(hmap_cuckoo_t* c, void* key) {
+    assert(c != NULL);
+
+    return hmap_cuckoo_get(c, key) != NULL;
+}
+
+hmapitem_t* hmap_cuckoo_get(hmap_cuckoo_t* c, void* key) {
+    assert(c != NULL);
+
+    hmapitem_t** i_ptr = hmap_cuckoo_internal_find(c, key, c->hash(key));
+    return i_ptr == NULL ? NULL : *i_ptr;
+}
+
+hmapitem_t* hmap_cuckoo_delete(hmap_cuckoo_t* c, void* key) {
+    assert(c != NULL);
+
+    hmapitem_t** i_ptr = hmap_cuckoo_internal_find(c, key, c->hash(key));
+    if (i_ptr == NULL) {
+        return NULL;
+    }
+
+    hmapitem_t* item = *i_ptr;
+    if (i_ptr >= c->stash && i_ptr < c->stash + c->stash_length) {
+        *i_ptr = c->stash[--c->stash_length];
+    } else {
+        *i_ptr = NULL;
+    }
+
+    item->map_ptr = NULL;
+    item->key = NULL;
+    c->length--;
+    return item;
+}
+
+void hmap_cuckoo_foreach(hmap_cuckoo_t* c, void (*iter)(void* key, hmapitem_t*, void*), void* userdata) {
+    assert(c != NULL);
+    assert(iter != NULL);
+
+    for (size_t b = 0; b < c->buckets_length; b++) {
+        for (size_t s = 0; s < HMAP_CUCKOO_BUCKET_SLOTS; s++) {
+            hmapitem_t* i = c->buckets[b].items[s];
+            if (i != NULL) {
+                iter(i->key, i, userdata);
+            }
+        }
+    }
+    for (size_t k = 0; k < c->stash_length; k++) {
+        iter(c->stash[k]->key, c->stash[k], userdata);
+    }
+}
+
+bool hmapitem_in_cuckoo(hmapitem_t* i, hmap_cuckoo_t* c) {
+    assert(i != NULL);
+    assert(c != NULL);
+    return i->map_ptr == c;
+}
+
+#endif
+#endif
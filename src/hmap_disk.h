@@ -0,0 +1,681 @@
+/*
+
+# Hash Map Disk
+
+A map of byte string keys to byte string values for data sets larger than the available memory. Keys are hash
+partitioned into a fixed number of partitions, every partition is stored as one segment file in the format of
+hmap_mapped.h inside a directory. Partitions which are written to are loaded into a regular hmap_t and stay resident
+while the memory they take fits into the memory budget, the least recently used resident partitions are written back
+to their segment files and freed when it does not. Lookups in partitions which are not resident are answered from the
+mapped segment file without loading the partition, so reads of cold data only cost page cache.
+
+The map owns copies of all keys and values. Keys are hashed with hmap_mapped_hash_bytes to find their partition and in
+the resident maps. Segment files hash keys with a random key of their own (see hmap_mapped.h), so keys with the same
+hmap_mapped_hash_bytes value are written back like any others.
+
+Closing the map writes all modified partitions, opening the same directory with the same number of partitions again
+picks them up.
+
+hmap_disk.h needs a POSIX system.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_DISK` before. Do this only once e.g. in
+main.c. The implementations of hmap.h, hmap_frozen.h and hmap_mapped.h are needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_FROZEN
+#include "hmap_frozen.h"
+#define IMPL_HMAP_MAPPED
+#include "hmap_mapped.h"
+#define IMPL_HMAP_DISK
+#include "hmap_disk.h"
+```
+
+After that include hmap_disk.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_disk.h"
+```
+
+### Basic Usage
+
+```
+hmap_disk_t visits;
+if (hmap_disk_open(&visits, "visits.d", 256, 512 * 1024 * 1024) != 0) {
+    perror("hmap_disk_open");
+}
+
+uint64_t count = 1;
+hmap_disk_set(&visits, url, strlen(url), &count, sizeof(count));
+
+const uint64_t* c = hmap_disk_get(&visits, url, strlen(url), NULL);
+
+hmap_disk_close(&visits);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_DISK_H
+#define DS_HMAP_DISK_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hmap.h"
+#include "hmap_mapped.h"
+
+typedef struct hmap_disk_key_s {
+    const void* bytes;
+    size_t length;
+} hmap_disk_key_t;
+
+typedef struct hmap_disk_entry_s {
+    hmap_disk_key_t key;  // points into bytes
+    size_t value_length;
+    HMAPITEM_PROP();
+    char bytes[];  // key bytes followed by the 8 byte aligned value bytes
+} hmap_disk_entry_t;
+
+typedef struct hmap_disk_partition_s {
+    size_t length;
+    bool resident;  // map holds the entries
+    bool dirty;  // map differs from the segment file
+    bool on_disk;  // the segment file exists
+    bool mapped;  // segment is mapped for lookups, only while not resident
+    hmap_t map;
+    hmap_mapped_t segment;
+    size_t entry_bytes;  // memory taken by the entries of map
+    uint64_t last_used;
+    size_t loads;
+    size_t evictions;
+} hmap_disk_partition_t;
+
+typedef struct hmap_disk_s {
+    char* directory;
+    char* path;  // scratch buffer for segment file paths
+    size_t memory_budget;
+    size_t resident_bytes;
+    uint64_t clock;
+    int write_back_error;  // errno of the last failed eviction in hmap_disk_set or hmap_disk_delete, 0 if reported
+    size_t partitions_length;
+    hmap_disk_partition_t* partitions;
+} hmap_disk_t;
+
+/**
+ * Open the map stored in directory, which is created if it does not exist. partitions has to be the same every time a
+ * directory is opened. Resident partitions are evicted when their memory exceeds memory_budget bytes, the partition
+ * currently written to always stays resident. Return 0 on success, -1 on failure with errno set.
+ */
+int hmap_disk_open(hmap_disk_t* d, const char* directory, size_t partitions, size_t memory_budget);
+
+/**
+ * Write all modified partitions and free all resources. The resources are freed even if writing fails. Return 0 on
+ * success, -1 on failure with errno set.
+ */
+int hmap_disk_close(hmap_disk_t* d);
+
+/**
+ * Write all modified partitions to their segment files. They stay resident. Return 0 on success, -1 on failure with
+ * errno set.
+ */
+int hmap_disk_flush(hmap_disk_t* d);
+
+/**
+ * Set the memory budget in bytes and evict partitions until it is met. Return 0 on success, -1 on failure with errno
+ * set.
+ */
+int hmap_disk_memory_budget(hmap_disk_t* d, size_t memory_budget);
+
+/**
+ * Return the number of entries in the map.
+ */
+size_t hmap_disk_length(hmap_disk_t* d);
+
+/**
+ * Associate a copy of the value bytes with a copy of the key bytes. Possible existing associations will be
+ * overwritten. Loads the partition of the key if it is not resident and evicts other partitions if the memory budget
+ * is exceeded afterwards. Return 0 on success, -1 on failure with errno set. A failed write back of an evicted
+ * partition does not fail the call, the partition stays resident and the error is reported by
+ * hmap_disk_write_back_error.
+ */
+int hmap_disk_set(hmap_disk_t* d, const void* key, size_t key_length, const void* value, size_t value_length);
+
+/**
+ * Return a pointer to the value bytes associated with the key bytes and store their number in *value_length if
+ * value_length is not NULL. Null if the key has no association. The pointer is valid until the next call to
+ * hmap_disk_set, hmap_disk_delete, hmap_disk_memory_budget or hmap_disk_close.
+ */
+const void* hmap_disk_get(hmap_disk_t* d, const void* key, size_t key_length, size_t* value_length);
+
+/**
+ * Return true if the key bytes are associated with a value in the map, false otherwise.
+ */
+bool hmap_disk_has(hmap_disk_t* d, const void* key, size_t key_length);
+
+/**
+ * Remove the association of the key bytes. Return 1 if there was one, 0 if there was none and -1 on failure with errno
+ * set. Failed write backs of evicted partitions are handled like in hmap_disk_set.
+ */
+int hmap_disk_delete(hmap_disk_t* d, const void* key, size_t key_length);
+
+/**
+ * Return the errno value of the last failed write back of a partition evicted by hmap_disk_set or hmap_disk_delete and
+ * clear it, 0 if there was none since the last call. The partition stays resident and is written back by a later
+ * eviction, hmap_disk_flush or hmap_disk_close.
+ */
+int hmap_disk_write_back_error(hmap_disk_t* d);
+
+/**
+ * Return the number of resident partitions.
+ */
+size_t hmap_disk_stats_resident_partitions(hmap_disk_t* d);
+
+/**
+ * Return the number of bytes taken by the entries and slot arrays of all resident partitions.
+ */
+size_t hmap_disk_stats_resident_bytes(hmap_disk_t* d);
+
+/**
+ * Return the number of times partitions have been loaded from their segment files.
+ */
+size_t hmap_disk_stats_loads(hmap_disk_t* d);
+
+/**
+ * Return the number of times partitions have been evicted.
+ */
+size_t hmap_disk_stats_evictions(hmap_disk_t* d);
+
+/**
+ * Return the number of entries in the partition with the given index.
+ */
+size_t hmap_disk_stats_partition_length(hmap_disk_t* d, size_t partition);
+
+/**
+ * Return true if the partition with the given index is resident.
+ */
+bool hmap_disk_stats_partition_resident(hmap_disk_t* d, size_t partition);
+
+#if defined(IMPL_HMAP_DISK) || defined(_CLANGD)
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * internal use only: hash function of the resident maps.
+ */
+size_t hmap_disk_internal_hash(void* key) {
+    hmap_disk_key_t* k = key;
+    return hmap_mapped_hash_bytes(k->bytes, k->length);
+}
+
+/**
+ * internal use only: equals function of the resident maps.
+ */
+bool hmap_disk_internal_equals(void* a, void* b) {
+    hmap_disk_key_t* ka = a;
+    hmap_disk_key_t* kb = b;
+    return ka->length == kb->length && memcmp(ka->bytes, kb->bytes, ka->length) == 0;
+}
+
+/**
+ * internal use only: key bytes of an entry for hmap_mapped_write.
+ */
+size_t hmap_disk_internal_key_bytes(void* key, const void** bytes) {
+    hmap_disk_key_t* k = key;
+    *bytes = k->bytes;
+    return k->length;
+}
+
+/**
+ * internal use only: value bytes of an entry for hmap_mapped_write.
+ */
+size_t hmap_disk_internal_value_bytes(void* item, const void** bytes) {
+    hmap_disk_entry_t* e = HMAPITEM_AS(hmap_disk_entry_t, item);
+    *bytes = e->bytes + hmap_mapped_internal_align(e->key.length);
+    return e->value_length;
+}
+
+/**
+ * internal use only: return the partition of the key bytes.
+ */
+hmap_disk_partition_t* hmap_disk_internal_partition(hmap_disk_t* d, hmap_disk_key_t* key) {
+    return &d->partitions[hmap_hash_mix(hmap_disk_internal_hash(key)) % d->partitions_length];
+}
+
+/**
+ * internal use only: write the segment file path of a partition to d->path and return it.
+ */
+const char* hmap_disk_internal_path(hmap_disk_t* d, hmap_disk_partition_t* p) {
+    sprintf(d->path, "%s/%06zu.hmap", d->directory, (size_t)(p - d->partitions));
+    return d->path;
+}
+
+/**
+ * internal use only: return the memory taken by a resident partition.
+ */
+size_t hmap_disk_internal_footprint(hmap_disk_partition_t* p) {
+    return p->entry_bytes + hmap_capacity(&p->map) * sizeof(hmapitem_t*);
+}
+
+/**
+ * internal use only: allocate an entry holding copies of key and value.
+ */
+hmap_disk_entry_t* hmap_disk_internal_entry(const void* key, size_t key_length, const void* value,
+                                            size_t value_length) {
+    size_t value_offset = hmap_mapped_internal_align(key_length);
+    hmap_disk_entry_t* e = malloc(sizeof(hmap_disk_entry_t) + value_offset + value_length);
+    assert(e != NULL);
+    memcpy(e->bytes, key, key_length);
+    if (value_length > 0) {
+        memcpy(e->bytes + value_offset, value, value_length);
+    }
+    e->key.bytes = e->bytes;
+    e->key.length = key_length;
+    e->value_length = value_length;
+    hmapitem_init(HMAPITEM_OF(hmap_disk_entry_t, e));
+    return e;
+}
+
+/**
+ * internal use only: return the memory taken by an entry.
+ */
+size_t hmap_disk_internal_entry_size(hmap_disk_entry_t* e) {
+    return sizeof(hmap_disk_entry_t) + hmap_mapped_internal_align(e->key.length) + e->value_length;
+}
+
+/**
+ * internal use only: add an entry to a resident partition, replacing an entry with an equal key.
+ */
+void hmap_disk_internal_put(hmap_disk_partition_t* p, hmap_disk_entry_t* e) {
+    hmapitem_t* old = hmap_delete(&p->map, &e->key);
+    if (old != NULL) {
+        hmap_disk_entry_t* o = HMAPITEM_AS(hmap_disk_entry_t, old);
+        p->entry_bytes -= hmap_disk_internal_entry_size(o);
+        free(o);
+    }
+    hmap_set(&p->map, &e->key, HMAPITEM_OF(hmap_disk_entry_t, e));
+    p->entry_bytes += hmap_disk_internal_entry_size(e);
+    p->length = hmap_length(&p->map);
+}
+
+/**
+ * internal use only: hmap_mapped_foreach callback copying a record into a resident partition.
+ */
+void hmap_disk_internal_load_record(const void* key, size_t key_length, const void* value, size_t value_length,
+                                    void* userdata) {
+    hmap_disk_internal_put(userdata, hmap_disk_internal_entry(key, key_length, value, value_length));
+}
+
+/**
+ * internal use only: map the segment file of a partition which is not resident. Return 0 on success, an errno value
+ * otherwise.
+ */
+int hmap_disk_internal_map(hmap_disk_t* d, hmap_disk_partition_t* p) {
+    if (!p->mapped && hmap_mapped_open(&p->segment, hmap_disk_internal_path(d, p)) != 0) {
+        return errno;
+    }
+    p->mapped = true;
+    return 0;
+}
+
+/**
+ * internal use only: make a partition resident. Return 0 on success, an errno value otherwise.
+ */
+int hmap_disk_internal_load(hmap_disk_t* d, hmap_disk_partition_t* p) {
+    if (p->resident) {
+        return 0;
+    }
+
+    int error = p->on_disk ? hmap_disk_internal_map(d, p) : 0;
+    if (error != 0) {
+        return error;
+    }
+
+    hmap_init(&p->map, hmap_disk_internal_hash, hmap_disk_internal_equals);
+    p->entry_bytes = 0;
+    if (p->mapped) {
+        hmap_mapped_foreach(&p->segment, hmap_disk_internal_load_record, p);
+        hmap_mapped_close(&p->segment);
+        p->mapped = false;
+        p->loads++;
+    }
+
+    p->resident = true;
+    p->dirty = false;
+    d->resident_bytes += hmap_disk_internal_footprint(p);
+    return 0;
+}
+
+/**
+ * internal use only: write a resident partition to its segment file if it was modified. Return 0 on success, an errno
+ * value otherwise.
+ */
+int hmap_disk_internal_write(hmap_disk_t* d, hmap_disk_partition_t* p) {
+    if (!p->resident || !p->dirty) {
+        return 0;
+    }
+    if (hmap_mapped_write(&p->map, hmap_disk_internal_path(d, p), hmap_disk_internal_key_bytes,
+                          hmap_disk_internal_value_bytes) != 0) {
+        return errno;
+    }
+    p->dirty = false;
+    p->on_disk = true;
+    return 0;
+}
+
+/**
+ * internal use only: write a resident partition if needed and free its entries. Return 0 on success, an errno value
+ * otherwise, the partition stays resident in that case.
+ */
+int hmap_disk_internal_evict(hmap_disk_t* d, hmap_disk_partition_t* p) {
+    int error = hmap_disk_internal_write(d, p);
+    if (error != 0) {
+        return error;
+    }
+
+    d->resident_bytes -= hmap_disk_internal_footprint(p);
+    for (size_t i = 0; i < p->map.capacity; i++) {
+        if (p->map.data[i] != NULL) {
+            free(HMAPITEM_AS(hmap_disk_entry_t, p->map.data[i]));
+        }
+    }
+    hmap_destroy(&p->map);
+    p->entry_bytes = 0;
+    p->resident = false;
+    p->evictions++;
+    return 0;
+}
+
+/**
+ * internal use only: evict the least recently used partitions except keep until the memory budget is met. Return 0 on
+ * success, an errno value otherwise.
+ */
+int hmap_disk_internal_enforce_budget(hmap_disk_t* d, hmap_disk_partition_t* keep) {
+    while (d->resident_bytes > d->memory_budget) {
+        hmap_disk_partition_t* lru = NULL;
+        for (size_t k = 0; k < d->partitions_length; k++) {
+            hmap_disk_partition_t* p = &d->partitions[k];
+            if (p->resident && p != keep && (lru == NULL || p->last_used < lru->last_used)) {
+                lru = p;
+            }
+        }
+        if (lru == NULL) {
+            return 0;
+        }
+
+        int error = hmap_disk_internal_evict(d, lru);
+        if (error != 0) {
+            return error;
+        }
+    }
+    return 0;
+}
+
+int hmap_disk_open(hmap_disk_t* d, const char* directory, size_t partitions, size_t memory_budget) {
+    assert(d != NULL);
+    assert(directory != NULL);
+    assert(partitions > 0);
+
+    memset(d, 0, sizeof(hmap_disk_t));
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    d->directory = malloc(strlen(directory) + 1);
+    d->path = malloc(strlen(directory) + 32);
+    d->partitions = calloc(partitions, sizeof(hmap_disk_partition_t));
+    assert(d->directory != NULL && d->path != NULL && d->partitions != NULL);
+    strcpy(d->directory, directory);
+    d->partitions_length = partitions;
+    d->memory_budget = memory_budget;
+
+    // existing segment files are mapped right away, their lengths are needed for hmap_disk_length
+    for (size_t k = 0; k < partitions; k++) {
+        hmap_disk_partition_t* p = &d->partitions[k];
+        int error = hmap_disk_internal_map(d, p);
+        if (error == ENOENT) {
+            continue;
+        }
+        if (error != 0) {
+            hmap_disk_close(d);
+            errno = error;
+            return -1;
+        }
+        p->on_disk = true;
+        p->length = hmap_mapped_length(&p->segment);
+    }
+    return 0;
+}
+
+int hmap_disk_close(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    int error = 0;
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        hmap_disk_partition_t* p = &d->partitions[k];
+        if (p->resident) {
+            int e = hmap_disk_internal_write(d, p);
+            error = error == 0 ? e : error;
+            p->dirty = false;
+            hmap_disk_internal_evict(d, p);
+        }
+        if (p->mapped) {
+            hmap_mapped_close(&p->segment);
+        }
+    }
+
+    free(d->directory);
+    free(d->path);
+    free(d->partitions);
+    memset(d, 0, sizeof(hmap_disk_t));
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int hmap_disk_flush(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        int error = hmap_disk_internal_write(d, &d->partitions[k]);
+        if (error != 0) {
+            errno = error;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int hmap_disk_memory_budget(hmap_disk_t* d, size_t memory_budget) {
+    assert(d != NULL);
+
+    d->memory_budget = memory_budget;
+    int error = hmap_disk_internal_enforce_budget(d, NULL);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+size_t hmap_disk_length(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    size_t length = 0;
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        length += d->partitions[k].length;
+    }
+    return length;
+}
+
+int hmap_disk_set(hmap_disk_t* d, const void* key, size_t key_length, const void* value, size_t value_length) {
+    assert(d != NULL);
+
+    hmap_disk_key_t k = {key, key_length};
+    hmap_disk_partition_t* p = hmap_disk_internal_partition(d, &k);
+    int error = hmap_disk_internal_load(d, p);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    d->resident_bytes -= hmap_disk_internal_footprint(p);
+    hmap_disk_internal_put(p, hmap_disk_internal_entry(key, key_length, value, value_length));
+    d->resident_bytes += hmap_disk_internal_footprint(p);
+    p->dirty = true;
+    p->last_used = ++d->clock;
+
+    // the entry is stored, failing to write back another partition must not report the set as failed
+    error = hmap_disk_internal_enforce_budget(d, p);
+    d->write_back_error = error != 0 ? error : d->write_back_error;
+    return 0;
+}
+
+const void* hmap_disk_get(hmap_disk_t* d, const void* key, size_t key_length, size_t* value_length) {
+    assert(d != NULL);
+
+    hmap_disk_key_t k = {key, key_length};
+    hmap_disk_partition_t* p = hmap_disk_internal_partition(d, &k);
+
+    if (!p->resident) {
+        if (!p->on_disk || hmap_disk_internal_map(d, p) != 0) {
+            return NULL;
+        }
+        return hmap_mapped_get(&p->segment, key, key_length, value_length);
+    }
+
+    p->last_used = ++d->clock;
+    hmapitem_t* i = hmap_get(&p->map, &k);
+    if (i == NULL) {
+        return NULL;
+    }
+
+    hmap_disk_entry_t* e = HMAPITEM_AS(hmap_disk_entry_t, i);
+    if (value_length != NULL) {
+        *value_length = e->value_length;
+    }
+    return e->bytes + hmap_mapped_internal_align(e->key.length);
+}
+
+bool hmap_disk_has(hmap_disk_t* d, const void* key, size_t key_length) {
+    assert(d != NULL);
+
+    return hmap_disk_get(d, key, key_length, NULL) != NULL;
+}
+
+int hmap_disk_delete(hmap_disk_t* d, const void* key, size_t key_length) {
+    assert(d != NULL);
+
+    hmap_disk_key_t k = {key, key_length};
+    hmap_disk_partition_t* p = hmap_disk_internal_partition(d, &k);
+
+    // a partition is only loaded if the key is actually there
+    if (!p->resident && !hmap_disk_has(d, key, key_length)) {
+        return 0;
+    }
+
+    int error = hmap_disk_internal_load(d, p);
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    hmapitem_t* i = hmap_delete(&p->map, &k);
+    if (i == NULL) {
+        return 0;
+    }
+
+    hmap_disk_entry_t* e = HMAPITEM_AS(hmap_disk_entry_t, i);
+    d->resident_bytes -= hmap_disk_internal_footprint(p);
+    p->entry_bytes -= hmap_disk_internal_entry_size(e);
+    p->length = hmap_length(&p->map);
+    d->resident_bytes += hmap_disk_internal_footprint(p);
+    free(e);
+    p->dirty = true;
+    p->last_used = ++d->clock;
+
+    error = hmap_disk_internal_enforce_budget(d, p);
+    d->write_back_error = error != 0 ? error : d->write_back_error;
+    return 1;
+}
+
+int hmap_disk_write_back_error(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    int error = d->write_back_error;
+    d->write_back_error = 0;
+    return error;
+}
+
+size_t hmap_disk_stats_resident_partitions(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    size_t resident = 0;
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        resident += d->partitions[k].resident;
+    }
+    return resident;
+}
+
+size_t hmap_disk_stats_resident_bytes(hmap_disk_t* d) {
+    assert(d != NULL);
+    return d->resident_bytes;
+}
+
+size_t hmap_disk_stats_loads(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    size_t loads = 0;
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        loads += d->partitions[k].loads;
+    }
+    return loads;
+}
+
+size_t hmap_disk_stats_evictions(hmap_disk_t* d) {
+    assert(d != NULL);
+
+    size_t evictions = 0;
+    for (size_t k = 0; k < d->partitions_length; k++) {
+        evictions += d->partitions[k].evictions;
+    }
+    return evictions;
+}
+
+size_t hmap_disk_stats_partition_length(hmap_disk_t* d, size_t partition) {
+    assert(d != NULL);
+    assert(partition < d->partitions_length);
+    return d->partitions[partition].length;
+}
+
+bool hmap_disk_stats_partition_resident(hmap_disk_t* d, size_t partition) {
+    assert(d != NULL);
+    assert(partition < d->partitions_length);
+    return d->partitions[partition].resident;
+}
+
+#endif
+#endif
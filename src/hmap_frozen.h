@@ -0,0 +1,390 @@
+
+/*
+
+# Hash Map Frozen
+
+A read only map built from a populated hmap_t. hmap_freeze computes a minimal perfect hash function over the keys of
+the map, in the style of PTHash: the keys are split into buckets of HMAP_FROZEN_BUCKET_SIZE keys on average and every
+bucket gets a pilot value which moves all its keys to distinct, still free slots. The resulting table has exactly one
+slot per item and no empty slots.
+
+A lookup hashes the key, reads one pilot, reads one slot and calls equals once. Besides the item array the table needs
+32 / HMAP_FROZEN_BUCKET_SIZE bits per key for the pilots.
+
+Frozen maps use the hash and equals functions of the map they were built from. Keys with identical hash values can not
+be separated, hmap_freeze fails for such maps.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_FROZEN` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_FROZEN
+#include "hmap_frozen.h"
+```
+
+After that include hmap_frozen.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_frozen.h"
+```
+
+### Basic Usage
+
+```
+hmap_t m;
+hmap_init(&m, hmap_hash_str, hmap_equals_str);
+for (size_t i = 0; i < config_length; i++) {
+    hmap_set(&m, config[i].name, HMAPITEM_OF(option, &config[i]));
+}
+
+hmap_frozen_t options;
+if (hmap_freeze(&m, &options) != 0) {
+    // keep using m
+}
+hmap_destroy(&m);
+
+option* o = HMAP_FROZEN_GET(option, &options, "verbose");
+
+hmap_frozen_destroy(&options);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_FROZEN_H
+#define DS_HMAP_FROZEN_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hmap.h"
+
+/**
+ * The average number of keys per bucket. Larger buckets need less memory for pilots but take longer to build.
+ */
+#define HMAP_FROZEN_BUCKET_SIZE 4
+
+/**
+ * The number of seeds hmap_freeze tries before it gives up.
+ */
+#define HMAP_FROZEN_ATTEMPTS 8
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item using the default
+ * item property name.
+ */
+#define HMAP_FROZEN_GET(type, map, key) HMAP_FROZEN_GET_s(type, map, key, HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item.
+ */
+#define HMAP_FROZEN_GET_s(type, map, key, property_name) \
+    (hmap_frozen_has(map, key) ? HMAPITEM_AS_s(type, hmap_frozen_get(map, key), property_name) : NULL)
+
+typedef struct hmap_frozen_s {
+    size_t length;
+    size_t buckets_length;
+    size_t seed;
+    uint32_t* pilots;
+    hmapitem_t** items;
+    HMAP_HASH_TYPE(hash);
+    HMAP_EQUALS_TYPE(equals);
+} hmap_frozen_t;
+
+/**
+ * Build a frozen map from all items of m. On success the items are moved to frozen, m is left empty but initialized and
+ * 0 is returned. Return -1 if two keys have the same hash value or memory could not be allocated, in which case m is
+ * left untouched and frozen is not initialized.
+ */
+int hmap_freeze(hmap_t* m, hmap_frozen_t* frozen);
+
+/**
+ * Free all resources allocated by hmap_freeze.
+ */
+void hmap_frozen_destroy(hmap_frozen_t* f);
+
+/**
+ * Return the number of items in the map.
+ */
+size_t hmap_frozen_length(hmap_frozen_t* f);
+
+/**
+ * Return true if the given key is associated with a value in the map, false otherwise.
+ */
+bool hmap_frozen_has(hmap_frozen_t* f, void* key);
+
+/**
+ * Return the item associated with the given key. Null if the key has no association.
+ */
+hmapitem_t* hmap_frozen_get(hmap_frozen_t* f, void* key);
+
+/**
+ * Call iter on every key value entry in the map.
+ */
+void hmap_frozen_foreach(hmap_frozen_t* f, void (*iter)(void* key, hmapitem_t*, void*), void* userdata);
+
+#if defined(IMPL_HMAP_FROZEN) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * internal use only: return the number of buckets used for n keys.
+ */
+size_t hmap_frozen_internal_buckets(size_t n) {
+    size_t buckets = (n + HMAP_FROZEN_BUCKET_SIZE - 1) / HMAP_FROZEN_BUCKET_SIZE;
+    return buckets == 0 ? 1 : buckets;
+}
+
+/**
+ * internal use only: return the slot of a seeded and mixed hash value for the given pilot.
+ */
+size_t hmap_frozen_internal_slot(size_t mixed, uint32_t pilot, size_t length) {
+    return hmap_hash_mix(mixed ^ ((size_t)pilot * (size_t)0x9E3779B97F4A7C15ull)) % length;
+}
+
+/**
+ * internal use only: try to find pilots for all buckets using the given seed and store the slot of hashes[k] in
+ * positions[k]. Return 0 on success, 1 if a pilot search exceeded its limit and -1 if two hashes of a bucket are the
+ * same.
+ */
+int hmap_frozen_internal_place(size_t n, size_t seed, size_t* hashes, uint32_t* pilots, size_t* positions,
+                               size_t* mixed, size_t* order, size_t* offsets, size_t* by_size, bool* taken,
+                               size_t* slots) {
+    size_t buckets = hmap_frozen_internal_buckets(n);
+
+    for (size_t k = 0; k < n; k++) {
+        mixed[k] = hmap_hash_mix(hashes[k] ^ seed);
+    }
+
+    // counting sort of the keys by bucket
+    memset(offsets, 0, (buckets + 1) * sizeof(size_t));
+    for (size_t k = 0; k < n; k++) {
+        offsets[mixed[k] % buckets + 1]++;
+    }
+    size_t largest = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        largest = offsets[b + 1] > largest ? offsets[b + 1] : largest;
+        offsets[b + 1] += offsets[b];
+    }
+    for (size_t k = 0; k < n; k++) {
+        size_t b = mixed[k] % buckets;
+        order[offsets[b]++] = k;
+    }
+    for (size_t b = buckets; b > 0; b--) {
+        offsets[b] = offsets[b - 1];
+    }
+    offsets[0] = 0;
+
+    // place the largest buckets first while most slots are still free, by counting sort of the buckets by size
+    size_t* sizes = slots;  // reuse the scratch memory, largest + 2 <= n + 2 entries are needed
+    memset(sizes, 0, (largest + 2) * sizeof(size_t));
+    for (size_t b = 0; b < buckets; b++) {
+        sizes[largest - (offsets[b + 1] - offsets[b]) + 1]++;
+    }
+    for (size_t s = 0; s <= largest; s++) {
+        sizes[s + 1] += sizes[s];
+    }
+    for (size_t b = 0; b < buckets; b++) {
+        by_size[sizes[largest - (offsets[b + 1] - offsets[b])]++] = b;
+    }
+
+    memset(taken, 0, n * sizeof(bool));
+    size_t limit = 16 * n + 1024 < UINT32_MAX ? 16 * n + 1024 : UINT32_MAX;
+
+    for (size_t k = 0; k < buckets; k++) {
+        size_t b = by_size[k];
+        size_t first = offsets[b];
+        size_t size = offsets[b + 1] - first;
+        pilots[b] = 0;
+        if (size == 0) {
+            continue;
+        }
+
+        for (size_t x = first; x < first + size; x++) {
+            for (size_t y = x + 1; y < first + size; y++) {
+                if (mixed[order[x]] == mixed[order[y]]) {
+                    return -1;
+                }
+            }
+        }
+
+        bool placed = false;
+        for (uint32_t pilot = 0; pilot < limit && !placed; pilot++) {
+            placed = true;
+            for (size_t x = 0; x < size && placed; x++) {
+                slots[x] = hmap_frozen_internal_slot(mixed[order[first + x]], pilot, n);
+                placed = !taken[slots[x]];
+                for (size_t y = 0; y < x && placed; y++) {
+                    placed = slots[x] != slots[y];
+                }
+            }
+
+            if (placed) {
+                for (size_t x = 0; x < size; x++) {
+                    taken[slots[x]] = true;
+                    positions[order[first + x]] = slots[x];
+                }
+                pilots[b] = pilot;
+            }
+        }
+        if (!placed) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * internal use only: build a minimal perfect hash function over n distinct hash values. pilots must have room for
+ * hmap_frozen_internal_buckets(n) entries, the slot of hashes[k] is stored in positions[k]. Return the seed used, which
+ * is needed for lookups, and 0 in *ret on success, -1 if two hash values are the same or memory could not be allocated.
+ */
+size_t hmap_frozen_internal_build(size_t n, size_t* hashes, uint32_t* pilots, size_t* positions, int* ret) {
+    size_t buckets = hmap_frozen_internal_buckets(n);
+    size_t scratch = n == 0 ? 1 : n;
+
+    size_t* mixed = malloc(scratch * sizeof(size_t));
+    size_t* order = malloc(scratch * sizeof(size_t));
+    size_t* offsets = malloc((buckets + 1) * sizeof(size_t));
+    size_t* by_size = malloc(buckets * sizeof(size_t));
+    size_t* slots = malloc((scratch + 2) * sizeof(size_t));
+    bool* taken = malloc(scratch * sizeof(bool));
+
+    size_t seed = 0;
+    *ret = -1;
+    if (mixed != NULL && order != NULL && offsets != NULL && by_size != NULL && slots != NULL && taken != NULL) {
+        *ret = 1;
+        for (size_t attempt = 0; attempt < HMAP_FROZEN_ATTEMPTS && *ret == 1; attempt++) {
+            seed = hmap_hash_mix(attempt);
+            *ret = hmap_frozen_internal_place(n, seed, hashes, pilots, positions, mixed, order, offsets, by_size,
+                                              taken, slots);
+        }
+        *ret = *ret == 0 ? 0 : -1;
+    }
+
+    free(mixed);
+    free(order);
+    free(offsets);
+    free(by_size);
+    free(slots);
+    free(taken);
+    return seed;
+}
+
+int hmap_freeze(hmap_t* m, hmap_frozen_t* frozen) {
+    assert(m != NULL);
+    assert(frozen != NULL);
+
+    hmap_frozen_t f;
+    f.length = m->length;
+    f.buckets_length = hmap_frozen_internal_buckets(m->length);
+    f.hash = m->hash;
+    f.equals = m->equals;
+    f.pilots = malloc(f.buckets_length * sizeof(uint32_t));
+    f.items = malloc((f.length == 0 ? 1 : f.length) * sizeof(hmapitem_t*));
+
+    size_t scratch = f.length == 0 ? 1 : f.length;
+    hmapitem_t** items = malloc(scratch * sizeof(hmapitem_t*));
+    size_t* hashes = malloc(scratch * sizeof(size_t));
+    size_t* positions = malloc(scratch * sizeof(size_t));
+
+    int ret = -1;
+    if (f.pilots != NULL && f.items != NULL && items != NULL && hashes != NULL && positions != NULL) {
+        size_t k = 0;
+        for (size_t i = 0; i < m->capacity; i++) {
+            if (m->data[i] != NULL) {
+                items[k] = m->data[i];
+                hashes[k] = m->hash(items[k]->key);
+                k++;
+            }
+        }
+
+        f.seed = hmap_frozen_internal_build(f.length, hashes, f.pilots, positions, &ret);
+        for (k = 0; k < f.length && ret == 0; k++) {
+            f.items[positions[k]] = items[k];
+        }
+    }
+
+    free(items);
+    free(hashes);
+    free(positions);
+
+    if (ret != 0) {
+        free(f.pilots);
+        free(f.items);
+        return -1;
+    }
+
+    for (size_t i = 0; i < f.length; i++) {
+        f.items[i]->map_ptr = frozen;
+    }
+    memset(m->data, 0, m->capacity * sizeof(hmapitem_t*));
+    m->length = 0;
+    if (m->filter != NULL) {
+        hmap_internal_filter_rebuild(m);
+    }
+
+    *frozen = f;
+    return 0;
+}
+
+void hmap_frozen_destroy(hmap_frozen_t* f) {
+    assert(f != NULL);
+
+    free(f->pilots);
+    free(f->items);
+    memset(f, 0, sizeof(hmap_frozen_t));
+}
+
+size_t hmap_frozen_length(hmap_frozen_t* f) {
+    assert(f != NULL);
+    return f->length;
+}
+
+bool hmap_frozen_has(hmap_frozen_t* f, void* key) {
+    assert(f != NULL);
+
+    return hmap_frozen_get(f, key) != NULL;
+}
+
+hmapitem_t* hmap_frozen_get(hmap_frozen_t* f, void* key) {
+    assert(f != NULL);
+
+    if (f->length == 0) {
+        return NULL;
+    }
+
+    size_t mixed = hmap_hash_mix(f->hash(key) ^ f->seed);
+    hmapitem_t* i = f->items[hmap_frozen_internal_slot(mixed, f->pilots[mixed % f->buckets_length], f->length)];
+    return f->equals(i->key, key) ? i : NULL;
+}
+
+void hmap_frozen_foreach(hmap_frozen_t* f, void (*iter)(void* key, hmapitem_t*, void*), void* userdata) {
+    assert(f != NULL);
+    assert(iter != NULL);
+
+    for (size_t i = 0; i < f->length; i++) {
+        iter(f->items[i]->key, f->items[i], userdata);
+    }
+}
+
+#endif
+#endif
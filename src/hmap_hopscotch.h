@@ -0,0 +1,491 @@
+
+/*
+
+# Hash Map Hopscotch
+
+A hopscotch hash table using the same intrusive hmapitem_t items and hash/equals functions as hmap_t. Every item lives
+within HMAP_HOPSCOTCH_NEIGHBORHOOD slots of its home slot and every home slot keeps a bitmap of the neighborhood slots
+holding its items. A lookup only checks the slots flagged in the bitmap of the home slot, a delete clears one slot and
+one bit and never has to move other items. Inserts which find the nearest free slot outside of the neighborhood move
+other items closer to their home slot until the free slot is close enough.
+
+Home slots are derived from hmap_hash_mix of the hash value, so weak hash functions still spread well. Keys whose hash
+values collide too often to fit into one neighborhood (e.g. because of a constant hash function) are kept in a small
+stash which is searched linearly.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_HOPSCOTCH` before. Do this only once e.g.
+in main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_HOPSCOTCH
+#include "hmap_hopscotch.h"
+```
+
+After that include hmap_hopscotch.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_hopscotch.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    char* name;
+    int age;
+    HMAPITEM_PROP();
+} person;
+
+hmap_hopscotch_t people;
+hmap_hopscotch_init(&people, hmap_hash_str, hmap_equals_str);
+
+person alex = {.name = "alex", .age = 34};
+hmap_hopscotch_set(&people, alex.name, HMAPITEM_OF(person, &alex));
+
+person* p = HMAP_HOPSCOTCH_GET(person, &people, "alex");
+
+hmap_hopscotch_destroy(&people);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_HOPSCOTCH_H
+#define DS_HMAP_HOPSCOTCH_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hmap.h"
+
+/**
+ * The number of slots an item may be away from its home slot, the width of the hop bitmaps.
+ */
+#define HMAP_HOPSCOTCH_NEIGHBORHOOD 32
+
+/**
+ * The default maximum load factor, the table doubles its capacity before it exceeds it.
+ */
+#define HMAP_HOPSCOTCH_MAX_LOAD 0.9f
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item using the default
+ * item property name.
+ */
+#define HMAP_HOPSCOTCH_GET(type, map, key) HMAP_HOPSCOTCH_GET_s(type, map, key, HMAP_DEFAULT_PROPERTY_NAME)
+
+/**
+ * Get the map item associated with the given key and return a pointer to the struct holding the item.
+ */
+#define HMAP_HOPSCOTCH_GET_s(type, map, key, property_name) \
+    (hmap_hopscotch_has(map, key) ? HMAPITEM_AS_s(type, hmap_hopscotch_get(map, key), property_name) : NULL)
+
+typedef struct hmap_hopscotch_slot_s {
+    uint32_t hop;  // bit k is set if slot (this + k) holds an item whose home is this slot
+    size_t hash;
+    hmapitem_t* item;
+} hmap_hopscotch_slot_t;
+
+typedef struct hmap_hopscotch_s {
+    float max_load;
+    size_t length;
+    size_t capacity;  // number of home slots, always a power of two
+    hmap_hopscotch_slot_t* slots;  // capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1 slots, neighborhoods never wrap
+    size_t stash_length;
+    size_t stash_capacity;
+    hmapitem_t** stash;
+    HMAP_HASH_TYPE(hash);
+    HMAP_EQUALS_TYPE(equals);
+} hmap_hopscotch_t;
+
+/**
+ * Initialize a hopscotch map with room for HMAP_INITIAL_CAPACITY items.
+ */
+void hmap_hopscotch_init(hmap_hopscotch_t* h, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals));
+
+/**
+ * Initialize a hopscotch map with room for at least capacity items before it grows for the first time.
+ */
+void hmap_hopscotch_init_capacity(hmap_hopscotch_t* h, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals),
+                                  size_t capacity);
+
+/**
+ * Set the maximum load factor (0, 1]. The map grows when an insert would exceed it.
+ */
+void hmap_hopscotch_max_load(hmap_hopscotch_t* h, float max_load);
+
+/**
+ * Free all resources allocated by a call to hmap_hopscotch_init*() functions.
+ */
+void hmap_hopscotch_destroy(hmap_hopscotch_t* h);
+
+/**
+ * Return the number of items in the map.
+ */
+size_t hmap_hopscotch_length(hmap_hopscotch_t* h);
+
+/**
+ * Return the number of home slots of the map.
+ */
+size_t hmap_hopscotch_capacity(hmap_hopscotch_t* h);
+
+/**
+ * Calculate the load factor (length/capacity = [0, 1]) of the map.
+ */
+float hmap_hopscotch_stats_load_factor(hmap_hopscotch_t* h);
+
+/**
+ * Return the number of items which could not be placed in the neighborhood of their home slot and are kept in the
+ * stash.
+ */
+size_t hmap_hopscotch_stats_stash_length(hmap_hopscotch_t* h);
+
+/**
+ * Associate the given key with the item and store it in the map. Possible existing associations will be overwritten.
+ */
+void hmap_hopscotch_set(hmap_hopscotch_t* h, void* key, hmapitem_t* i);
+
+/**
+ * Return true if the given key is associated with a value in the map, false otherwise.
+ */
+bool hmap_hopscotch_has(hmap_hopscotch_t* h, void* key);
+
+/**
+ * Return the item associated with the given key. Null if the key has no association.
+ */
+hmapitem_t* hmap_hopscotch_get(hmap_hopscotch_t* h, void* key);
+
+/**
+ * Remove an association between a key and an item from the map. Return a pointer to the disassociated item if a
+ * association existed, null otherwise.
+ */
+hmapitem_t* hmap_hopscotch_delete(hmap_hopscotch_t* h, void* key);
+
+/**
+ * Call iter on every key value entry in the map.
+ */
+void hmap_hopscotch_foreach(hmap_hopscotch_t* h, void (*iter)(void* key, hmapitem_t*, void*), void* userdata);
+
+/**
+ * Return true if the item has an association in the given hopscotch map.
+ */
+bool hmapitem_in_hopscotch(hmapitem_t* i, hmap_hopscotch_t* h);
+
+#if defined(IMPL_HMAP_HOPSCOTCH) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * internal use only: return the number of home slots needed to hold capacity items below the maximum load factor.
+ */
+size_t hmap_hopscotch_internal_capacity_for(hmap_hopscotch_t* h, size_t capacity) {
+    size_t slots = HMAP_HOPSCOTCH_NEIGHBORHOOD;
+    while (slots * h->max_load < capacity) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+/**
+ * internal use only: return the home slot of a hash value.
+ */
+size_t hmap_hopscotch_internal_home(hmap_hopscotch_t* h, size_t hash) {
+    return hmap_hash_mix(hash) & (h->capacity - 1);
+}
+
+/**
+ * internal use only: append an item to the stash.
+ */
+void hmap_hopscotch_internal_stash(hmap_hopscotch_t* h, hmapitem_t* i) {
+    if (h->stash_length == h->stash_capacity) {
+        h->stash_capacity = h->stash_capacity == 0 ? 4 : h->stash_capacity * 2;
+        h->stash = realloc(h->stash, h->stash_capacity * sizeof(hmapitem_t*));
+        assert(h->stash != NULL);
+    }
+    h->stash[h->stash_length++] = i;
+}
+
+/**
+ * internal use only: place an item with the given hash in the neighborhood of its home slot, moving other items closer
+ * to their home slots if needed. Return false if no free slot could be moved into the neighborhood.
+ */
+bool hmap_hopscotch_internal_place(hmap_hopscotch_t* h, size_t hash, hmapitem_t* i) {
+    size_t home = hmap_hopscotch_internal_home(h, hash);
+    size_t end = h->capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1;
+
+    size_t empty = home;
+    while (empty < end && h->slots[empty].item != NULL) {
+        empty++;
+    }
+    if (empty == end) {
+        return false;
+    }
+
+    while (empty - home >= HMAP_HOPSCOTCH_NEIGHBORHOOD) {
+        // move the item farthest from the empty slot whose home neighborhood still covers the empty slot
+        bool moved = false;
+        for (size_t candidate = empty - (HMAP_HOPSCOTCH_NEIGHBORHOOD - 1); candidate < empty && !moved; candidate++) {
+            uint32_t hop = h->slots[candidate].hop;
+            while (hop != 0) {
+                size_t offset = (size_t)__builtin_ctz(hop);
+                size_t from = candidate + offset;
+                if (from >= empty) {
+                    break;
+                }
+
+                h->slots[empty].hash = h->slots[from].hash;
+                h->slots[empty].item = h->slots[from].item;
+                h->slots[from].item = NULL;
+                h->slots[candidate].hop &= ~((uint32_t)1 << offset);
+                h->slots[candidate].hop |= (uint32_t)1 << (empty - candidate);
+
+                empty = from;
+                moved = true;
+                break;
+            }
+        }
+        if (!moved) {
+            return false;
+        }
+    }
+
+    h->slots[empty].hash = hash;
+    h->slots[empty].item = i;
+    h->slots[home].hop |= (uint32_t)1 << (empty - home);
+    return true;
+}
+
+/**
+ * internal use only: move all items into a slot array with the given number of home slots.
+ */
+void hmap_hopscotch_internal_resize(hmap_hopscotch_t* h, size_t capacity) {
+    hmap_hopscotch_slot_t* old_slots = h->slots;
+    size_t old_end = h->capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1;
+    hmapitem_t** old_stash = h->stash;
+    size_t old_stash_length = h->stash_length;
+
+    h->capacity = capacity;
+    h->slots = calloc(capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1, sizeof(hmap_hopscotch_slot_t));
+    assert(h->slots != NULL);
+    h->stash = NULL;
+    h->stash_length = 0;
+    h->stash_capacity = 0;
+
+    for (size_t s = 0; s < old_end; s++) {
+        hmapitem_t* i = old_slots[s].item;
+        if (i != NULL && !hmap_hopscotch_internal_place(h, old_slots[s].hash, i)) {
+            hmap_hopscotch_internal_stash(h, i);
+        }
+    }
+    for (size_t k = 0; k < old_stash_length; k++) {
+        hmapitem_t* i = old_stash[k];
+        if (!hmap_hopscotch_internal_place(h, h->hash(i->key), i)) {
+            hmap_hopscotch_internal_stash(h, i);
+        }
+    }
+
+    free(old_slots);
+    free(old_stash);
+}
+
+/**
+ * internal use only: return a pointer to the slot holding the item associated with key, NULL if there is none. If the
+ * item is in a neighborhood *home is set to its home slot, otherwise to SIZE_MAX.
+ */
+hmapitem_t** hmap_hopscotch_internal_find(hmap_hopscotch_t* h, void* key, size_t hash, size_t* home) {
+    *home = hmap_hopscotch_internal_home(h, hash);
+
+    uint32_t hop = h->slots[*home].hop;
+    while (hop != 0) {
+        hmap_hopscotch_slot_t* slot = &h->slots[*home + (size_t)__builtin_ctz(hop)];
+        if (slot->hash == hash && h->equals(slot->item->key, key)) {
+            return &slot->item;
+        }
+        hop &= hop - 1;
+    }
+
+    *home = SIZE_MAX;
+    for (size_t k = 0; k < h->stash_length; k++) {
+        if (h->equals(h->stash[k]->key, key)) {
+            return &h->stash[k];
+        }
+    }
+    return NULL;
+}
+
+void hmap_hopscotch_init(hmap_hopscotch_t* h, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals)) {
+    hmap_hopscotch_init_capacity(h, hash, equals, HMAP_INITIAL_CAPACITY);
+}
+
+void hmap_hopscotch_init_capacity(hmap_hopscotch_t* h, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals),
+                                  size_t capacity) {
+    assert(h != NULL);
+    assert(hash != NULL);
+    assert(equals != NULL);
+
+    h->max_load = HMAP_HOPSCOTCH_MAX_LOAD;
+    h->length = 0;
+    h->capacity = hmap_hopscotch_internal_capacity_for(h, capacity);
+    h->slots = calloc(h->capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1, sizeof(hmap_hopscotch_slot_t));
+    assert(h->slots != NULL);
+    h->stash_length = 0;
+    h->stash_capacity = 0;
+    h->stash = NULL;
+    h->hash = hash;
+    h->equals = equals;
+}
+
+void hmap_hopscotch_max_load(hmap_hopscotch_t* h, float max_load) {
+    assert(h != NULL);
+    assert(max_load > 0 && max_load <= 1);
+
+    h->max_load = max_load;
+    size_t capacity = hmap_hopscotch_internal_capacity_for(h, h->length);
+    if (capacity > h->capacity) {
+        hmap_hopscotch_internal_resize(h, capacity);
+    }
+}
+
+void hmap_hopscotch_destroy(hmap_hopscotch_t* h) {
+    assert(h != NULL);
+
+    free(h->slots);
+    free(h->stash);
+    memset(h, 0, sizeof(hmap_hopscotch_t));
+}
+
+size_t hmap_hopscotch_length(hmap_hopscotch_t* h) {
+    assert(h != NULL);
+    return h->length;
+}
+
+size_t hmap_hopscotch_capacity(hmap_hopscotch_t* h) {
+    assert(h != NULL);
+    return h->capacity;
+}
+
+float hmap_hopscotch_stats_load_factor(hmap_hopscotch_t* h) {
+    assert(h != NULL);
+    return h->length / (float)h->capacity;
+}
+
+size_t hmap_hopscotch_stats_stash_length(hmap_hopscotch_t* h) {
+    assert(h != NULL);
+    return h->stash_length;
+}
+
+void hmap_hopscotch_set(hmap_hopscotch_t* h, void* key, hmapitem_t* i) {
+    assert(h != NULL);
+    assert(i != NULL);
+    assert(i->map_ptr == NULL);
+    assert(i->key == NULL);
+
+    size_t hash = h->hash(key);
+
+    size_t home;
+    hmapitem_t** existing = hmap_hopscotch_internal_find(h, key, hash, &home);
+    if (existing != NULL) {
+        (*existing)->map_ptr = NULL;
+        (*existing)->key = NULL;
+        *existing = i;
+        i->map_ptr = h;
+        i->key = key;
+        return;
+    }
+
+    if (h->length + 1 > h->capacity * h->max_load) {
+        hmap_hopscotch_internal_resize(h, h->capacity * 2);
+    }
+
+    i->map_ptr = h;
+    i->key = key;
+    while (!hmap_hopscotch_internal_place(h, hash, i)) {
+        // a crowded neighborhood in a lightly loaded table hints at colliding hash values, growing would not help
+        if (h->length < h->capacity / 2) {
+            hmap_hopscotch_internal_stash(h, i);
+            break;
+        }
+        hmap_hopscotch_internal_resize(h, h->capacity * 2);
+    }
+    h->length++;
+}
+
+bool hmap_hopscotch_has(hmap_hopscotch_t* h, void* key) {
+    assert(h != NULL);
+
+    return hmap_hopscotch_get(h, key) != NULL;
+}
+
+hmapitem_t* hmap_hopscotch_get(hmap_hopscotch_t* h, void* key) {
+    assert(h != NULL);
+
+    size_t home;
+    hmapitem_t** i_ptr = hmap_hopscotch_internal_find(h, key, h->hash(key), &home);
+    return i_ptr == NULL ? NULL : *i_ptr;
+}
+
+hmapitem_t* hmap_hopscotch_delete(hmap_hopscotch_t* h, void* key) {
+    assert(h != NULL);
+
+    size_t home;
+    hmapitem_t** i_ptr = hmap_hopscotch_internal_find(h, key, h->hash(key), &home);
+    if (i_ptr == NULL) {
+        return NULL;
+    }
+
+    hmapitem_t* item = *i_ptr;
+    if (home == SIZE_MAX) {
+        *i_ptr = h->stash[--h->stash_length];
+    } else {
+        hmap_hopscotch_slot_t* slot = (hmap_hopscotch_slot_t*)((char*)i_ptr - offsetof(hmap_hopscotch_slot_t, item));
+        slot->item = NULL;
+        h->slots[home].hop &= ~((uint32_t)1 << (slot - &h->slots[home]));
+    }
+
+    item->map_ptr = NULL;
+    item->key = NULL;
+    h->length--;
+    return item;
+}
+
+void hmap_hopscotch_foreach(hmap_hopscotch_t* h, void (*iter)(void* key, hmapitem_t*, void*), void* userdata) {
+    assert(h != NULL);
+    assert(iter != NULL);
+
+    for (size_t s = 0; s < h->capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1; s++) {
+        hmapitem_t* i = h->slots[s].item;
+        if (i != NULL) {
+            iter(i->key, i, userdata);
+        }
+    }
+    for (size_t k = 0; k < h->stash_length; k++) {
+        iter(h->stash[k]->key, h->stash[k], userdata);
+    }
+}
+
+bool hmapitem_in_hopscotch(hmapitem_t* i, hmap_hopscotch_t* h) {
+    assert(i != NULL);
+    assert(h != NULL);
+    return i->map_ptr == h;
+}
+
+#endif
+#endif
@@ -0,0 +1,505 @@
+
+/*
+
+# Hash Map Mapped
+
+A relocatable on-disk format for read only maps. hmap_mapped_write serializes the keys and values of a hmap_t as byte
+strings and stores them together with a minimal perfect hash function (see hmap_frozen.h) in one file. hmap_mapped_open
+maps that file into memory and answers lookups directly from the mapping: nothing is parsed, copied or allocated per
+entry, so opening a map of any size costs one mmap call and processes mapping the same file share its pages through
+the page cache.
+
+The file consists of a header, the pilots of the perfect hash function, a slot table of record offsets and the records.
+Every record holds the key length, the value length, the key bytes and the value bytes, keys and values start at 8 byte
+aligned offsets. Keys are hashed over their bytes with hmap_mapped_hash_bytes_keyed and a random key stored in the
+header, so lookups take a key as byte string and sets of colliding keys can not be prepared before a file is written.
+Files are written in the byte order and word size of the writer, hmap_mapped_open rejects files of other platforms.
+
+hmap_mapped.h needs a POSIX system.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_MAPPED` before. Do this only once e.g. in
+main.c. The implementations of hmap.h and hmap_frozen.h are needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_FROZEN
+#include "hmap_frozen.h"
+#define IMPL_HMAP_MAPPED
+#include "hmap_mapped.h"
+```
+
+After that include hmap_mapped.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_mapped.h"
+```
+
+### Basic Usage
+
+```
+size_t country_key_bytes(void* key, const void** bytes) {
+    *bytes = key;
+    return strlen(key);
+}
+
+size_t country_value_bytes(void* item, const void** bytes) {
+    country* c = HMAPITEM_AS(country, item);
+    *bytes = &c->info;
+    return sizeof(c->info);
+}
+
+// build once
+hmap_mapped_write(&countries, "countries.map", country_key_bytes, country_value_bytes);
+
+// on every start
+hmap_mapped_t map;
+hmap_mapped_open(&map, "countries.map");
+const country_info* info = hmap_mapped_get(&map, "AT", 2, NULL);
+hmap_mapped_close(&map);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_MAPPED_H
+#define DS_HMAP_MAPPED_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hmap.h"
+#include "hmap_frozen.h"
+
+/**
+ * The magic bytes every mapped map file starts with.
+ */
+#define HMAP_MAPPED_MAGIC "HMAPMPH2"
+
+/**
+ * Written as uint64_t to detect files written with a different byte order.
+ */
+#define HMAP_MAPPED_BYTE_ORDER UINT64_C(0x0102030405060708)
+
+/**
+ * The number of random hash keys hmap_mapped_write tries before it gives up, another key is only needed if two keys
+ * have the same keyed hash value.
+ */
+#ifndef HMAP_MAPPED_KEY_ATTEMPTS
+#define HMAP_MAPPED_KEY_ATTEMPTS 4
+#endif
+
+/**
+ * internal use only: function parameter type generator for the byte codecs of hmap_mapped_write. The function stores a
+ * pointer to the bytes of ptr in *bytes and returns their number.
+ */
+#define HMAP_MAPPED_BYTES_TYPE(name) size_t (*name)(void* ptr, const void** bytes)
+
+typedef struct hmap_mapped_header_s {
+    char magic[8];
+    uint64_t byte_order;
+    uint64_t hash_bits;
+    uint64_t length;
+    uint64_t buckets_length;
+    uint64_t seed;
+    uint64_t hash_key[2];
+    uint64_t pilots_offset;
+    uint64_t slots_offset;
+    uint64_t size;
+} hmap_mapped_header_t;
+
+typedef struct hmap_mapped_s {
+    const char* base;
+    size_t size;
+    const hmap_mapped_header_t* header;
+    const uint32_t* pilots;
+    const uint64_t* slots;
+} hmap_mapped_t;
+
+/**
+ * Write all entries of m to the file at path. key_bytes is called with the key of every item, value_bytes with the
+ * item itself. The file is written next to path and renamed over it when complete, processes which mapped the previous
+ * version keep using it. Every write draws a new random hash key. Return 0 on success, -1 on failure with errno set,
+ * e.g. EINVAL if no hash key without collisions was found in HMAP_MAPPED_KEY_ATTEMPTS attempts.
+ */
+int hmap_mapped_write(hmap_t* m, const char* path, HMAP_MAPPED_BYTES_TYPE(key_bytes),
+                      HMAP_MAPPED_BYTES_TYPE(value_bytes));
+
+/**
+ * Map the file at path read only. Return 0 on success, -1 on failure with errno set, EINVAL if the file is not a valid
+ * mapped map of this platform.
+ */
+int hmap_mapped_open(hmap_mapped_t* mp, const char* path);
+
+/**
+ * Unmap a file mapped by hmap_mapped_open. Pointers returned by hmap_mapped_get become invalid.
+ */
+void hmap_mapped_close(hmap_mapped_t* mp);
+
+/**
+ * Return the number of entries in the map.
+ */
+size_t hmap_mapped_length(hmap_mapped_t* mp);
+
+/**
+ * Return a pointer to the value bytes associated with the key bytes and store their number in *value_length if
+ * value_length is not NULL. Null if the key has no association. The value is 8 byte aligned and lives in the mapping.
+ */
+const void* hmap_mapped_get(hmap_mapped_t* mp, const void* key, size_t key_length, size_t* value_length);
+
+/**
+ * Return true if the key bytes are associated with a value in the map, false otherwise.
+ */
+bool hmap_mapped_has(hmap_mapped_t* mp, const void* key, size_t key_length);
+
+/**
+ * Call iter with the key and value bytes of every record in the map.
+ */
+void hmap_mapped_foreach(hmap_mapped_t* mp,
+                         void (*iter)(const void* key, size_t key_length, const void* value, size_t value_length, void*),
+                         void* userdata);
+
+/**
+ * An unkeyed hash function for byte strings (64 bit FNV-1a), e.g. for the hmap_t a mapped map is written from. Sets of
+ * keys with the same value are easy to construct.
+ */
+size_t hmap_mapped_hash_bytes(const void* bytes, size_t length);
+
+/**
+ * The hash function used for the keys of mapped maps (SipHash-2-4 with the 128 bit key).
+ */
+size_t hmap_mapped_hash_bytes_keyed(const void* bytes, size_t length, const uint64_t key[2]);
+
+#if defined(IMPL_HMAP_MAPPED) || defined(_CLANGD)
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * internal use only: round up to the next multiple of 8.
+ */
+uint64_t hmap_mapped_internal_align(uint64_t size) {
+    return (size + 7) & ~(uint64_t)7;
+}
+
+/**
+ * internal use only: write size bytes followed by zeros up to the next multiple of 8. Return false on failure.
+ */
+bool hmap_mapped_internal_write(FILE* file, const void* bytes, size_t size) {
+    static const char zeros[8] = {0};
+    size_t padding = hmap_mapped_internal_align(size) - size;
+    return (size == 0 || fwrite(bytes, 1, size, file) == size) &&
+           (padding == 0 || fwrite(zeros, 1, padding, file) == padding);
+}
+
+size_t hmap_mapped_hash_bytes(const void* bytes, size_t length) {
+    uint64_t hash = UINT64_C(0xcbf29ce484222325);
+    for (size_t i = 0; i < length; i++) {
+        hash ^= ((const unsigned char*)bytes)[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return (size_t)hash;
+}
+
+/**
+ * internal use only: rotate x left by b bits.
+ */
+uint64_t hmap_mapped_internal_rotl(uint64_t x, int b) {
+    return (x << b) | (x >> (64 - b));
+}
+
+/**
+ * internal use only: one SipHash round.
+ */
+void hmap_mapped_internal_sipround(uint64_t v[4]) {
+    v[0] += v[1];
+    v[1] = hmap_mapped_internal_rotl(v[1], 13) ^ v[0];
+    v[0] = hmap_mapped_internal_rotl(v[0], 32);
+    v[2] += v[3];
+    v[3] = hmap_mapped_internal_rotl(v[3], 16) ^ v[2];
+    v[0] += v[3];
+    v[3] = hmap_mapped_internal_rotl(v[3], 21) ^ v[0];
+    v[2] += v[1];
+    v[1] = hmap_mapped_internal_rotl(v[1], 17) ^ v[2];
+    v[2] = hmap_mapped_internal_rotl(v[2], 32);
+}
+
+size_t hmap_mapped_hash_bytes_keyed(const void* bytes, size_t length, const uint64_t key[2]) {
+    const unsigned char* b = bytes;
+    uint64_t v[4] = {key[0] ^ UINT64_C(0x736f6d6570736575), key[1] ^ UINT64_C(0x646f72616e646f6d),
+                     key[0] ^ UINT64_C(0x6c7967656e657261), key[1] ^ UINT64_C(0x7465646279746573)};
+
+    // little endian words, the last one holds the remaining bytes and the length in its top byte
+    for (size_t i = 0; i <= length; i += 8) {
+        uint64_t m = i + 8 <= length ? 0 : (uint64_t)length << 56;
+        for (size_t j = 0; j < 8 && i + j < length; j++) {
+            m |= (uint64_t)b[i + j] << (8 * j);
+        }
+        v[3] ^= m;
+        hmap_mapped_internal_sipround(v);
+        hmap_mapped_internal_sipround(v);
+        v[0] ^= m;
+    }
+
+    v[2] ^= 0xff;
+    for (int r = 0; r < 4; r++) {
+        hmap_mapped_internal_sipround(v);
+    }
+    return (size_t)(v[0] ^ v[1] ^ v[2] ^ v[3]);
+}
+
+/**
+ * internal use only: write header, pilots, slot table and the records of items in slot order to a file at path.
+ * Return 0 on success, an errno value otherwise.
+ */
+int hmap_mapped_internal_write_file(const char* path, hmap_mapped_header_t* header, uint32_t* pilots, uint64_t* slots,
+                                    hmapitem_t** items, size_t* by_slot, HMAP_MAPPED_BYTES_TYPE(key_bytes),
+                                    HMAP_MAPPED_BYTES_TYPE(value_bytes)) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return errno;
+    }
+
+    size_t n = header->length;
+    bool ok = hmap_mapped_internal_write(file, header, sizeof(hmap_mapped_header_t)) &&
+              hmap_mapped_internal_write(file, pilots, header->buckets_length * sizeof(uint32_t)) &&
+              hmap_mapped_internal_write(file, slots, n * sizeof(uint64_t));
+    for (size_t s = 0; s < n && ok; s++) {
+        const void* key;
+        const void* value;
+        hmapitem_t* i = items[by_slot[s]];
+        uint64_t lengths[2] = {key_bytes(i->key, &key), value_bytes(i, &value)};
+        ok = hmap_mapped_internal_write(file, lengths, sizeof(lengths)) &&
+             hmap_mapped_internal_write(file, key, lengths[0]) && hmap_mapped_internal_write(file, value, lengths[1]);
+    }
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    int error = ok ? 0 : errno;
+
+    if (fclose(file) != 0 && error == 0) {
+        error = errno;
+    }
+    return error;
+}
+
+int hmap_mapped_write(hmap_t* m, const char* path, HMAP_MAPPED_BYTES_TYPE(key_bytes),
+                      HMAP_MAPPED_BYTES_TYPE(value_bytes)) {
+    assert(m != NULL);
+    assert(path != NULL);
+    assert(key_bytes != NULL);
+    assert(value_bytes != NULL);
+
+    size_t n = m->length;
+    size_t scratch = n == 0 ? 1 : n;
+    hmap_mapped_header_t header;
+    memset(&header, 0, sizeof(hmap_mapped_header_t));
+    memcpy(header.magic, HMAP_MAPPED_MAGIC, sizeof(header.magic));
+    header.byte_order = HMAP_MAPPED_BYTE_ORDER;
+    header.hash_bits = sizeof(size_t) * 8;
+    header.length = n;
+    header.buckets_length = hmap_frozen_internal_buckets(n);
+    header.pilots_offset = sizeof(hmap_mapped_header_t);
+    header.slots_offset = header.pilots_offset + hmap_mapped_internal_align(header.buckets_length * sizeof(uint32_t));
+
+    hmapitem_t** items = malloc(scratch * sizeof(hmapitem_t*));
+    size_t* hashes = malloc(scratch * sizeof(size_t));
+    size_t* positions = malloc(scratch * sizeof(size_t));
+    size_t* by_slot = malloc(scratch * sizeof(size_t));
+    uint32_t* pilots = malloc(header.buckets_length * sizeof(uint32_t));
+    uint64_t* slots = malloc(scratch * sizeof(uint64_t));
+    char* tmp_path = malloc(strlen(path) + sizeof(".tmp"));
+
+    int error = ENOMEM;
+    if (items != NULL && hashes != NULL && positions != NULL && by_slot != NULL && pilots != NULL && slots != NULL &&
+        tmp_path != NULL) {
+        size_t k = 0;
+        for (size_t i = 0; i < m->capacity; i++) {
+            if (m->data[i] != NULL) {
+                items[k++] = m->data[i];
+            }
+        }
+
+        // a random key keeps the keyed hash values unpredictable, a new one is drawn if two of them are the same
+        error = EINVAL;
+        for (size_t attempt = 0; attempt < HMAP_MAPPED_KEY_ATTEMPTS && error == EINVAL; attempt++) {
+            if (getentropy(header.hash_key, sizeof(header.hash_key)) != 0) {
+                error = errno;
+                break;
+            }
+            for (k = 0; k < n; k++) {
+                const void* bytes;
+                size_t length = key_bytes(items[k]->key, &bytes);
+                hashes[k] = hmap_mapped_hash_bytes_keyed(bytes, length, header.hash_key);
+            }
+
+            int built;
+            header.seed = hmap_frozen_internal_build(n, hashes, pilots, positions, &built);
+            error = built == 0 ? 0 : EINVAL;
+        }
+    }
+
+    if (error == 0) {
+        // records are stored in slot order
+        uint64_t offset = header.slots_offset + hmap_mapped_internal_align(n * sizeof(uint64_t));
+        for (size_t k = 0; k < n; k++) {
+            by_slot[positions[k]] = k;
+        }
+        for (size_t s = 0; s < n; s++) {
+            const void* bytes;
+            hmapitem_t* i = items[by_slot[s]];
+            slots[s] = offset;
+            offset += 2 * sizeof(uint64_t) + hmap_mapped_internal_align(key_bytes(i->key, &bytes));
+            offset += hmap_mapped_internal_align(value_bytes(i, &bytes));
+        }
+        header.size = offset;
+
+        sprintf(tmp_path, "%s.tmp", path);
+        error = hmap_mapped_internal_write_file(tmp_path, &header, pilots, slots, items, by_slot, key_bytes,
+                                                value_bytes);
+        if (error == 0 && rename(tmp_path, path) != 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            unlink(tmp_path);
+        }
+    }
+
+    free(items);
+    free(hashes);
+    free(positions);
+    free(by_slot);
+    free(pilots);
+    free(slots);
+    free(tmp_path);
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int hmap_mapped_open(hmap_mapped_t* mp, const char* path) {
+    assert(mp != NULL);
+    assert(path != NULL);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    if ((size_t)st.st_size < sizeof(hmap_mapped_header_t)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        errno = error;
+        return -1;
+    }
+
+    const hmap_mapped_header_t* header = base;
+    if (memcmp(header->magic, HMAP_MAPPED_MAGIC, 8) != 0 || header->byte_order != HMAP_MAPPED_BYTE_ORDER ||
+        header->hash_bits != sizeof(size_t) * 8 || header->size != (uint64_t)st.st_size ||
+        header->buckets_length != hmap_frozen_internal_buckets(header->length) ||
+        header->pilots_offset + header->buckets_length * sizeof(uint32_t) > header->slots_offset ||
+        header->slots_offset + header->length * sizeof(uint64_t) > header->size) {
+        munmap(base, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+
+    mp->base = base;
+    mp->size = (size_t)st.st_size;
+    mp->header = header;
+    mp->pilots = (const uint32_t*)(mp->base + header->pilots_offset);
+    mp->slots = (const uint64_t*)(mp->base + header->slots_offset);
+    return 0;
+}
+
+void hmap_mapped_close(hmap_mapped_t* mp) {
+    assert(mp != NULL);
+
+    munmap((void*)mp->base, mp->size);
+    memset(mp, 0, sizeof(hmap_mapped_t));
+}
+
+size_t hmap_mapped_length(hmap_mapped_t* mp) {
+    assert(mp != NULL);
+    return mp->header->length;
+}
+
+const void* hmap_mapped_get(hmap_mapped_t* mp, const void* key, size_t key_length, size_t* value_length) {
+    assert(mp != NULL);
+
+    size_t length = mp->header->length;
+    if (length == 0) {
+        return NULL;
+    }
+
+    size_t mixed =
+        hmap_hash_mix(hmap_mapped_hash_bytes_keyed(key, key_length, mp->header->hash_key) ^ mp->header->seed);
+    size_t slot = hmap_frozen_internal_slot(mixed, mp->pilots[mixed % mp->header->buckets_length], length);
+    const uint64_t* record = (const uint64_t*)(mp->base + mp->slots[slot]);
+    if (record[0] != key_length || memcmp(record + 2, key, key_length) != 0) {
+        return NULL;
+    }
+
+    if (value_length != NULL) {
+        *value_length = record[1];
+    }
+    return (const char*)(record + 2) + hmap_mapped_internal_align(key_length);
+}
+
+bool hmap_mapped_has(hmap_mapped_t* mp, const void* key, size_t key_length) {
+    assert(mp != NULL);
+
+    return hmap_mapped_get(mp, key, key_length, NULL) != NULL;
+}
+
+void hmap_mapped_foreach(hmap_mapped_t* mp,
+                         void (*iter)(const void* key, size_t key_length, const void* value, size_t value_length, void*),
+                         void* userdata) {
+    assert(mp != NULL);
+    assert(iter != NULL);
+
+    for (size_t s = 0; s < mp->header->length; s++) {
+        const uint64_t* record = (const uint64_t*)(mp->base + mp->slots[s]);
+        const char* key = (const char*)(record + 2);
+        iter(key, record[0], key + hmap_mapped_internal_align(record[0]), record[1], userdata);
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,316 @@
+
+/*
+
+# Hash Map RCU
+
+Publish immutable versions of a hmap_t to many concurrent readers. A writer builds a complete new map and publishes it
+with a single atomic pointer swap. Readers enter a read side critical section, use the current version with the plain
+hmap_get/hmap_has functions without any further synchronization and leave the critical section. Old versions are handed
+to a reclaim callback after a grace period, that is as soon as no reader can still be using them.
+
+Published maps must not be modified anymore and their items must not be moved to other maps (e.g. with hmap_rehash_to)
+while readers might still use them. Build every version from its own items.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_RCU` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_RCU
+#include "hmap_rcu.h"
+```
+
+After that include hmap_rcu.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_rcu.h"
+```
+
+hmap_rcu.h uses C11 threads and atomics, link with `-pthread` if your libc needs it.
+
+### Basic Usage
+
+```
+typedef struct {
+    hmap_t map;
+    route* routes;
+} routing_table;
+
+void reclaim_table(hmap_t* m, void* userdata) {
+    routing_table* t = (routing_table*)m;
+    hmap_destroy(&t->map);
+    free(t->routes);
+    free(t);
+}
+
+hmap_rcu_t routes;
+hmap_rcu_init(&routes, &build_routing_table()->map, reclaim_table, NULL);
+
+// reader thread
+hmap_rcu_reader_t* reader = hmap_rcu_register(&routes);
+hmap_t* m = hmap_rcu_read_lock(&routes, reader);
+route* r = HMAP_GET(route, m, destination);
+...
+hmap_rcu_read_unlock(reader);
+
+// writer thread
+hmap_rcu_publish(&routes, &build_routing_table()->map);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_RCU_H
+#define DS_HMAP_RCU_H
+#include <stdatomic.h>
+#include <stddef.h>
+#include <threads.h>
+
+#include "hmap.h"
+
+/**
+ * The maximum number of readers which can be registered at the same time.
+ */
+#define HMAP_RCU_MAX_READERS 64
+
+typedef struct hmap_rcu_reader_s {
+    atomic_size_t epoch;  // the epoch the reader entered its critical section in, 0 if outside
+    atomic_bool registered;
+    char padding[HMAP_CACHE_LINE_SIZE - sizeof(atomic_size_t) - sizeof(atomic_bool)];
+} hmap_rcu_reader_t;
+
+typedef struct hmap_rcu_retired_s {
+    hmap_t* map;
+    size_t epoch;
+} hmap_rcu_retired_t;
+
+typedef struct hmap_rcu_s {
+    _Atomic(hmap_t*) current;
+    atomic_size_t epoch;
+    mtx_t writer_lock;
+    hmap_rcu_retired_t* retired;
+    size_t retired_length;
+    size_t retired_capacity;
+    void (*reclaim)(hmap_t* m, void* userdata);
+    void* reclaim_userdata;
+    hmap_rcu_reader_t readers[HMAP_RCU_MAX_READERS];
+} hmap_rcu_t;
+
+/**
+ * Initialize the publication point with the first version, which might be NULL. reclaim is called with every version
+ * which can no longer be reached by any reader.
+ */
+void hmap_rcu_init(hmap_rcu_t* r, hmap_t* initial, void (*reclaim)(hmap_t* m, void* userdata), void* userdata);
+
+/**
+ * Reclaim the current and all retired versions. No reader must be inside a critical section.
+ */
+void hmap_rcu_destroy(hmap_rcu_t* r);
+
+/**
+ * Register a reader. Every thread needs its own reader. Return NULL if HMAP_RCU_MAX_READERS readers are registered.
+ */
+hmap_rcu_reader_t* hmap_rcu_register(hmap_rcu_t* r);
+
+/**
+ * Unregister a reader which is outside of its critical section.
+ */
+void hmap_rcu_unregister(hmap_rcu_reader_t* reader);
+
+/**
+ * Enter a read side critical section and return the current version. The version stays valid until
+ * hmap_rcu_read_unlock is called. Critical sections of the same reader must not be nested.
+ */
+hmap_t* hmap_rcu_read_lock(hmap_rcu_t* r, hmap_rcu_reader_t* reader);
+
+/**
+ * Leave a read side critical section.
+ */
+void hmap_rcu_read_unlock(hmap_rcu_reader_t* reader);
+
+/**
+ * Return the current version. Only safe to use for writers or inside a read side critical section.
+ */
+hmap_t* hmap_rcu_current(hmap_rcu_t* r);
+
+/**
+ * Atomically replace the current version with m. The replaced version is retired and reclaimed as soon as no reader can
+ * use it anymore. Writers are serialized.
+ */
+void hmap_rcu_publish(hmap_rcu_t* r, hmap_t* m);
+
+/**
+ * Reclaim all retired versions whose grace period has ended. Return the number of versions still waiting.
+ */
+size_t hmap_rcu_reclaim(hmap_rcu_t* r);
+
+/**
+ * Block until all retired versions are reclaimed.
+ */
+void hmap_rcu_synchronize(hmap_rcu_t* r);
+
+#if defined(IMPL_HMAP_RCU) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+
+void hmap_rcu_init(hmap_rcu_t* r, hmap_t* initial, void (*reclaim)(hmap_t* m, void* userdata), void* userdata) {
+    assert(r != NULL);
+    assert(reclaim != NULL);
+
+    atomic_init(&r->current, initial);
+    atomic_init(&r->epoch, 1);
+    int ret = mtx_init(&r->writer_lock, mtx_plain);
+    assert(ret == thrd_success);
+    ((void)ret);
+    r->retired = NULL;
+    r->retired_length = 0;
+    r->retired_capacity = 0;
+    r->reclaim = reclaim;
+    r->reclaim_userdata = userdata;
+
+    for (size_t i = 0; i < HMAP_RCU_MAX_READERS; i++) {
+        atomic_init(&r->readers[i].epoch, 0);
+        atomic_init(&r->readers[i].registered, false);
+    }
+}
+
+void hmap_rcu_destroy(hmap_rcu_t* r) {
+    assert(r != NULL);
+
+    for (size_t i = 0; i < r->retired_length; i++) {
+        r->reclaim(r->retired[i].map, r->reclaim_userdata);
+    }
+
+    hmap_t* current = atomic_load(&r->current);
+    if (current != NULL) {
+        r->reclaim(current, r->reclaim_userdata);
+    }
+
+    free(r->retired);
+    mtx_destroy(&r->writer_lock);
+    memset(r, 0, sizeof(hmap_rcu_t));
+}
+
+hmap_rcu_reader_t* hmap_rcu_register(hmap_rcu_t* r) {
+    assert(r != NULL);
+
+    for (size_t i = 0; i < HMAP_RCU_MAX_READERS; i++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&r->readers[i].registered, &expected, true)) {
+            atomic_store(&r->readers[i].epoch, 0);
+            return &r->readers[i];
+        }
+    }
+    return NULL;
+}
+
+void hmap_rcu_unregister(hmap_rcu_reader_t* reader) {
+    assert(reader != NULL);
+    assert(atomic_load(&reader->epoch) == 0);
+
+    atomic_store(&reader->registered, false);
+}
+
+hmap_t* hmap_rcu_read_lock(hmap_rcu_t* r, hmap_rcu_reader_t* reader) {
+    assert(r != NULL);
+    assert(reader != NULL);
+    assert(atomic_load_explicit(&reader->epoch, memory_order_relaxed) == 0);
+
+    // announce the epoch before loading the version, a writer which does not see the announcement has already swapped
+    // the version and the load below returns the new one
+    atomic_store(&reader->epoch, atomic_load(&r->epoch));
+    return atomic_load(&r->current);
+}
+
+void hmap_rcu_read_unlock(hmap_rcu_reader_t* reader) {
+    assert(reader != NULL);
+
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
+
+hmap_t* hmap_rcu_current(hmap_rcu_t* r) {
+    assert(r != NULL);
+
+    return atomic_load(&r->current);
+}
+
+void hmap_rcu_publish(hmap_rcu_t* r, hmap_t* m) {
+    assert(r != NULL);
+
+    mtx_lock(&r->writer_lock);
+
+    hmap_t* old = atomic_exchange(&r->current, m);
+    size_t epoch = atomic_fetch_add(&r->epoch, 1);
+
+    if (old != NULL) {
+        if (r->retired_length == r->retired_capacity) {
+            r->retired_capacity = r->retired_capacity == 0 ? 4 : r->retired_capacity * 2;
+            r->retired = realloc(r->retired, r->retired_capacity * sizeof(hmap_rcu_retired_t));
+            assert(r->retired != NULL);
+        }
+        r->retired[r->retired_length].map = old;
+        r->retired[r->retired_length].epoch = epoch;
+        r->retired_length++;
+    }
+
+    mtx_unlock(&r->writer_lock);
+
+    hmap_rcu_reclaim(r);
+}
+
+size_t hmap_rcu_reclaim(hmap_rcu_t* r) {
+    assert(r != NULL);
+
+    mtx_lock(&r->writer_lock);
+
+    // versions retired in an epoch older than the oldest active reader are unreachable
+    size_t oldest = SIZE_MAX;
+    for (size_t i = 0; i < HMAP_RCU_MAX_READERS; i++) {
+        size_t epoch = atomic_load(&r->readers[i].epoch);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < r->retired_length; i++) {
+        if (r->retired[i].epoch < oldest) {
+            r->reclaim(r->retired[i].map, r->reclaim_userdata);
+        } else {
+            r->retired[kept++] = r->retired[i];
+        }
+    }
+    r->retired_length = kept;
+
+    mtx_unlock(&r->writer_lock);
+
+    return kept;
+}
+
+void hmap_rcu_synchronize(hmap_rcu_t* r) {
+    assert(r != NULL);
+
+    while (hmap_rcu_reclaim(r) > 0) {
+        thrd_yield();
+    }
+}
+
+#endif
+#endif
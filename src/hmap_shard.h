@@ -0,0 +1,399 @@
+
+/*
+
+# Sharded Hash Map
+
+A concurrent hash map made of independently locked hmap_t shards. The slot array of every shard is placed on one NUMA
+node, shards are spread round robin over all online nodes. Threads can ask which node owns a key or a shard and route
+work accordingly, e.g. let the workers of every node sweep only their local shards with hmap_sharded_foreach_node.
+
+On machines with a single node or if the kernel refuses the memory policy the shards are placed wherever the kernel
+puts them, on systems other than Linux the slot arrays come from calloc. Everything else works the same.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_SHARD` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_SHARD
+#include "hmap_shard.h"
+```
+
+After that include hmap_shard.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_shard.h"
+```
+
+hmap_shard.h uses C11 threads, link with `-pthread` if your libc needs it.
+
+### Basic Usage
+
+```
+hmap_sharded_t sessions;
+hmap_sharded_init(&sessions, hash_session_id, equals_session_id, 64);
+
+hmap_sharded_set(&sessions, &s->id, HMAPITEM_OF(session, s));
+session* s = HMAPITEM_AS(session, hmap_sharded_get(&sessions, &id));
+
+// expiry worker pinned to a node
+hmap_sharded_foreach_node(&sessions, hmap_sharded_current_node(), expire_session, &now);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_SHARD_H
+#define DS_HMAP_SHARD_H
+#include <stddef.h>
+#include <threads.h>
+
+#include "hmap.h"
+
+/**
+ * The maximum number of NUMA nodes shards are spread over.
+ */
+#define HMAP_SHARD_MAX_NODES 64
+
+typedef struct hmap_shard_s {
+    _Alignas(HMAP_CACHE_LINE_SIZE) hmap_t map;
+    mtx_t lock;
+    int node;
+} hmap_shard_t;
+
+typedef struct hmap_sharded_s {
+    size_t shards_length;
+    hmap_shard_t* shards;
+    size_t nodes;
+    HMAP_HASH_TYPE(hash);
+} hmap_sharded_t;
+
+/**
+ * Initialize a sharded map with the given number of managed shards. Shard i is placed on NUMA node i % number of nodes.
+ */
+void hmap_sharded_init(hmap_sharded_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t shards_length);
+
+/**
+ * Free all resources allocated by hmap_sharded_init.
+ */
+void hmap_sharded_destroy(hmap_sharded_t* s);
+
+/**
+ * Associate the given key with the item. Possible existing associations will be overwritten.
+ */
+void hmap_sharded_set(hmap_sharded_t* s, void* key, hmapitem_t* i);
+
+/**
+ * Return the item associated with the given key. Null if the key has no association.
+ */
+hmapitem_t* hmap_sharded_get(hmap_sharded_t* s, void* key);
+
+/**
+ * Return true if the given key is associated with a value in the map, false otherwise.
+ */
+bool hmap_sharded_has(hmap_sharded_t* s, void* key);
+
+/**
+ * Remove the association of the key. Return the disassociated item or null if there was none.
+ */
+hmapitem_t* hmap_sharded_delete(hmap_sharded_t* s, void* key);
+
+/**
+ * Return the number of items in all shards.
+ */
+size_t hmap_sharded_length(hmap_sharded_t* s);
+
+/**
+ * Lock the shard responsible for the key and return its map for compound operations.
+ */
+hmap_t* hmap_sharded_lock(hmap_sharded_t* s, void* key);
+
+/**
+ * Unlock the shard locked by hmap_sharded_lock.
+ */
+void hmap_sharded_unlock(hmap_sharded_t* s, void* key);
+
+/**
+ * Return the index of the shard responsible for the key.
+ */
+size_t hmap_sharded_shard_of(hmap_sharded_t* s, void* key);
+
+/**
+ * Return the NUMA node the slot array of the given shard is placed on.
+ */
+int hmap_sharded_shard_node(hmap_sharded_t* s, size_t shard);
+
+/**
+ * Return the NUMA node owning the key. Hint for routing work on the key to a thread running on that node.
+ */
+int hmap_sharded_key_node(hmap_sharded_t* s, void* key);
+
+/**
+ * Return the number of NUMA nodes the shards are spread over.
+ */
+size_t hmap_sharded_nodes(hmap_sharded_t* s);
+
+/**
+ * Return the NUMA node the calling thread currently runs on, 0 if it can not be determined.
+ */
+int hmap_sharded_current_node(void);
+
+/**
+ * Call iter on every key value entry of the shards placed on the given node. Every shard is locked while it is walked,
+ * iter must not modify the map.
+ */
+void hmap_sharded_foreach_node(hmap_sharded_t* s, int node, void (*iter)(void* key, hmapitem_t*, void*),
+                               void* userdata);
+
+#if defined(IMPL_HMAP_SHARD) || defined(_CLANGD)
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#endif
+
+/**
+ * internal use only: return the number of online NUMA nodes, assuming they are numbered without gaps.
+ */
+size_t hmap_shard_internal_online_nodes(void) {
+    size_t nodes = 1;
+#ifdef __linux__
+    FILE* f = fopen("/sys/devices/system/node/online", "r");
+    if (f == NULL) {
+        return 1;
+    }
+
+    // the file holds a list of ranges like "0" or "0-1,3"
+    unsigned long first, last;
+    char separator;
+    while (fscanf(f, "%lu", &first) == 1) {
+        last = first;
+        separator = (char)fgetc(f);
+        if (separator == '-' && fscanf(f, "%lu", &last) == 1) {
+            separator = (char)fgetc(f);
+        }
+        if (last + 1 > nodes) {
+            nodes = last + 1;
+        }
+        if (separator != ',') {
+            break;
+        }
+    }
+    fclose(f);
+#endif
+    return nodes < HMAP_SHARD_MAX_NODES ? nodes : HMAP_SHARD_MAX_NODES;
+}
+
+/**
+ * internal use only: allocate zeroed pages with a preference for the node passed as userdata.
+ */
+void* hmap_shard_internal_alloc(size_t size, void* userdata) {
+#ifdef __linux__
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return NULL;
+    }
+
+    // pages are placed on first touch, so setting the policy before returning the memory is enough. Failing is fine,
+    // the memory is then placed by the default policy.
+    unsigned long mask = 1ul << (uintptr_t)userdata;
+    syscall(SYS_mbind, ptr, size, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+    return ptr;
+#else
+    ((void)userdata);
+    return calloc(1, size);
+#endif
+}
+
+/**
+ * internal use only: release memory allocated by hmap_shard_internal_alloc.
+ */
+void hmap_shard_internal_release(void* ptr, size_t size, void* userdata) {
+    ((void)userdata);
+#ifdef __linux__
+    munmap(ptr, size);
+#else
+    ((void)size);
+    free(ptr);
+#endif
+}
+
+/**
+ * internal use only: return the shard responsible for the key.
+ */
+hmap_shard_t* hmap_shard_internal_of(hmap_sharded_t* s, void* key) {
+    return &s->shards[hmap_sharded_shard_of(s, key)];
+}
+
+void hmap_sharded_init(hmap_sharded_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t shards_length) {
+    assert(s != NULL);
+    assert(shards_length > 0);
+
+    s->shards_length = shards_length;
+    s->shards = aligned_alloc(HMAP_CACHE_LINE_SIZE, shards_length * sizeof(hmap_shard_t));
+    assert(s->shards != NULL);
+    s->nodes = hmap_shard_internal_online_nodes();
+    s->hash = hash;
+
+    for (size_t i = 0; i < shards_length; i++) {
+        hmap_shard_t* shard = &s->shards[i];
+        shard->node = (int)(i % s->nodes);
+        mtx_init(&shard->lock, mtx_plain);
+        hmap_init(&shard->map, hash, equals);
+        hmap_allocator(&shard->map, hmap_shard_internal_alloc, hmap_shard_internal_release,
+                       (void*)(uintptr_t)shard->node);
+    }
+}
+
+void hmap_sharded_destroy(hmap_sharded_t* s) {
+    assert(s != NULL);
+
+    for (size_t i = 0; i < s->shards_length; i++) {
+        hmap_destroy(&s->shards[i].map);
+        mtx_destroy(&s->shards[i].lock);
+    }
+    free(s->shards);
+    memset(s, 0, sizeof(hmap_sharded_t));
+}
+
+void hmap_sharded_set(hmap_sharded_t* s, void* key, hmapitem_t* i) {
+    assert(s != NULL);
+
+    hmap_shard_t* shard = hmap_shard_internal_of(s, key);
+    mtx_lock(&shard->lock);
+    hmap_set(&shard->map, key, i);
+    mtx_unlock(&shard->lock);
+}
+
+hmapitem_t* hmap_sharded_get(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    hmap_shard_t* shard = hmap_shard_internal_of(s, key);
+    mtx_lock(&shard->lock);
+    hmapitem_t* i = hmap_get(&shard->map, key);
+    mtx_unlock(&shard->lock);
+    return i;
+}
+
+bool hmap_sharded_has(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    return hmap_sharded_get(s, key) != NULL;
+}
+
+hmapitem_t* hmap_sharded_delete(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    hmap_shard_t* shard = hmap_shard_internal_of(s, key);
+    mtx_lock(&shard->lock);
+    hmapitem_t* i = hmap_delete(&shard->map, key);
+    mtx_unlock(&shard->lock);
+    return i;
+}
+
+size_t hmap_sharded_length(hmap_sharded_t* s) {
+    assert(s != NULL);
+
+    size_t length = 0;
+    for (size_t i = 0; i < s->shards_length; i++) {
+        mtx_lock(&s->shards[i].lock);
+        length += hmap_length(&s->shards[i].map);
+        mtx_unlock(&s->shards[i].lock);
+    }
+    return length;
+}
+
+hmap_t* hmap_sharded_lock(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    hmap_shard_t* shard = hmap_shard_internal_of(s, key);
+    mtx_lock(&shard->lock);
+    return &shard->map;
+}
+
+void hmap_sharded_unlock(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    mtx_unlock(&hmap_shard_internal_of(s, key)->lock);
+}
+
+size_t hmap_sharded_shard_of(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    // scramble the hash, selecting shards by its low bits would leave most slots of every shard unused
+    uint64_t h = (uint64_t)s->hash(key) * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t)((h >> 32) % s->shards_length);
+}
+
+int hmap_sharded_shard_node(hmap_sharded_t* s, size_t shard) {
+    assert(s != NULL);
+    assert(shard < s->shards_length);
+
+    return s->shards[shard].node;
+}
+
+int hmap_sharded_key_node(hmap_sharded_t* s, void* key) {
+    assert(s != NULL);
+
+    return hmap_shard_internal_of(s, key)->node;
+}
+
+size_t hmap_sharded_nodes(hmap_sharded_t* s) {
+    assert(s != NULL);
+
+    return s->nodes;
+}
+
+int hmap_sharded_current_node(void) {
+#ifdef __linux__
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < HMAP_SHARD_MAX_NODES) {
+        return (int)node;
+    }
+#endif
+    return 0;
+}
+
+void hmap_sharded_foreach_node(hmap_sharded_t* s, int node, void (*iter)(void* key, hmapitem_t*, void*),
+                               void* userdata) {
+    assert(s != NULL);
+    assert(iter != NULL);
+
+    for (size_t i = 0; i < s->shards_length; i++) {
+        if (s->shards[i].node != node) {
+            continue;
+        }
+        mtx_lock(&s->shards[i].lock);
+        hmap_foreach(&s->shards[i].map, iter, userdata);
+        mtx_unlock(&s->shards[i].lock);
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,931 @@
+/*
+
+# Hash Map Write Ahead Log
+
+Persistence for a hmap_t through an append only log of its mutations. hmap_wal_set and hmap_wal_delete change the map
+and append a record holding the encoded key (and value) to an in memory buffer. hmap_wal_commit makes all buffered
+records durable with one write and one fdatasync. Threads committing while another thread syncs wait for it and are
+covered by the next sync together, so concurrent committers share syncs (group commit).
+
+hmap_wal_snapshot writes all entries of the map to a snapshot file and empties the log, which bounds the log and the
+recovery time. A snapshot can also be taken automatically by hmap_wal_commit once the log exceeds a size threshold.
+
+hmap_wal_open recovers the map from the snapshot and the log. Records are partitioned by a hash of their key bytes and
+every partition is replayed by its own thread: only the last record of every key is decoded, the decoded items are
+inserted with hmap_build_parallel. A record cut off by a crash ends the log, the log is truncated behind the last
+complete record.
+
+Keys and values are converted by a user provided codec: key_bytes and value_bytes expose the bytes of a key and an
+item, decode allocates an item (and its key) from bytes or returns NULL if it can not. Equal keys must be encoded to
+equal bytes.
+
+hmap_wal.h needs a POSIX system and uses C11 threads, link with `-pthread` if your libc needs it.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HMAP_WAL` before. Do this only once e.g. in
+main.c. The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HMAP_WAL
+#include "hmap_wal.h"
+```
+
+After that include hmap_wal.h like a normal header everywhere the declarations are needed
+```
+#include "hmap_wal.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    char id[32];
+    uint64_t user;
+    HMAPITEM_PROP();
+} session;
+
+size_t session_key_bytes(void* key, const void** bytes) {
+    *bytes = key;
+    return strlen(key);
+}
+
+size_t session_value_bytes(void* item, const void** bytes) {
+    *bytes = &HMAPITEM_AS(session, item)->user;
+    return sizeof(uint64_t);
+}
+
+hmapitem_t* session_decode(const void* key, size_t key_length, const void* value, size_t value_length,
+                           void** decoded_key, void* userdata) {
+    session* s = calloc(1, sizeof(session));
+    memcpy(s->id, key, key_length);
+    memcpy(&s->user, value, sizeof(uint64_t));
+    *decoded_key = s->id;
+    return HMAPITEM_OF(session, s);
+}
+
+hmap_wal_codec_t codec = {session_key_bytes, session_value_bytes, session_decode, NULL};
+
+hmap_t sessions;
+hmap_init(&sessions, hmap_hash_str, hmap_equals_str);
+
+hmap_wal_t wal;
+hmap_wal_open(&wal, &sessions, "sessions.log", &codec, 8);
+
+hmap_wal_set(&wal, s->id, HMAPITEM_OF(session, s));
+hmap_wal_commit(&wal);
+
+hmap_wal_close(&wal);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HMAP_WAL_H
+#define DS_HMAP_WAL_H
+#include <stddef.h>
+#include <stdint.h>
+#include <threads.h>
+
+#include "hmap.h"
+
+/**
+ * The first bytes of every log and snapshot file.
+ */
+#define HMAP_WAL_MAGIC "HMAPWAL1"
+
+/**
+ * The function type returning the bytes of a key or an item: the function stores a pointer to the bytes of ptr in
+ * *bytes and returns their number.
+ */
+#define HMAP_WAL_BYTES_TYPE(name) size_t (*name)(void* ptr, const void** bytes)
+
+/**
+ * The function type creating an item from key and value bytes. The function returns the new item, NULL on failure,
+ * and stores the key it has to be associated with in *decoded_key.
+ */
+#define HMAP_WAL_DECODE_TYPE(name)                                                                      \
+    hmapitem_t* (*name)(const void* key, size_t key_length, const void* value, size_t value_length, \
+                        void** decoded_key, void* userdata)
+
+typedef struct hmap_wal_codec_s {
+    HMAP_WAL_BYTES_TYPE(key_bytes);
+    HMAP_WAL_BYTES_TYPE(value_bytes);  // called with the item
+    HMAP_WAL_DECODE_TYPE(decode);
+    void* userdata;  // passed to decode
+} hmap_wal_codec_t;
+
+typedef struct hmap_wal_s {
+    hmap_t* map;
+    hmap_wal_codec_t codec;
+    char* path;
+    char* snapshot_path;
+    int fd;
+    mtx_t lock;
+    cnd_t synced;
+    bool syncing;
+    int error;  // errno of the last failed sync, reported to every committer waiting for it
+    char* buffer;  // records appended since the last sync started
+    size_t buffer_length;
+    size_t buffer_capacity;
+    uint64_t appended;  // bytes appended since open, including the buffer
+    uint64_t durable;  // bytes of appended which are synced
+    size_t log_bytes;  // size of the log file
+    size_t snapshot_threshold;
+    size_t syncs;
+    size_t replayed;
+} hmap_wal_t;
+
+/**
+ * Recover the map from the snapshot and the log at path using nthreads threads and open the log for appending. The map
+ * has to be empty, the snapshot is stored at path with the suffix ".snapshot". Return 0 on success, -1 on failure with
+ * errno set, EINVAL if the files are not valid logs or decode returned NULL for a record. The items decoded until then
+ * are left in the map to be released by the caller.
+ */
+int hmap_wal_open(hmap_wal_t* w, hmap_t* m, const char* path, hmap_wal_codec_t* codec, size_t nthreads);
+
+/**
+ * Commit all buffered records, close the log and free all resources. The map is left untouched. Return 0 on success,
+ * -1 if the commit failed with errno set.
+ */
+int hmap_wal_close(hmap_wal_t* w);
+
+/**
+ * Associate the given key with the item in the map and log the association. Possible existing associations will be
+ * overwritten.
+ */
+void hmap_wal_set(hmap_wal_t* w, void* key, hmapitem_t* i);
+
+/**
+ * Return the item associated with the given key. Null if the key has no association.
+ */
+hmapitem_t* hmap_wal_get(hmap_wal_t* w, void* key);
+
+/**
+ * Remove an association from the map and log the removal. Return a pointer to the disassociated item if a association
+ * existed, null otherwise.
+ */
+hmapitem_t* hmap_wal_delete(hmap_wal_t* w, void* key);
+
+/**
+ * Make all records buffered before the call durable. Return 0 on success, -1 on failure with errno set.
+ */
+int hmap_wal_commit(hmap_wal_t* w);
+
+/**
+ * Write all entries of the map to the snapshot file and empty the log. Return 0 on success, -1 on failure with errno
+ * set, the log is left untouched in that case.
+ */
+int hmap_wal_snapshot(hmap_wal_t* w);
+
+/**
+ * Let hmap_wal_commit take a snapshot whenever the log grows beyond log_bytes bytes. 0 disables automatic snapshots,
+ * which is the default.
+ */
+void hmap_wal_snapshot_threshold(hmap_wal_t* w, size_t log_bytes);
+
+/**
+ * Return the number of bytes in the log file.
+ */
+size_t hmap_wal_stats_log_bytes(hmap_wal_t* w);
+
+/**
+ * Return the number of syncs of the log since it was opened.
+ */
+size_t hmap_wal_stats_syncs(hmap_wal_t* w);
+
+/**
+ * Return the number of records read from the snapshot and the log by hmap_wal_open.
+ */
+size_t hmap_wal_stats_replayed(hmap_wal_t* w);
+
+#if defined(IMPL_HMAP_WAL) || defined(_CLANGD)
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+enum { HMAP_WAL_INTERNAL_SET = 1, HMAP_WAL_INTERNAL_DELETE = 2 };
+
+typedef struct hmap_wal_internal_header_s {
+    uint32_t type;
+    uint32_t checksum;
+    uint64_t key_length;
+    uint64_t value_length;
+} hmap_wal_internal_header_t;
+
+/**
+ * internal use only: continue a 64 bit FNV-1a hash over the bytes.
+ */
+uint64_t hmap_wal_internal_fnv(uint64_t hash, const void* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= ((const unsigned char*)bytes)[i];
+        hash *= UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+/**
+ * internal use only: return the checksum of a record.
+ */
+uint32_t hmap_wal_internal_checksum(hmap_wal_internal_header_t* h, const void* key, const void* value) {
+    uint64_t hash = hmap_wal_internal_fnv(UINT64_C(0xcbf29ce484222325), &h->type, sizeof(h->type));
+    hash = hmap_wal_internal_fnv(hash, &h->key_length, sizeof(h->key_length));
+    hash = hmap_wal_internal_fnv(hash, &h->value_length, sizeof(h->value_length));
+    hash = hmap_wal_internal_fnv(hash, key, h->key_length);
+    hash = hmap_wal_internal_fnv(hash, value, h->value_length);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * internal use only: append a record to a growing buffer.
+ */
+void hmap_wal_internal_append(char** buffer, size_t* length, size_t* capacity, uint32_t type, const void* key,
+                              size_t key_length, const void* value, size_t value_length) {
+    hmap_wal_internal_header_t h = {type, 0, key_length, value_length};
+    h.checksum = hmap_wal_internal_checksum(&h, key, value);
+
+    size_t size = sizeof(h) + key_length + value_length;
+    if (*length + size > *capacity) {
+        *capacity = (*length + size) * 2;
+        *buffer = realloc(*buffer, *capacity);
+        assert(*buffer != NULL);
+    }
+
+    memcpy(*buffer + *length, &h, sizeof(h));
+    memcpy(*buffer + *length + sizeof(h), key, key_length);
+    if (value_length > 0) {
+        memcpy(*buffer + *length + sizeof(h) + key_length, value, value_length);
+    }
+    *length += size;
+}
+
+/**
+ * internal use only: write all bytes to fd. Return false on failure.
+ */
+bool hmap_wal_internal_write_all(int fd, const char* bytes, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, bytes, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            return false;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+    return true;
+}
+
+/**
+ * internal use only: read the whole file at path into a malloced buffer. Return 0 on success, an errno value
+ * otherwise, ENOENT if there is no file.
+ */
+int hmap_wal_internal_read_file(const char* path, char** bytes, size_t* length) {
+    *bytes = NULL;
+    *length = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno;
+    }
+
+    struct stat st;
+    int error = fstat(fd, &st) == 0 ? 0 : errno;
+    if (error == 0) {
+        *bytes = malloc(st.st_size > 0 ? (size_t)st.st_size : 1);
+        error = *bytes == NULL ? ENOMEM : 0;
+    }
+    while (error == 0 && *length < (size_t)st.st_size) {
+        ssize_t n = read(fd, *bytes + *length, (size_t)st.st_size - *length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        error = n < 0 ? errno : n == 0 ? EIO : 0;
+        *length += n > 0 ? (size_t)n : 0;
+    }
+
+    close(fd);
+    if (error != 0) {
+        free(*bytes);
+        *bytes = NULL;
+        *length = 0;
+    }
+    return error;
+}
+
+typedef struct hmap_wal_internal_record_s {
+    const char* header;  // points to a hmap_wal_internal_header_t, not aligned
+    size_t hash;  // of the key bytes
+} hmap_wal_internal_record_t;
+
+/**
+ * internal use only: collect the complete records of a log or snapshot file. Return the number of bytes holding
+ * complete records, 0 if the magic is missing.
+ */
+size_t hmap_wal_internal_parse(const char* bytes, size_t length, hmap_wal_internal_record_t** records,
+                               size_t* records_length, size_t* records_capacity) {
+    size_t magic = sizeof(HMAP_WAL_MAGIC) - 1;
+    if (length < magic || memcmp(bytes, HMAP_WAL_MAGIC, magic) != 0) {
+        return 0;
+    }
+
+    size_t offset = magic;
+    while (length - offset >= sizeof(hmap_wal_internal_header_t)) {
+        hmap_wal_internal_header_t h;
+        memcpy(&h, bytes + offset, sizeof(h));
+        size_t available = length - offset - sizeof(h);
+        if ((h.type != HMAP_WAL_INTERNAL_SET && h.type != HMAP_WAL_INTERNAL_DELETE) || h.key_length > available ||
+            h.value_length > available - h.key_length) {
+            break;
+        }
+
+        const char* key = bytes + offset + sizeof(h);
+        if (hmap_wal_internal_checksum(&h, key, key + h.key_length) != h.checksum) {
+            break;
+        }
+
+        if (*records_length == *records_capacity) {
+            *records_capacity = *records_capacity == 0 ? 1024 : *records_capacity * 2;
+            *records = realloc(*records, *records_capacity * sizeof(hmap_wal_internal_record_t));
+            assert(*records != NULL);
+        }
+        (*records)[(*records_length)++] = (hmap_wal_internal_record_t){
+            bytes + offset, hmap_hash_mix(hmap_wal_internal_fnv(UINT64_C(0xcbf29ce484222325), key, h.key_length))};
+        offset += sizeof(h) + h.key_length + h.value_length;
+    }
+    return offset;
+}
+
+typedef struct hmap_wal_internal_key_s {
+    const void* bytes;
+    size_t length;
+} hmap_wal_internal_key_t;
+
+typedef struct hmap_wal_internal_last_s {
+    hmap_wal_internal_key_t key;
+    hmap_wal_internal_record_t* record;  // the last record of the key
+    HMAPITEM_PROP();
+} hmap_wal_internal_last_t;
+
+/**
+ * internal use only: hash function of the key bytes during replay.
+ */
+size_t hmap_wal_internal_key_hash(void* key) {
+    hmap_wal_internal_key_t* k = key;
+    return hmap_wal_internal_fnv(UINT64_C(0xcbf29ce484222325), k->bytes, k->length);
+}
+
+/**
+ * internal use only: equals function of the key bytes during replay.
+ */
+bool hmap_wal_internal_key_equals(void* a, void* b) {
+    hmap_wal_internal_key_t* ka = a;
+    hmap_wal_internal_key_t* kb = b;
+    return ka->length == kb->length && memcmp(ka->bytes, kb->bytes, ka->length) == 0;
+}
+
+typedef struct hmap_wal_internal_replay_s {
+    hmap_wal_codec_t* codec;
+    size_t nthreads;
+    hmap_wal_internal_record_t** partitions;  // the records of every partition in log order
+    size_t* partition_begin;  // nthreads + 1 offsets into keys and items
+    size_t* survivors;  // per partition: number of decoded items
+    int* errors;  // per partition: EINVAL if decode failed
+    void** keys;
+    hmapitem_t** items;
+} hmap_wal_internal_replay_t;
+
+/**
+ * internal use only: find the last record of every key of a partition and decode the keys which were set last.
+ */
+int hmap_wal_internal_replay_partition(void* arg) {
+    hmap_internal_worker_t* w = arg;
+    hmap_wal_internal_replay_t* r = w->shared;
+
+    size_t begin = r->partition_begin[w->id];
+    size_t length = r->partition_begin[w->id + 1] - begin;
+    hmap_wal_internal_record_t* records = r->partitions[w->id];
+    hmap_wal_internal_last_t* lasts = calloc(length > 0 ? length : 1, sizeof(hmap_wal_internal_last_t));
+    assert(lasts != NULL);
+
+    hmap_t last;
+    hmap_init(&last, hmap_wal_internal_key_hash, hmap_wal_internal_key_equals);
+    for (size_t k = 0; k < length; k++) {
+        hmap_wal_internal_header_t h;
+        memcpy(&h, records[k].header, sizeof(h));
+        hmap_wal_internal_key_t key = {records[k].header + sizeof(h), h.key_length};
+
+        hmapitem_t* existing = hmap_get(&last, &key);
+        if (existing != NULL) {
+            HMAPITEM_AS(hmap_wal_internal_last_t, existing)->record = &records[k];
+        } else {
+            lasts[k].key = key;
+            lasts[k].record = &records[k];
+            hmap_set(&last, &lasts[k].key, HMAPITEM_OF(hmap_wal_internal_last_t, &lasts[k]));
+        }
+    }
+
+    size_t survivors = 0;
+    HMAP_ITER(entry, &last) {
+        if (*entry == NULL) {
+            continue;
+        }
+
+        hmap_wal_internal_record_t* record = HMAPITEM_AS(hmap_wal_internal_last_t, *entry)->record;
+        hmap_wal_internal_header_t h;
+        memcpy(&h, record->header, sizeof(h));
+        if (h.type == HMAP_WAL_INTERNAL_SET) {
+            const char* key = record->header + sizeof(h);
+            hmapitem_t* i = r->codec->decode(key, h.key_length, key + h.key_length, h.value_length,
+                                             &r->keys[begin + survivors], r->codec->userdata);
+            if (i == NULL) {
+                r->errors[w->id] = EINVAL;
+                break;
+            }
+            r->items[begin + survivors++] = i;
+        }
+    }
+    r->survivors[w->id] = survivors;
+
+    hmap_destroy(&last);
+    free(lasts);
+    return 0;
+}
+
+/**
+ * internal use only: replay the records into the empty map m. Return 0 on success, an errno value otherwise.
+ */
+int hmap_wal_internal_replay(hmap_t* m, hmap_wal_codec_t* codec, hmap_wal_internal_record_t* records, size_t length,
+                             size_t nthreads) {
+    if (length == 0) {
+        return 0;
+    }
+
+    hmap_wal_internal_replay_t r = {0};
+    r.codec = codec;
+    r.nthreads = nthreads;
+    r.partitions = malloc(nthreads * sizeof(hmap_wal_internal_record_t*));
+    r.partition_begin = calloc(2 * nthreads + 1, sizeof(size_t));
+    hmap_wal_internal_record_t* scattered = malloc(length * sizeof(hmap_wal_internal_record_t));
+    r.keys = malloc(length * sizeof(void*));
+    r.items = malloc(length * sizeof(hmapitem_t*));
+    r.errors = calloc(nthreads, sizeof(int));
+    if (r.partitions == NULL || r.partition_begin == NULL || scattered == NULL || r.keys == NULL || r.items == NULL ||
+        r.errors == NULL) {
+        free(r.partitions);
+        free(r.partition_begin);
+        free(scattered);
+        free(r.keys);
+        free(r.items);
+        free(r.errors);
+        return ENOMEM;
+    }
+    r.survivors = r.partition_begin + nthreads + 1;
+
+    // stable counting sort by partition keeps the log order within every partition
+    for (size_t k = 0; k < length; k++) {
+        r.partition_begin[records[k].hash % nthreads + 1]++;
+    }
+    for (size_t t = 0; t < nthreads; t++) {
+        r.partition_begin[t + 1] += r.partition_begin[t];
+        r.partitions[t] = scattered + r.partition_begin[t];
+        r.survivors[t] = 0;
+    }
+    for (size_t k = 0; k < length; k++) {
+        size_t t = records[k].hash % nthreads;
+        r.partitions[t][r.survivors[t]++] = records[k];
+    }
+
+    hmap_internal_worker_t workers[nthreads];
+    for (size_t t = 0; t < nthreads; t++) {
+        workers[t].shared = &r;
+        workers[t].id = t;
+    }
+    hmap_internal_parallel(hmap_wal_internal_replay_partition, workers, nthreads);
+
+    // the partitions hold disjoint keys, compact their items and insert them all at once. Items decoded before a
+    // failed decode are inserted as well, so the caller can release them.
+    size_t n = 0;
+    int error = 0;
+    for (size_t t = 0; t < nthreads; t++) {
+        error = error != 0 ? error : r.errors[t];
+        memmove(&r.keys[n], &r.keys[r.partition_begin[t]], r.survivors[t] * sizeof(void*));
+        memmove(&r.items[n], &r.items[r.partition_begin[t]], r.survivors[t] * sizeof(hmapitem_t*));
+        n += r.survivors[t];
+    }
+
+    if (hmap_build_parallel(m, r.keys, r.items, n, nthreads) != 0) {
+        hmap_set_many(m, r.keys, r.items, n);
+    }
+
+    free(r.partitions);
+    free(r.partition_begin);
+    free(scattered);
+    free(r.keys);
+    free(r.items);
+    free(r.errors);
+    return error;
+}
+
+/**
+ * internal use only: write the current log buffer and sync it. Called with the lock held, releases it while writing.
+ * Return 0 on success, an errno value otherwise.
+ */
+int hmap_wal_internal_sync(hmap_wal_t* w) {
+    char* buffer = w->buffer;
+    size_t length = w->buffer_length;
+    uint64_t end = w->appended;
+
+    // new records go to a fresh buffer while this one is written
+    w->buffer = NULL;
+    w->buffer_length = 0;
+    w->buffer_capacity = 0;
+    w->syncing = true;
+    mtx_unlock(&w->lock);
+
+    int error = hmap_wal_internal_write_all(w->fd, buffer, length) && fdatasync(w->fd) == 0 ? 0 : errno;
+
+    mtx_lock(&w->lock);
+    w->syncing = false;
+    w->error = error;
+    w->syncs++;
+    if (error == 0) {
+        w->durable = end;
+        w->log_bytes += length;
+        free(buffer);
+    } else {
+        // drop a partially written record and keep the records for the next attempt in front of the ones appended
+        // meanwhile
+        if (ftruncate(w->fd, (off_t)w->log_bytes) != 0) {
+            w->error = errno;
+        }
+        size_t capacity = length + w->buffer_length;
+        buffer = realloc(buffer, capacity > 0 ? capacity : 1);
+        assert(buffer != NULL);
+        if (w->buffer_length > 0) {
+            memcpy(buffer + length, w->buffer, w->buffer_length);
+        }
+        free(w->buffer);
+        w->buffer = buffer;
+        w->buffer_length = capacity;
+        w->buffer_capacity = capacity;
+    }
+    cnd_broadcast(&w->synced);
+    return error;
+}
+
+/**
+ * internal use only: empty the log file, leaving only the magic. Return 0 on success, an errno value otherwise.
+ */
+int hmap_wal_internal_reset_log(hmap_wal_t* w) {
+    size_t magic = sizeof(HMAP_WAL_MAGIC) - 1;
+    if (ftruncate(w->fd, 0) != 0 || !hmap_wal_internal_write_all(w->fd, HMAP_WAL_MAGIC, magic) ||
+        fdatasync(w->fd) != 0) {
+        return errno;
+    }
+    w->log_bytes = magic;
+    return 0;
+}
+
+/**
+ * internal use only: sync the directory holding the file at path, which makes a rename to path durable. Return 0 on
+ * success, an errno value otherwise.
+ */
+int hmap_wal_internal_sync_dir(const char* path) {
+    const char* slash = strrchr(path, '/');
+    size_t length = slash == NULL ? 0 : slash == path ? 1 : (size_t)(slash - path);
+    char* dir = malloc(length + 2);
+    assert(dir != NULL);
+    if (length == 0) {
+        strcpy(dir, ".");
+    } else {
+        memcpy(dir, path, length);
+        dir[length] = '\0';
+    }
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd < 0) {
+        return errno;
+    }
+    int error = fsync(fd) == 0 ? 0 : errno;
+    close(fd);
+    return error;
+}
+
+/**
+ * internal use only: write a snapshot of the map. Called with the lock held, releases it while syncing buffered records
+ * into the log. Return 0 on success, an errno value otherwise.
+ */
+int hmap_wal_internal_snapshot(hmap_wal_t* w) {
+    // the log has to be a prefix of the history the snapshot reflects: a crash before the log is reset replays the log
+    // on top of the snapshot, a record still buffered would otherwise be rolled back by an older record of its key
+    while (w->syncing || w->buffer_length > 0) {
+        if (w->syncing) {
+            cnd_wait(&w->synced, &w->lock);
+        } else {
+            int error = hmap_wal_internal_sync(w);
+            if (error != 0) {
+                return error;
+            }
+        }
+    }
+
+    size_t length = 0;
+    size_t capacity = sizeof(HMAP_WAL_MAGIC) - 1;
+    char* buffer = malloc(capacity);
+    assert(buffer != NULL);
+    memcpy(buffer, HMAP_WAL_MAGIC, capacity);
+    length = capacity;
+
+    HMAP_ITER(entry, w->map) {
+        if (*entry != NULL) {
+            const void* key;
+            const void* value;
+            size_t key_length = w->codec.key_bytes((*entry)->key, &key);
+            size_t value_length = w->codec.value_bytes(*entry, &value);
+            hmap_wal_internal_append(&buffer, &length, &capacity, HMAP_WAL_INTERNAL_SET, key, key_length, value,
+                                     value_length);
+        }
+    }
+
+    char* tmp_path = malloc(strlen(w->snapshot_path) + sizeof(".tmp"));
+    assert(tmp_path != NULL);
+    sprintf(tmp_path, "%s.tmp", w->snapshot_path);
+
+    int error = 0;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = errno;
+    } else {
+        error = hmap_wal_internal_write_all(fd, buffer, length) && fsync(fd) == 0 ? 0 : errno;
+        if (close(fd) != 0 && error == 0) {
+            error = errno;
+        }
+        if (error == 0 && rename(tmp_path, w->snapshot_path) != 0) {
+            error = errno;
+        }
+        if (error != 0) {
+            unlink(tmp_path);
+        }
+    }
+    free(tmp_path);
+    free(buffer);
+
+    // the rename has to be durable before the log is emptied, otherwise a crash could leave the old snapshot with an
+    // empty log
+    if (error == 0) {
+        error = hmap_wal_internal_sync_dir(w->snapshot_path);
+    }
+
+    // every record of the log is contained in the snapshot, the log can start over. A crash before the log is reset
+    // replays the log on top of the snapshot, which yields the same map.
+    if (error == 0) {
+        error = hmap_wal_internal_reset_log(w);
+    }
+    return error;
+}
+
+int hmap_wal_open(hmap_wal_t* w, hmap_t* m, const char* path, hmap_wal_codec_t* codec, size_t nthreads) {
+    assert(w != NULL);
+    assert(m != NULL);
+    assert(path != NULL);
+    assert(codec != NULL);
+    assert(codec->key_bytes != NULL && codec->value_bytes != NULL && codec->decode != NULL);
+    assert(hmap_length(m) == 0);
+
+    memset(w, 0, sizeof(hmap_wal_t));
+    w->map = m;
+    w->codec = *codec;
+    w->fd = -1;
+    w->path = malloc(strlen(path) + 1);
+    w->snapshot_path = malloc(strlen(path) + sizeof(".snapshot"));
+    assert(w->path != NULL && w->snapshot_path != NULL);
+    strcpy(w->path, path);
+    sprintf(w->snapshot_path, "%s.snapshot", path);
+    nthreads = nthreads == 0 ? 1 : nthreads;
+
+    char* snapshot = NULL;
+    size_t snapshot_length = 0;
+    char* log = NULL;
+    size_t log_length = 0;
+    hmap_wal_internal_record_t* records = NULL;
+    size_t records_length = 0;
+    size_t records_capacity = 0;
+
+    int error = hmap_wal_internal_read_file(w->snapshot_path, &snapshot, &snapshot_length);
+    error = error == ENOENT ? 0 : error;
+    if (error == 0 && snapshot != NULL &&
+        hmap_wal_internal_parse(snapshot, snapshot_length, &records, &records_length, &records_capacity) !=
+            snapshot_length) {
+        // snapshots are renamed into place when complete, a damaged one can not be the result of a crash
+        error = EINVAL;
+    }
+
+    size_t log_valid = 0;
+    if (error == 0) {
+        error = hmap_wal_internal_read_file(w->path, &log, &log_length);
+        error = error == ENOENT ? 0 : error;
+    }
+    if (error == 0 && log_length > 0) {
+        log_valid = hmap_wal_internal_parse(log, log_length, &records, &records_length, &records_capacity);
+        if (log_valid == 0 && log_length >= sizeof(HMAP_WAL_MAGIC) - 1) {
+            error = EINVAL;
+        }
+    }
+
+    if (error == 0) {
+        w->replayed = records_length;
+        error = hmap_wal_internal_replay(m, &w->codec, records, records_length, nthreads);
+    }
+    free(records);
+    free(snapshot);
+    free(log);
+
+    // continue behind the last complete record, a log without magic is started over
+    if (error == 0) {
+        w->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        error = w->fd < 0 ? errno : 0;
+    }
+    if (error == 0 && log_valid == 0) {
+        error = hmap_wal_internal_reset_log(w);
+    } else if (error == 0 && log_valid < log_length) {
+        error = ftruncate(w->fd, (off_t)log_valid) == 0 && fdatasync(w->fd) == 0 ? 0 : errno;
+    }
+    w->log_bytes = log_valid > 0 ? log_valid : w->log_bytes;
+
+    if (error != 0) {
+        if (w->fd >= 0) {
+            close(w->fd);
+        }
+        free(w->path);
+        free(w->snapshot_path);
+        memset(w, 0, sizeof(hmap_wal_t));
+        errno = error;
+        return -1;
+    }
+
+    mtx_init(&w->lock, mtx_plain);
+    cnd_init(&w->synced);
+    return 0;
+}
+
+int hmap_wal_close(hmap_wal_t* w) {
+    assert(w != NULL);
+
+    int ret = hmap_wal_commit(w);
+    int error = errno;
+
+    close(w->fd);
+    mtx_destroy(&w->lock);
+    cnd_destroy(&w->synced);
+    free(w->buffer);
+    free(w->path);
+    free(w->snapshot_path);
+    memset(w, 0, sizeof(hmap_wal_t));
+
+    errno = error;
+    return ret;
+}
+
+void hmap_wal_set(hmap_wal_t* w, void* key, hmapitem_t* i) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    hmap_set(w->map, key, i);
+
+    const void* key_bytes;
+    const void* value_bytes;
+    size_t key_length = w->codec.key_bytes(key, &key_bytes);
+    size_t value_length = w->codec.value_bytes(i, &value_bytes);
+    size_t length = w->buffer_length;
+    hmap_wal_internal_append(&w->buffer, &w->buffer_length, &w->buffer_capacity, HMAP_WAL_INTERNAL_SET, key_bytes,
+                             key_length, value_bytes, value_length);
+    w->appended += w->buffer_length - length;
+    mtx_unlock(&w->lock);
+}
+
+hmapitem_t* hmap_wal_get(hmap_wal_t* w, void* key) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    hmapitem_t* i = hmap_get(w->map, key);
+    mtx_unlock(&w->lock);
+    return i;
+}
+
+hmapitem_t* hmap_wal_delete(hmap_wal_t* w, void* key) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    hmapitem_t* i = hmap_delete(w->map, key);
+    if (i != NULL) {
+        const void* key_bytes;
+        size_t key_length = w->codec.key_bytes(key, &key_bytes);
+        size_t length = w->buffer_length;
+        hmap_wal_internal_append(&w->buffer, &w->buffer_length, &w->buffer_capacity, HMAP_WAL_INTERNAL_DELETE,
+                                 key_bytes, key_length, NULL, 0);
+        w->appended += w->buffer_length - length;
+    }
+    mtx_unlock(&w->lock);
+    return i;
+}
+
+int hmap_wal_commit(hmap_wal_t* w) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    uint64_t target = w->appended;
+    int error = 0;
+    while (w->durable < target && error == 0) {
+        if (w->syncing) {
+            // the running sync may not cover target, check again once it is done
+            cnd_wait(&w->synced, &w->lock);
+            error = w->durable < target ? w->error : 0;
+        } else {
+            error = hmap_wal_internal_sync(w);
+        }
+    }
+
+    if (error == 0 && w->snapshot_threshold > 0 && w->log_bytes > w->snapshot_threshold) {
+        error = hmap_wal_internal_snapshot(w);
+    }
+    mtx_unlock(&w->lock);
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+int hmap_wal_snapshot(hmap_wal_t* w) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    int error = hmap_wal_internal_snapshot(w);
+    mtx_unlock(&w->lock);
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+void hmap_wal_snapshot_threshold(hmap_wal_t* w, size_t log_bytes) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    w->snapshot_threshold = log_bytes;
+    mtx_unlock(&w->lock);
+}
+
+size_t hmap_wal_stats_log_bytes(hmap_wal_t* w) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    size_t log_bytes = w->log_bytes;
+    mtx_unlock(&w->lock);
+    return log_bytes;
+}
+
+size_t hmap_wal_stats_syncs(hmap_wal_t* w) {
+    assert(w != NULL);
+
+    mtx_lock(&w->lock);
+    size_t syncs = w->syncs;
+    mtx_unlock(&w->lock);
+    return syncs;
+}
+
+size_t hmap_wal_stats_replayed(hmap_wal_t* w) {
+    assert(w != NULL);
+    return w->replayed;
+}
+
+#endif
+#endif
@@ -0,0 +1,330 @@
+/*
+
+# Hash Set
+
+An open addressing hash set using linear probing, the key only counterpart of hmap.h. The table stores the key
+pointers themselves, there is no hmapitem_t per element and a probe compares keys without dereferencing an item first.
+Probing, deletion by backward shifting and the managed capacity policy are the same as in hmap.h and the hash and
+equals functions of a hmap_t can be used unchanged. NULL can not be stored as key.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting `IMPL_HSET` before. Do this only once e.g. in main.c.
+The implementation of hmap.h is needed as well.
+
+```
+#define IMPL_HMAP
+#include "hmap.h"
+#define IMPL_HSET
+#include "hset.h"
+```
+
+After that include hset.h like a normal header everywhere the declarations are needed
+```
+#include "hset.h"
+```
+
+### Basic Usage
+
+```
+hset_t seen;
+hset_init(&seen, hmap_hash_str, hmap_equals_str);
+
+for (size_t i = 0; i < words_length; i++) {
+    if (!hset_add(&seen, words[i])) {
+        printf("duplicate: %s\n", words[i]);
+    }
+}
+
+hset_destroy(&seen);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_HSET_H
+#define DS_HSET_H
+#include <stddef.h>
+
+#include "hmap.h"
+
+typedef struct hset_s {
+    bool managed;
+    float managed_min_load;
+    float managed_max_load;
+    size_t managed_min_capacity;
+    size_t length;
+    size_t capacity;
+    void** data;
+    HMAP_HASH_TYPE(hash);
+    HMAP_EQUALS_TYPE(equals);
+} hset_t;
+
+/**
+ * Iterate over all keys in a set, entry points to a slot which holds a key or NULL.
+ */
+#define HSET_ITER(entry, set) for (void** entry = (set)->data; entry < ((set)->data + (set)->capacity); entry++)
+
+/**
+ * Initialize a managed set.
+ * Managed means that the set manages its capacity according to its load factor.
+ */
+void hset_init(hset_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals));
+
+/**
+ * Initialize an unmanaged set.
+ * Unmanaged sets do not automatically adjust their capacity. hset_add does not add keys to a full set, check if length
+ * < capacity before adding.
+ */
+void hset_init_unmanaged(hset_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t capacity);
+
+/**
+ * Enable automatic capacity management.
+ * See hset_init.
+ */
+void hset_managed(hset_t* s, float min_load, float max_load, size_t min_capacity);
+
+/**
+ * Disable automatic capacity management.
+ * See hset_init_unmanaged.
+ */
+void hset_unmanaged(hset_t* s);
+
+/**
+ * Adjust the sets capacity according to the current load factor and the load factor limits.
+ */
+int hset_manage(hset_t* s);
+
+/**
+ * Adjust the sets capacity.
+ */
+void hset_adjust_capacity(hset_t* s, size_t capacity);
+
+/**
+ * Free all resources allocated by a call to hset_init*() functions.
+ */
+void hset_destroy(hset_t* s);
+
+/**
+ * Return the number of keys in the set.
+ */
+size_t hset_length(hset_t* s);
+
+/**
+ * Return the maximum number of keys the set can hold.
+ */
+size_t hset_capacity(hset_t* s);
+
+/**
+ * Calculate the load factor (length/capacity = [0, 1]) of the set.
+ */
+float hset_stats_load_factor(hset_t* s);
+
+/**
+ * Add the key to the set. Return true if it was added, false if an equal key was already in the set, which is kept, or
+ * if the unmanaged set is full.
+ */
+bool hset_add(hset_t* s, void* key);
+
+/**
+ * Return true if an equal key is in the set, false otherwise.
+ */
+bool hset_has(hset_t* s, void* key);
+
+/**
+ * Return the key in the set which equals the given key. Null if there is none.
+ */
+void* hset_get(hset_t* s, void* key);
+
+/**
+ * Remove the key which equals the given key from the set. Return the removed key, null if there was none.
+ */
+void* hset_delete(hset_t* s, void* key);
+
+/**
+ * Call iter on every key in the set.
+ */
+void hset_foreach(hset_t* s, void (*iter)(void* key, void*), void* userdata);
+
+#if defined(IMPL_HSET) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+void hset_init_unmanaged(hset_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals), size_t initial_capacity) {
+    assert(s != NULL);
+
+    memset(s, 0, sizeof(hset_t));
+    s->managed = false;
+    s->managed_min_load = 0.;
+    s->managed_max_load = 1.;
+    s->data = calloc(initial_capacity, sizeof(void*));
+    s->capacity = initial_capacity;
+    s->hash = hash;
+    s->equals = equals;
+}
+
+void hset_init(hset_t* s, HMAP_HASH_TYPE(hash), HMAP_EQUALS_TYPE(equals)) {
+    hset_init_unmanaged(s, hash, equals, HMAP_INITIAL_CAPACITY);
+    hset_managed(s, .2, .6, HMAP_INITIAL_CAPACITY);
+}
+
+void hset_managed(hset_t* s, float min_load, float max_load, size_t min_capacity) {
+    assert(s != NULL);
+
+    s->managed = true;
+    s->managed_min_load = min_load;
+    s->managed_max_load = max_load;
+    s->managed_min_capacity = min_capacity;
+}
+
+void hset_unmanaged(hset_t* s) {
+    assert(s != NULL);
+
+    s->managed = false;
+}
+
+int hset_manage(hset_t* s) {
+    assert(s != NULL);
+
+    size_t capacity = hmap_internal_managed_capacity(s->length, s->capacity, s->managed_min_load,
+                                                     s->managed_max_load, s->managed_min_capacity);
+    if (capacity == s->capacity) {
+        return 0;
+    }
+
+    int ret = capacity < s->capacity ? -1 : 1;
+    hset_adjust_capacity(s, capacity);
+    return ret;
+}
+
+void hset_adjust_capacity(hset_t* s, size_t new_capacity) {
+    assert(s != NULL);
+    assert(new_capacity >= s->length);
+
+    size_t capacity = s->capacity;
+    void** data = s->data;
+
+    s->data = calloc(new_capacity, sizeof(void*));
+    s->capacity = new_capacity;
+
+    // keys are unique, every key goes into the first empty slot of its probe sequence
+    for (size_t i = 0; i < capacity; i++) {
+        if (data[i] != NULL) {
+            size_t index = s->hash(data[i]) % s->capacity;
+            while (s->data[index] != NULL) {
+                index = (index + 1) % s->capacity;
+            }
+            s->data[index] = data[i];
+        }
+    }
+
+    free(data);
+}
+
+void hset_destroy(hset_t* s) {
+    assert(s != NULL);
+    free(s->data);
+    memset(s, 0, sizeof(hset_t));
+}
+
+size_t hset_length(hset_t* s) {
+    assert(s != NULL);
+    return s->length;
+}
+
+size_t hset_capacity(hset_t* s) {
+    assert(s != NULL);
+    return s->capacity;
+}
+
+float hset_stats_load_factor(hset_t* s) {
+    assert(s != NULL);
+    return s->length / (float)s->capacity;
+}
+
+bool hset_add(hset_t* s, void* key) {
+    assert(s != NULL);
+    assert(key != NULL);
+
+    size_t index = hmap_internal_probe(s->data, s->capacity, s->hash(key), key, s->equals, true);
+    if (index == s->capacity || s->data[index] != NULL) {
+        return false;
+    }
+
+    s->data[index] = key;
+    s->length++;
+
+    if (s->managed) {
+        hset_manage(s);
+    }
+    return true;
+}
+
+bool hset_has(hset_t* s, void* key) {
+    assert(s != NULL);
+
+    return hset_get(s, key) != NULL;
+}
+
+void* hset_get(hset_t* s, void* key) {
+    assert(s != NULL);
+
+    if (s->length == 0) {
+        return NULL;
+    }
+
+    size_t index = hmap_internal_probe(s->data, s->capacity, s->hash(key), key, s->equals, true);
+    return index < s->capacity ? s->data[index] : NULL;
+}
+
+void* hset_delete(hset_t* s, void* key) {
+    assert(s != NULL);
+
+    if (s->length == 0) {
+        return NULL;
+    }
+
+    size_t index = hmap_internal_probe(s->data, s->capacity, s->hash(key), key, s->equals, true);
+    if (index == s->capacity || s->data[index] == NULL) {
+        return NULL;
+    }
+
+    void* removed = s->data[index];
+    hmap_internal_backshift(s->data, s->capacity, index, s->hash, true);
+    s->length--;
+
+    if (s->managed) {
+        hset_manage(s);
+    }
+    return removed;
+}
+
+void hset_foreach(hset_t* s, void (*iter)(void* key, void*), void* userdata) {
+    assert(s != NULL);
+    assert(iter != NULL);
+
+    for (size_t i = 0; i < s->capacity; i++) {
+        if (s->data[i] != NULL) {
+            iter(s->data[i], userdata);
+        }
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,604 @@
+/*
+
+# Indexed List
+
+A doubly linked list with an order statistic index for positional access. Every ilistitem_t embeds a listitem_t, the
+items are chained exactly like in list.h, so LIST_ITER and LIST_ITER_REVERSE work on `il.list.first`/`il.list.last`.
+Additionally the items form a treap (a randomized balanced binary tree) ordered by their position with the size of
+every subtree in the node, which makes ilist_get, ilist_insert_at, ilist_remove_index and ilist_index_of O(log n)
+expected instead of the O(n) walk of list_get.
+
+Items pushed or unshifted are only chained and counted as pending, they join the index in one O(k + log n) step the next
+time a positional operation needs it. ilist_push, ilist_unshift and popping or unlinking pending items are therefore
+O(1), popping or unlinking indexed items costs O(log n) expected for the subtree sizes of their ancestors.
+
+Items must only be removed with the ilist functions, listitem_unlink on an indexed item corrupts the index.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting IMPL_ILIST before. Do this only once e.g. in main.c.
+The implementation of list.h is needed as well.
+
+```
+#define IMPL_LIST
+#include "list.h"
+#define IMPL_ILIST
+#include "ilist.h"
+```
+
+After that include ilist.h like a normal header everywhere the declarations are needed
+```
+#include "ilist.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    char title[32];
+    ILISTITEM_PROP();
+} track;
+
+ilist_t playlist;
+ilist_init(&playlist);
+
+track a = {0}, b = {0};
+ilistitem_init(ILISTITEM_OF(track, &a));
+ilistitem_init(ILISTITEM_OF(track, &b));
+
+ilist_push(&playlist, ILISTITEM_OF(track, &a));
+ilist_insert_at(&playlist, 0, ILISTITEM_OF(track, &b));
+
+track* t = ILIST_GET(track, &playlist, 1);
+ilist_remove_index(&playlist, 0);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_ILIST_H
+#define DS_ILIST_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#if LIST_COMPACT
+#error "ilist.h finds the list of an item via list_ptr and does not support LIST_COMPACT"
+#endif
+
+// Get the nth item of the list and return a pointer to the struct holding the item.
+#define ILIST_GET_s(type, list, index, property_name) \
+    ((ilist_length(list) > (index)) ? ILISTITEM_AS_s(type, ilist_get(list, index), property_name) : NULL)
+
+// Get the nth item of the list and return a pointer to the struct holding the item using the default item property
+// name.
+#define ILIST_GET(type, list, index) ILIST_GET_s(type, list, index, default_ilist_item_name)
+
+/**
+ * Inject a ilistitem_t property with a given name into a struct.
+ */
+#define ILISTITEM_PROP_s(item_name) ilistitem_t item_name
+
+/**
+ * Inject a ilistitem_t struct with the default property name into a struct.
+ */
+#define ILISTITEM_PROP() ILISTITEM_PROP_s(default_ilist_item_name)
+
+/**
+ * Convert a type + pointer + property name to a list item.
+ */
+#define ILISTITEM_OF_s(type, data_ptr, item_name) (ilistitem_t*)(((char*)data_ptr) + offsetof(type, item_name))
+
+/**
+ * Convert a type + pointer to a list item using the default property name.
+ */
+#define ILISTITEM_OF(type, data_ptr) ILISTITEM_OF_s(type, data_ptr, default_ilist_item_name)
+
+/**
+ * Convert a ilistitem_t to a pointer to its holding struct using the offset of the given property's name.
+ */
+#define ILISTITEM_AS_s(type, ptr, property_name) ((type*)(((char*)ptr) - ((char*)offsetof(type, property_name))))
+
+/**
+ * Convert a ilistitem_t to a pointer to its holding struct using the offset of the default property name.
+ */
+#define ILISTITEM_AS(type, ptr) ILISTITEM_AS_s(type, ptr, default_ilist_item_name)
+
+/**
+ * Iterate over the items of an indexed list, iter_name is a ilistitem_t*.
+ */
+#define ILIST_ITER(iter_name, ilist)                                                    \
+    for (ilistitem_t* iter_name = (ilistitem_t*)(ilist)->list.first; iter_name != NULL; \
+         iter_name = (ilistitem_t*)iter_name->item.next)
+
+typedef enum {
+    ILIST_INDEXED,  // the item is part of the treap
+    ILIST_PENDING_HEAD,  // the item was unshifted and is not yet part of the treap
+    ILIST_PENDING_TAIL,  // the item was pushed and is not yet part of the treap
+} ilist_state_t;
+
+typedef struct ilistitem_s {
+    listitem_t item;  // must be the first member, list items and indexed items are converted by casting
+    struct ilistitem_s* parent;
+    struct ilistitem_s* left;
+    struct ilistitem_s* right;
+    LIST_LENGTH_TYPE size;  // number of items in the subtree rooted at this item
+    uint32_t priority;  // treap heap priority, parents have a higher priority than their children
+    ilist_state_t state;
+} ilistitem_t;
+
+typedef struct {
+    list_t list;  // must be the first member, the list_ptr of the items points here
+    ilistitem_t* root;
+    LIST_LENGTH_TYPE head_pending;  // the first head_pending items of the list are not indexed
+    LIST_LENGTH_TYPE tail_pending;  // the last tail_pending items of the list are not indexed
+    uint64_t random;
+} ilist_t;
+
+/**
+ * Initialize an indexed list.
+ */
+void ilist_init(ilist_t* il);
+
+/**
+ * Returns the number of items in the list.
+ */
+LIST_LENGTH_TYPE ilist_length(ilist_t* il);
+
+/**
+ * Add an item to the end of the list. Runtime O(1).
+ */
+void ilist_push(ilist_t* il, ilistitem_t* i);
+
+/**
+ * Remove an item from the end of the list and return it or NULL if the list is empty.
+ */
+ilistitem_t* ilist_pop(ilist_t* il);
+
+/**
+ * Add an item to the beginning of the list. Runtime O(1).
+ */
+void ilist_unshift(ilist_t* il, ilistitem_t* i);
+
+/**
+ * Remove an item from the beginning of the list and return it or NULL if the list is empty.
+ */
+ilistitem_t* ilist_shift(ilist_t* il);
+
+/**
+ * Get the nth item in the list or NULL if the index points outside the list. Runtime O(log n) expected.
+ */
+ilistitem_t* ilist_get(ilist_t* il, LIST_LENGTH_TYPE index);
+
+/**
+ * Insert an item so that it ends up at the given index, index must not be larger than the length of the list. Runtime
+ * O(log n) expected.
+ */
+void ilist_insert_at(ilist_t* il, LIST_LENGTH_TYPE index, ilistitem_t* i);
+
+/**
+ * Remove the item at the given index, return the item or NULL if the index points outside the list. Runtime O(log n)
+ * expected.
+ */
+ilistitem_t* ilist_remove_index(ilist_t* il, LIST_LENGTH_TYPE index);
+
+/**
+ * Return the index of an item contained in the list. Runtime O(log n) expected.
+ */
+LIST_LENGTH_TYPE ilist_index_of(ilist_t* il, ilistitem_t* i);
+
+/**
+ * Initialize an indexed list item.
+ */
+void ilistitem_init(ilistitem_t* i);
+
+/**
+ * Remove the item from the indexed list it currently is contained in.
+ */
+void ilistitem_unlink(ilistitem_t* i);
+
+/**
+ * Check if the item is currently in a list.
+ */
+bool ilistitem_in_list(ilistitem_t* i);
+
+#if defined(IMPL_ILIST) || defined(_CLANGD)
+#include <assert.h>
+#include <string.h>
+
+/**
+ * internal use only: return the number of items in the subtree, 0 for NULL.
+ */
+LIST_LENGTH_TYPE ilist_internal_size(ilistitem_t* n) { return n != NULL ? n->size : 0; }
+
+/**
+ * internal use only: recalculate the subtree size of a node from its children.
+ */
+void ilist_internal_update(ilistitem_t* n) {
+    n->size = 1 + ilist_internal_size(n->left) + ilist_internal_size(n->right);
+}
+
+/**
+ * internal use only: return the next treap priority.
+ */
+uint32_t ilist_internal_priority(ilist_t* il) {
+    // xorshift
+    il->random ^= il->random << 13;
+    il->random ^= il->random >> 7;
+    il->random ^= il->random << 17;
+    return (uint32_t)(il->random >> 32);
+}
+
+/**
+ * internal use only: replace the child old of parent (or the root if parent is NULL) with n.
+ */
+void ilist_internal_replace(ilist_t* il, ilistitem_t* parent, ilistitem_t* old, ilistitem_t* n) {
+    if (parent == NULL) {
+        il->root = n;
+    } else if (parent->left == old) {
+        parent->left = n;
+    } else {
+        parent->right = n;
+    }
+    if (n != NULL) {
+        n->parent = parent;
+    }
+}
+
+/**
+ * internal use only: rotate n above its parent, the order of the items is kept.
+ */
+void ilist_internal_rotate_up(ilist_t* il, ilistitem_t* n) {
+    ilistitem_t* p = n->parent;
+    ilist_internal_replace(il, p->parent, p, n);
+
+    if (p->left == n) {
+        p->left = n->right;
+        if (n->right != NULL) {
+            n->right->parent = p;
+        }
+        n->right = p;
+    } else {
+        p->right = n->left;
+        if (n->left != NULL) {
+            n->left->parent = p;
+        }
+        n->left = p;
+    }
+    p->parent = n;
+
+    ilist_internal_update(p);
+    ilist_internal_update(n);
+}
+
+/**
+ * internal use only: join two treaps where all items of a are before all items of b and return the new root.
+ */
+ilistitem_t* ilist_internal_join(ilistitem_t* a, ilistitem_t* b) {
+    if (a == NULL) {
+        return b;
+    }
+    if (b == NULL) {
+        return a;
+    }
+
+    if (a->priority > b->priority) {
+        a->right = ilist_internal_join(a->right, b);
+        a->right->parent = a;
+        ilist_internal_update(a);
+        return a;
+    }
+    b->left = ilist_internal_join(a, b->left);
+    b->left->parent = b;
+    ilist_internal_update(b);
+    return b;
+}
+
+/**
+ * internal use only: build a treap from count chained items starting at first in O(count) and return its root.
+ */
+ilistitem_t* ilist_internal_build(ilist_t* il, listitem_t* first, LIST_LENGTH_TYPE count) {
+    // the right spine of the treap built so far is kept via the parent pointers, starting from the last node
+    ilistitem_t* last = NULL;
+    listitem_t* elem = first;
+    for (LIST_LENGTH_TYPE c = 0; c < count; c++, elem = elem->next) {
+        ilistitem_t* n = (ilistitem_t*)elem;
+        n->left = NULL;
+        n->right = NULL;
+        n->size = 1;
+        n->priority = ilist_internal_priority(il);
+        n->state = ILIST_INDEXED;
+
+        // nodes popped from the spine are complete, their size can be calculated
+        ilistitem_t* popped = NULL;
+        while (last != NULL && last->priority < n->priority) {
+            ilist_internal_update(last);
+            popped = last;
+            last = last->parent;
+        }
+
+        n->left = popped;
+        if (popped != NULL) {
+            popped->parent = n;
+        }
+        n->parent = last;
+        if (last != NULL) {
+            last->right = n;
+        }
+        last = n;
+    }
+
+    ilistitem_t* root = NULL;
+    while (last != NULL) {
+        ilist_internal_update(last);
+        root = last;
+        last = last->parent;
+    }
+    return root;
+}
+
+/**
+ * internal use only: move all pending items into the treap.
+ */
+void ilist_internal_flush(ilist_t* il) {
+    if (il->head_pending > 0) {
+        ilistitem_t* head = ilist_internal_build(il, il->list.first, il->head_pending);
+        il->root = ilist_internal_join(head, il->root);
+        il->root->parent = NULL;
+        il->head_pending = 0;
+    }
+
+    if (il->tail_pending > 0) {
+        listitem_t* first = il->list.last;
+        for (LIST_LENGTH_TYPE c = 1; c < il->tail_pending; c++) {
+            first = first->prev;
+        }
+        ilistitem_t* tail = ilist_internal_build(il, first, il->tail_pending);
+        il->root = ilist_internal_join(il->root, tail);
+        il->root->parent = NULL;
+        il->tail_pending = 0;
+    }
+}
+
+/**
+ * internal use only: return the indexed item at the given index, the index must be valid and nothing pending.
+ */
+ilistitem_t* ilist_internal_find(ilist_t* il, LIST_LENGTH_TYPE index) {
+    ilistitem_t* n = il->root;
+    while (true) {
+        LIST_LENGTH_TYPE left = ilist_internal_size(n->left);
+        if (index < left) {
+            n = n->left;
+        } else if (index == left) {
+            return n;
+        } else {
+            index -= left + 1;
+            n = n->right;
+        }
+    }
+}
+
+/**
+ * internal use only: remove an item from the treap.
+ */
+void ilist_internal_remove(ilist_t* il, ilistitem_t* n) {
+    // rotate the item down until it has at most one child
+    while (n->left != NULL && n->right != NULL) {
+        ilist_internal_rotate_up(il, n->left->priority > n->right->priority ? n->left : n->right);
+    }
+
+    ilistitem_t* parent = n->parent;
+    ilist_internal_replace(il, parent, n, n->left != NULL ? n->left : n->right);
+    for (ilistitem_t* a = parent; a != NULL; a = a->parent) {
+        a->size--;
+    }
+
+    n->parent = NULL;
+    n->left = NULL;
+    n->right = NULL;
+    n->size = 0;
+}
+
+void ilist_init(ilist_t* il) {
+    assert(il != NULL);
+
+    memset(il, 0, sizeof(ilist_t));
+    list_init(&il->list);
+    il->random = 0x9E3779B97F4A7C15ull;
+}
+
+LIST_LENGTH_TYPE ilist_length(ilist_t* il) {
+    assert(il != NULL);
+
+    return il->list.length;
+}
+
+void ilist_push(ilist_t* il, ilistitem_t* i) {
+    assert(il != NULL);
+    assert(i != NULL);
+
+    list_push(&il->list, &i->item);
+    i->state = ILIST_PENDING_TAIL;
+    il->tail_pending++;
+}
+
+ilistitem_t* ilist_pop(ilist_t* il) {
+    assert(il != NULL);
+
+    ilistitem_t* i = (ilistitem_t*)il->list.last;
+    if (i != NULL) {
+        ilistitem_unlink(i);
+    }
+    return i;
+}
+
+void ilist_unshift(ilist_t* il, ilistitem_t* i) {
+    assert(il != NULL);
+    assert(i != NULL);
+
+    list_unshift(&il->list, &i->item);
+    i->state = ILIST_PENDING_HEAD;
+    il->head_pending++;
+}
+
+ilistitem_t* ilist_shift(ilist_t* il) {
+    assert(il != NULL);
+
+    ilistitem_t* i = (ilistitem_t*)il->list.first;
+    if (i != NULL) {
+        ilistitem_unlink(i);
+    }
+    return i;
+}
+
+ilistitem_t* ilist_get(ilist_t* il, LIST_LENGTH_TYPE index) {
+    assert(il != NULL);
+
+    if (index >= ilist_length(il)) {
+        return NULL;
+    }
+
+    // the ends are reachable without the index
+    if (index == 0) {
+        return (ilistitem_t*)il->list.first;
+    }
+    if (index == ilist_length(il) - 1) {
+        return (ilistitem_t*)il->list.last;
+    }
+
+    ilist_internal_flush(il);
+    return ilist_internal_find(il, index);
+}
+
+void ilist_insert_at(ilist_t* il, LIST_LENGTH_TYPE index, ilistitem_t* i) {
+    assert(il != NULL);
+    assert(i != NULL);
+    assert(index <= ilist_length(il));
+    assert(!ilistitem_in_list(i));
+
+    if (index == ilist_length(il)) {
+        ilist_push(il, i);
+        return;
+    }
+    if (index == 0) {
+        ilist_unshift(il, i);
+        return;
+    }
+
+    ilist_internal_flush(il);
+    ilistitem_t* at = ilist_internal_find(il, index);
+
+    // chain the item in front of the item currently at the index
+    i->item.list_ptr = &il->list;
+    i->item.prev = at->item.prev;
+    i->item.next = &at->item;
+    at->item.prev->next = &i->item;
+    at->item.prev = &i->item;
+    il->list.length++;
+
+    // the predecessor in the treap is the rightmost item of the left subtree or the item itself
+    i->left = NULL;
+    i->right = NULL;
+    i->size = 1;
+    i->priority = ilist_internal_priority(il);
+    i->state = ILIST_INDEXED;
+    if (at->left == NULL) {
+        at->left = i;
+        i->parent = at;
+    } else {
+        ilistitem_t* p = at->left;
+        while (p->right != NULL) {
+            p = p->right;
+        }
+        p->right = i;
+        i->parent = p;
+    }
+
+    for (ilistitem_t* a = i->parent; a != NULL; a = a->parent) {
+        a->size++;
+    }
+    while (i->parent != NULL && i->parent->priority < i->priority) {
+        ilist_internal_rotate_up(il, i);
+    }
+}
+
+ilistitem_t* ilist_remove_index(ilist_t* il, LIST_LENGTH_TYPE index) {
+    assert(il != NULL);
+
+    ilistitem_t* i = ilist_get(il, index);
+    if (i == NULL) {
+        return NULL;
+    }
+
+    ilistitem_unlink(i);
+    return i;
+}
+
+LIST_LENGTH_TYPE ilist_index_of(ilist_t* il, ilistitem_t* i) {
+    assert(il != NULL);
+    assert(i != NULL);
+    assert(i->item.list_ptr == &il->list);
+
+    ilist_internal_flush(il);
+
+    LIST_LENGTH_TYPE index = ilist_internal_size(i->left);
+    for (ilistitem_t* n = i; n->parent != NULL; n = n->parent) {
+        if (n->parent->right == n) {
+            index += ilist_internal_size(n->parent->left) + 1;
+        }
+    }
+    return index;
+}
+
+void ilistitem_init(ilistitem_t* i) {
+    assert(i != NULL);
+
+    memset(i, 0, sizeof(ilistitem_t));
+    listitem_init(&i->item);
+}
+
+void ilistitem_unlink(ilistitem_t* i) {
+    assert(i != NULL);
+    assert(ilistitem_in_list(i));
+
+    ilist_t* il = (ilist_t*)i->item.list_ptr;
+    switch (i->state) {
+    case ILIST_PENDING_HEAD:
+        il->head_pending--;
+        break;
+    case ILIST_PENDING_TAIL:
+        il->tail_pending--;
+        break;
+    case ILIST_INDEXED:
+        ilist_internal_remove(il, i);
+        break;
+    }
+
+    listitem_unlink(&i->item);
+    i->state = ILIST_INDEXED;
+}
+
+bool ilistitem_in_list(ilistitem_t* i) {
+    assert(i != NULL);
+
+    return listitem_in_list(&i->item);
+}
+
+#endif
+#endif
@@ -71,6 +71,33 @@ You should have received a copy of the GNU Affero General Public License along w
  */
 #define LIST_LENGTH_TYPE unsigned int
 
+/**
+ * Set to 0 before including list.h to let list_splice and list_concat move items in O(1) without updating their
+ * list_ptr. Call list_restamp on the destination before the moved items are used with a function which relies on
+ * list_ptr, like listitem_unlink, list_contains, list_split_at or list_move_range.
+ */
+#ifndef LIST_SPLICE_RESTAMP
+#define LIST_SPLICE_RESTAMP 1
+#endif
+
+/**
+ * Set to 1 before including list.h to drop list_ptr from listitem_t, which shrinks items from 24 to 16 bytes. Items
+ * must be initialized with listitem_init, unlinked items are linked to themselves. Without list_ptr items do not know
+ * their list: use list_unlink instead of listitem_unlink, list_contains walks the list and list_restamp does not exist.
+ * LIST_COMPACT changes the layout of listitem_t, it has to be set the same way in every translation unit of a program,
+ * best on the compiler command line (-DLIST_COMPACT=1).
+ */
+#ifndef LIST_COMPACT
+#define LIST_COMPACT 0
+#endif
+
+/**
+ * The number of items LIST_ITER_PREFETCH and the prefetching foreach functions prefetch ahead of the current item.
+ */
+#ifndef LIST_PREFETCH_DISTANCE
+#define LIST_PREFETCH_DISTANCE 4
+#endif
+
 // Remove an item from the end of the list and return a pointer to the struct holding the item.
 #define LIST_POP_s(type, list, property_name) \
     ((list)->last != NULL ? LISTITEM_AS_s(type, list_pop(list), property_name) : NULL)
@@ -135,7 +162,9 @@ You should have received a copy of the GNU Affero General Public License along w
 #define LISTITEM_OFFSET_s(type, property_name) offsetof(type, property_name)
 
 typedef struct listitem_s {
+#if !LIST_COMPACT
     void* list_ptr;
+#endif
     struct listitem_s* prev;
     struct listitem_s* next;
 } listitem_t;
@@ -146,6 +175,57 @@ typedef struct {
     LIST_LENGTH_TYPE length;
 } list_t;
 
+typedef struct {
+    char* memory;        // caller managed memory for capacity objects
+    size_t object_size;  // the size of the struct holding the item
+    size_t offset;       // the LISTITEM_OFFSET of the item in the struct
+    size_t capacity;     // the number of objects which fit into memory
+    size_t used;         // the number of objects handed out, they occupy the start of memory
+} list_pool_t;
+
+/**
+ * internal use only: prefetch an item and the start of the struct holding it. Defined in the header so the prefetching
+ * iteration macros do not pay a function call per item.
+ */
+static inline void list_internal_prefetch(listitem_t* i, size_t offset) {
+#if defined(__GNUC__)
+    __builtin_prefetch(i);
+    __builtin_prefetch((char*)i - offset);
+#else
+    (void)i;
+    (void)offset;
+#endif
+}
+
+/**
+ * internal use only: prefetch i and the LIST_PREFETCH_DISTANCE items following it and return the last of them, the
+ * item LIST_PREFETCH_DISTANCE items ahead of i. Null if the list ends before.
+ */
+static inline listitem_t* list_internal_prefetch_ahead(listitem_t* i, size_t offset) {
+    for (size_t d = 1; i != NULL && d <= LIST_PREFETCH_DISTANCE; d++) {
+        list_internal_prefetch(i, offset);
+        i = i->next;
+    }
+    if (i != NULL) {
+        list_internal_prefetch(i, offset);
+    }
+    return i;
+}
+
+/**
+ * internal use only: advance the cursor running ahead by one item and prefetch the new item.
+ */
+static inline listitem_t* list_internal_prefetch_next(listitem_t* ahead, size_t offset) {
+    if (ahead == NULL) {
+        return NULL;
+    }
+    ahead = ahead->next;
+    if (ahead != NULL) {
+        list_internal_prefetch(ahead, offset);
+    }
+    return ahead;
+}
+
 /**
  * Iterate over the items of a list.
  */
@@ -157,6 +237,21 @@ typedef struct {
 #define LIST_ITER_REVERSE(iter_name, begin) \
     for (listitem_t* iter_name = begin; iter_name != NULL; iter_name = iter_name->prev)
 
+/**
+ * Iterate over the items of a list like LIST_ITER while prefetching the item LIST_PREFETCH_DISTANCE items ahead. A
+ * second cursor runs ahead of iter_name, so the items must not be unlinked inside the loop.
+ */
+#define LIST_ITER_PREFETCH(iter_name, begin) LIST_ITER_PREFETCH_DATA(iter_name, begin, 0)
+
+/**
+ * Iterate over the items of a list like LIST_ITER_PREFETCH and also prefetch the start of the struct holding the item
+ * ahead, offset is the LISTITEM_OFFSET of the item in the struct.
+ */
+#define LIST_ITER_PREFETCH_DATA(iter_name, begin, offset)                                                     \
+    for (listitem_t *iter_name = begin, *iter_name##_ahead = list_internal_prefetch_ahead(begin, offset);      \
+         iter_name != NULL;                                                                                   \
+         iter_name = iter_name->next, iter_name##_ahead = list_internal_prefetch_next(iter_name##_ahead, offset))
+
 /**
  * Initialize a list.
  */
@@ -189,13 +284,107 @@ void list_unshift(list_t* l, listitem_t* i);
  */
 void list_insert_sorted(list_t* l, listitem_t* i, bool (*cmp)(listitem_t* i, listitem_t* j));
 
+/**
+ * Sort the list in place using a stable bottom-up merge sort. Runtime O(n log n), no memory is allocated.
+ * cmp takes two items and returns true if i must be placed before j, like for list_insert_sorted. Items for which cmp
+ * returns false in both directions keep their relative order.
+ */
+void list_sort(list_t* l, bool (*cmp)(listitem_t* i, listitem_t* j));
+
+/**
+ * Merge all items of the sorted list b into the sorted list a, b is empty afterwards. Items of a are placed before
+ * equal items of b. Runtime O(length(a) + length(b)).
+ */
+void list_merge_sorted(list_t* a, list_t* b, bool (*cmp)(listitem_t* i, listitem_t* j));
+
+/**
+ * Sort the list like list_sort using nthreads threads. The item pointers are copied into an array, every thread sorts
+ * a chunk of the array, the chunks are merged pairwise and the items are relinked in one pass. Every merge is split
+ * into one part per chunk it covers, so all threads work in every merge round including the last one. Allocates two
+ * pointers per item, falls back to list_sort for short lists or if the allocation fails.
+ */
+void list_sort_parallel(list_t* l, bool (*cmp)(listitem_t* i, listitem_t* j), size_t nthreads);
+
+/**
+ * Move all items of src in front of the item pos of dst or to the end of dst if pos is NULL, src is empty afterwards.
+ * Runtime O(1) if LIST_SPLICE_RESTAMP is 0, otherwise O(length(src)) to update the list_ptr of the moved items.
+ */
+void list_splice(list_t* dst, listitem_t* pos, list_t* src);
+
+/**
+ * Move all items of src to the end of dst, src is empty afterwards. Same runtime as list_splice.
+ */
+void list_concat(list_t* dst, list_t* src);
+
+/**
+ * Move the item i and all items after it from l to the end of out. Runtime O(number of moved items), the items are
+ * counted and restamped in one pass.
+ */
+void list_split_at(list_t* l, listitem_t* i, list_t* out);
+
+/**
+ * Move the items first to last (inclusive, first must not be after last) of src in front of the item pos of dst or to
+ * the end of dst if pos is NULL. pos must not be in the moved range, dst may be src. Runtime O(number of moved items)
+ * if dst is not src, O(1) otherwise.
+ */
+void list_move_range(list_t* src, listitem_t* first, listitem_t* last, list_t* dst, listitem_t* pos);
+
+#if !LIST_COMPACT
+/**
+ * Set the list_ptr of all items to l, needed after list_splice or list_concat if LIST_SPLICE_RESTAMP is 0. Runtime
+ * O(n).
+ */
+void list_restamp(list_t* l);
+#endif
+
+/**
+ * Initialize a pool which hands out the capacity slots of the caller managed memory of capacity * object_size bytes
+ * in address order. offset is the LISTITEM_OFFSET of the item in the struct.
+ */
+void list_pool_init(list_pool_t* pool, void* memory, size_t capacity, size_t object_size, size_t offset);
+
+/**
+ * Return the next free slot of the pool or NULL if the pool is full. Slots are not reused until list_pool_reset.
+ */
+void* list_pool_alloc(list_pool_t* pool);
+
+/**
+ * Mark all slots of the pool as free, the objects in it must not be used anymore.
+ */
+void list_pool_reset(list_pool_t* pool);
+
+/**
+ * Check if the object lives in a slot of the pool which was handed out.
+ */
+bool list_pool_contains(list_pool_t* pool, void* object);
+
+/**
+ * Copy the structs holding the items of the list into consecutive free slots of pool in list order and relink the
+ * copies, so iterating the list walks memory sequentially. relocate is called with the old and the new address of
+ * every struct (it may be NULL) to let owners update their references, the old struct is still intact but its links
+ * are stale. The old memory is not touched afterwards: with two pools the old one can be reset once all of its live
+ * objects were moved. Return false without moving anything if the pool has not enough free slots. Runtime O(n).
+ */
+bool list_defragment(list_t* l, list_pool_t* pool, void (*relocate)(void* old, void* new, void* userdata),
+                     void* userdata);
+
+/**
+ * Insert the item i in front of the item pos of the list or at the end of the list if pos is NULL.
+ */
+void list_insert_before(list_t* l, listitem_t* pos, listitem_t* i);
+
+/**
+ * Remove the item from the list l which must contain it.
+ */
+void list_unlink(list_t* l, listitem_t* i);
+
 /**
  * Remove an item from the beginning of the list and return it.
  */
 listitem_t* list_shift(list_t* l);
 
 /**
- * Get the nth item in the list.
+ * Get the nth item in the list. Runtime O(n).
  */
 listitem_t* list_get(list_t* l, LIST_LENGTH_TYPE i);
 
@@ -205,7 +394,7 @@ listitem_t* list_get(list_t* l, LIST_LENGTH_TYPE i);
 listitem_t* list_remove_index(list_t* l, LIST_LENGTH_TYPE index);
 
 /**
- * Check if the list contains a given item. Runtime O(n).
+ * Check if the list contains a given item. Runtime O(1), O(n) if LIST_COMPACT is set.
  */
 bool list_contains(list_t* l, listitem_t* i);
 
@@ -219,6 +408,12 @@ void list_foreach(list_t* l, void (*iter)(listitem_t*, void*), void* userdata);
  */
 void list_foreach_revere(list_t* l, void (*iter)(listitem_t*, void*), void* userdata);
 
+/**
+ * Iterate over the items in the list like list_foreach while prefetching LIST_PREFETCH_DISTANCE items and the start of
+ * the structs holding them ahead, ptr_offset is the LISTITEM_OFFSET of the item in the struct. Runtime O(n).
+ */
+void list_foreach_prefetch(list_t* l, void (*iter)(listitem_t*, void*), void* userdata, size_t ptr_offset);
+
 /**
  * Write all item pointers contained in the list to a caller managed array. Runtime O(n).
  */
@@ -234,10 +429,12 @@ void list_data_to_array(list_t* l, void** array, size_t ptr_offset);
  */
 void listitem_init(listitem_t* i);
 
+#if !LIST_COMPACT
 /**
  * Remove the item from the list it currently is contained in.
  */
 void listitem_unlink(listitem_t* i);
+#endif
 
 /**
  * Check if the item is currently in a list.
@@ -248,6 +445,42 @@ bool listitem_in_list(listitem_t* i);
 
 #define LISTITEM_STATE_OFFSET_INITIALIZED 0b1
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+/**
+ * Lists shorter than this many items per thread are sorted by list_sort in list_sort_parallel.
+ */
+#ifndef LIST_SORT_PARALLEL_MIN_CHUNK
+#define LIST_SORT_PARALLEL_MIN_CHUNK 4096
+#endif
+
+/**
+ * internal use only: mark the item as contained in l.
+ */
+void list_internal_stamp(listitem_t* i, list_t* l) {
+#if LIST_COMPACT
+    (void)i;
+    (void)l;
+#else
+    i->list_ptr = l;
+#endif
+}
+
+/**
+ * internal use only: mark the item as not contained in any list.
+ */
+void list_internal_clear(listitem_t* i) {
+#if LIST_COMPACT
+    i->prev = i;
+    i->next = i;
+#else
+    i->prev = NULL;
+    i->next = NULL;
+    i->list_ptr = NULL;
+#endif
+}
 
 void list_init(list_t* l) {
     assert(l != NULL);
@@ -267,16 +500,16 @@ void list_push(list_t* l, listitem_t* i) {
     assert(l != NULL);
     assert(!listitem_in_list(i));
 
-    i->list_ptr = l;
+    list_internal_stamp(i, l);
+    i->prev = l->last;
+    i->next = NULL;
 
     if (l->length == 0) {
         l->first = i;
-        l->last = i;
     } else {
-        i->prev = l->last;
         l->last->next = i;
-        l->last = i;
     }
+    l->last = i;
     l->length++;
 }
 
@@ -301,9 +534,7 @@ listitem_t* list_pop(list_t* l) {
     }
 
     // cleanup item
-    i->prev = NULL;
-    i->next = NULL;
-    i->list_ptr = NULL;
+    list_internal_clear(i);
 
     return i;
 }
@@ -312,16 +543,16 @@ void list_unshift(list_t* l, listitem_t* i) {
     assert(l != NULL);
     assert(!listitem_in_list(i));
 
-    i->list_ptr = l;
+    list_internal_stamp(i, l);
+    i->prev = NULL;
+    i->next = l->first;
 
     if (l->length == 0) {
-        l->first = i;
         l->last = i;
     } else {
         l->first->prev = i;
-        i->next = l->first;
-        l->first = i;
     }
+    l->first = i;
     l->length++;
 }
 
@@ -332,18 +563,7 @@ void list_insert_sorted(list_t* l, listitem_t* i, bool (*cmp)(listitem_t* i, lis
     listitem_t* curr = l->first;
     while (curr != NULL) {
         if (cmp(i, curr)) {
-            // if has prev update prev, else it must be the nre first
-            if (curr->prev != NULL) {
-                curr->prev->next = i;
-                i->prev = curr->prev;
-            } else {
-                l->first = i;
-            }
-
-            curr->prev = i;
-            i->next = curr;
-            i->list_ptr = l;
-            l->length++;
+            list_insert_before(l, curr, i);
             return;
         }
         curr = curr->next;
@@ -353,6 +573,481 @@ void list_insert_sorted(list_t* l, listitem_t* i, bool (*cmp)(listitem_t* i, lis
     list_push(l, i);
 }
 
+/**
+ * internal use only: merge two NULL terminated runs chained via next and return the first item of the merged run.
+ * Items of a are placed before equal items of b.
+ */
+listitem_t* list_internal_merge(listitem_t* a, listitem_t* b, bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    listitem_t head;
+    listitem_t* tail = &head;
+    while (a != NULL && b != NULL) {
+        if (cmp(b, a)) {
+            tail->next = b;
+            b = b->next;
+        } else {
+            tail->next = a;
+            a = a->next;
+        }
+        tail = tail->next;
+    }
+    tail->next = a != NULL ? a : b;
+    return head.next;
+}
+
+/**
+ * internal use only: chain the items starting at first into l and restore the prev pointers and l->last.
+ */
+void list_internal_relink(list_t* l, listitem_t* first) {
+    l->first = first;
+    listitem_t* prev = NULL;
+    for (listitem_t* elem = first; elem != NULL; elem = elem->next) {
+        elem->prev = prev;
+        prev = elem;
+    }
+    l->last = prev;
+}
+
+void list_sort(list_t* l, bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    assert(l != NULL);
+    assert(cmp != NULL);
+
+    if (l->length < 2) {
+        return;
+    }
+
+    // runs[k] is NULL or a sorted run of 2^k items, runs with a higher k hold earlier items. Every item is merged
+    // into the small runs first, which keeps the working set in cache, and carried upwards like a binary counter.
+    listitem_t* runs[sizeof(LIST_LENGTH_TYPE) * 8 + 1] = {0};
+    listitem_t* elem = l->first;
+    while (elem != NULL) {
+        listitem_t* carry = elem;
+        elem = elem->next;
+        carry->next = NULL;
+
+        size_t k = 0;
+        for (; runs[k] != NULL; k++) {
+            carry = list_internal_merge(runs[k], carry, cmp);
+            runs[k] = NULL;
+        }
+        runs[k] = carry;
+    }
+
+    listitem_t* sorted = NULL;
+    for (size_t k = 0; k < sizeof(runs) / sizeof(runs[0]); k++) {
+        if (runs[k] != NULL) {
+            sorted = list_internal_merge(runs[k], sorted, cmp);
+        }
+    }
+    list_internal_relink(l, sorted);
+}
+
+void list_merge_sorted(list_t* a, list_t* b, bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    assert(a != NULL);
+    assert(b != NULL);
+    assert(cmp != NULL);
+
+    if (b->length == 0) {
+        return;
+    }
+
+#if !LIST_COMPACT
+    LIST_ITER(elem, b->first) { elem->list_ptr = a; }
+#endif
+    list_internal_relink(a, list_internal_merge(a->first, b->first, cmp));
+    a->length += b->length;
+    list_init(b);
+}
+
+typedef struct list_internal_sort_job_s {
+    listitem_t** src;
+    listitem_t** dst;
+    size_t begin;
+    size_t middle;  // merge jobs: the end of the first and begin of the second run
+    size_t end;
+    bool (*cmp)(listitem_t* i, listitem_t* j);
+    size_t from;  // merge jobs: the part from to to of dst this job writes, between begin and end
+    size_t to;
+} list_internal_sort_job_t;
+
+/**
+ * internal use only: run fn with every job, count - 1 jobs on new threads and one on the calling thread. Jobs whose
+ * thread can not be created run on the calling thread.
+ */
+void list_internal_parallel(int (*fn)(void*), list_internal_sort_job_t* jobs, size_t count) {
+    thrd_t threads[count];
+    bool started[count];
+
+    for (size_t t = 1; t < count; t++) {
+        started[t] = thrd_create(&threads[t], fn, &jobs[t]) == thrd_success;
+    }
+
+    fn(&jobs[0]);
+
+    for (size_t t = 1; t < count; t++) {
+        if (started[t]) {
+            thrd_join(threads[t], NULL);
+        } else {
+            fn(&jobs[t]);
+        }
+    }
+}
+
+/**
+ * internal use only: stable merge of the sorted arrays a and b into dst.
+ */
+void list_internal_merge_array(listitem_t** a, size_t a_length, listitem_t** b, size_t b_length, listitem_t** dst,
+                               bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    size_t i = 0, j = 0, k = 0;
+    while (i < a_length && j < b_length) {
+        dst[k++] = cmp(b[j], a[i]) ? b[j++] : a[i++];
+    }
+    memcpy(&dst[k], &a[i], (a_length - i) * sizeof(listitem_t*));
+    memcpy(&dst[k + a_length - i], &b[j], (b_length - j) * sizeof(listitem_t*));
+}
+
+/**
+ * internal use only: the number of items of a among the first k items of the stable merge of the sorted arrays a and
+ * b, found by binary search on the diagonal k (merge path). The remaining k - result items come from b.
+ */
+size_t list_internal_corank(listitem_t** a, size_t a_length, listitem_t** b, size_t b_length, size_t k,
+                            bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    size_t low = k > b_length ? k - b_length : 0;
+    size_t high = k < a_length ? k : a_length;
+    while (low < high) {
+        size_t i = low + (high - low) / 2;
+        // a[i] is merged before b[k - i - 1] unless b[k - i - 1] is strictly smaller, so more items of a are needed
+        if (!cmp(b[k - i - 1], a[i])) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+/**
+ * internal use only: stable merge sort of the array items using scratch (same length) as temporary memory.
+ */
+void list_internal_sort_array(listitem_t** items, listitem_t** scratch, size_t n,
+                              bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    if (n <= 16) {
+        for (size_t i = 1; i < n; i++) {
+            listitem_t* item = items[i];
+            size_t j = i;
+            for (; j > 0 && cmp(item, items[j - 1]); j--) {
+                items[j] = items[j - 1];
+            }
+            items[j] = item;
+        }
+        return;
+    }
+
+    size_t half = n / 2;
+    list_internal_sort_array(items, scratch, half, cmp);
+    list_internal_sort_array(&items[half], &scratch[half], n - half, cmp);
+    list_internal_merge_array(items, half, &items[half], n - half, scratch, cmp);
+    memcpy(items, scratch, n * sizeof(listitem_t*));
+}
+
+/**
+ * internal use only: sort the chunk begin to end of src in place.
+ */
+int list_internal_sort_chunk(void* arg) {
+    list_internal_sort_job_t* job = arg;
+    list_internal_sort_array(&job->src[job->begin], &job->dst[job->begin], job->end - job->begin, job->cmp);
+    return 0;
+}
+
+/**
+ * internal use only: merge the sorted runs begin to middle and middle to end of src and write the part from to to of
+ * the result into dst.
+ */
+int list_internal_merge_chunk(void* arg) {
+    list_internal_sort_job_t* job = arg;
+    listitem_t** a = &job->src[job->begin];
+    listitem_t** b = &job->src[job->middle];
+    size_t a_length = job->middle - job->begin;
+    size_t b_length = job->end - job->middle;
+
+    size_t from = job->from - job->begin;
+    size_t to = job->to - job->begin;
+    size_t a_from = list_internal_corank(a, a_length, b, b_length, from, job->cmp);
+    size_t a_to = list_internal_corank(a, a_length, b, b_length, to, job->cmp);
+    list_internal_merge_array(&a[a_from], a_to - a_from, &b[from - a_from], (to - a_to) - (from - a_from),
+                              &job->dst[job->from], job->cmp);
+    return 0;
+}
+
+void list_sort_parallel(list_t* l, bool (*cmp)(listitem_t* i, listitem_t* j), size_t nthreads) {
+    assert(l != NULL);
+    assert(cmp != NULL);
+
+    size_t n = l->length;
+    if (nthreads > n / LIST_SORT_PARALLEL_MIN_CHUNK) {
+        nthreads = n / LIST_SORT_PARALLEL_MIN_CHUNK;
+    }
+    if (nthreads <= 1) {
+        list_sort(l, cmp);
+        return;
+    }
+
+    listitem_t** items = malloc(n * sizeof(listitem_t*));
+    listitem_t** scratch = malloc(n * sizeof(listitem_t*));
+    if (items == NULL || scratch == NULL) {
+        free(items);
+        free(scratch);
+        list_sort(l, cmp);
+        return;
+    }
+    list_to_array(l, items);
+
+    list_internal_sort_job_t jobs[nthreads];
+    size_t bounds[nthreads + 1];
+    for (size_t t = 0; t <= nthreads; t++) {
+        bounds[t] = n * t / nthreads;
+    }
+    for (size_t t = 0; t < nthreads; t++) {
+        jobs[t] = (list_internal_sort_job_t){items, scratch, bounds[t], bounds[t + 1], bounds[t + 1], cmp,
+                                             bounds[t], bounds[t + 1]};
+    }
+    list_internal_parallel(list_internal_sort_chunk, jobs, nthreads);
+
+    // merge neighbouring runs pairwise, the runs move between items and scratch every round. A merge of runs covering
+    // several chunks is split at the chunk bounds of its output, so every round runs nthreads jobs of similar size
+    listitem_t** src = items;
+    listitem_t** dst = scratch;
+    for (size_t width = 1; width < nthreads; width *= 2) {
+        for (size_t t = 0; t < nthreads; t += 2 * width) {
+            size_t middle = t + width < nthreads ? t + width : nthreads;
+            size_t end = t + 2 * width < nthreads ? t + 2 * width : nthreads;
+            for (size_t part = t; part < end; part++) {
+                jobs[part] = (list_internal_sort_job_t){src, dst, bounds[t], bounds[middle], bounds[end], cmp,
+                                                        bounds[part], bounds[part + 1]};
+            }
+        }
+        list_internal_parallel(list_internal_merge_chunk, jobs, nthreads);
+
+        listitem_t** tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    l->first = src[0];
+    l->last = src[n - 1];
+    src[0]->prev = NULL;
+    src[n - 1]->next = NULL;
+    for (size_t i = 1; i < n; i++) {
+        src[i - 1]->next = src[i];
+        src[i]->prev = src[i - 1];
+    }
+
+    free(items);
+    free(scratch);
+}
+
+/**
+ * internal use only: detach the chain first to last from l, count is the number of items in the chain.
+ */
+void list_internal_cut(list_t* l, listitem_t* first, listitem_t* last, LIST_LENGTH_TYPE count) {
+    if (first->prev != NULL) {
+        first->prev->next = last->next;
+    } else {
+        l->first = last->next;
+    }
+    if (last->next != NULL) {
+        last->next->prev = first->prev;
+    } else {
+        l->last = first->prev;
+    }
+    l->length -= count;
+
+    first->prev = NULL;
+    last->next = NULL;
+}
+
+/**
+ * internal use only: link the detached chain first to last in front of pos or to the end of l if pos is NULL.
+ */
+void list_internal_paste(list_t* l, listitem_t* pos, listitem_t* first, listitem_t* last, LIST_LENGTH_TYPE count) {
+    listitem_t* prev = pos != NULL ? pos->prev : l->last;
+    first->prev = prev;
+    last->next = pos;
+    if (prev != NULL) {
+        prev->next = first;
+    } else {
+        l->first = first;
+    }
+    if (pos != NULL) {
+        pos->prev = last;
+    } else {
+        l->last = last;
+    }
+    l->length += count;
+}
+
+void list_splice(list_t* dst, listitem_t* pos, list_t* src) {
+    assert(dst != NULL);
+    assert(src != NULL);
+    assert(dst != src);
+#if !LIST_COMPACT
+    assert(pos == NULL || pos->list_ptr == dst);
+#endif
+
+    if (src->length == 0) {
+        return;
+    }
+
+#if LIST_SPLICE_RESTAMP && !LIST_COMPACT
+    LIST_ITER(elem, src->first) { elem->list_ptr = dst; }
+#endif
+    list_internal_paste(dst, pos, src->first, src->last, src->length);
+    list_init(src);
+}
+
+void list_concat(list_t* dst, list_t* src) { list_splice(dst, NULL, src); }
+
+void list_split_at(list_t* l, listitem_t* i, list_t* out) {
+    assert(l != NULL);
+    assert(out != NULL);
+    assert(l != out);
+    assert(i != NULL);
+#if !LIST_COMPACT
+    assert(i->list_ptr == l);
+#endif
+
+    list_move_range(l, i, l->last, out, NULL);
+}
+
+void list_move_range(list_t* src, listitem_t* first, listitem_t* last, list_t* dst, listitem_t* pos) {
+    assert(src != NULL);
+    assert(dst != NULL);
+    assert(first != NULL);
+    assert(last != NULL);
+#if !LIST_COMPACT
+    assert(first->list_ptr == src);
+    assert(last->list_ptr == src);
+    assert(pos == NULL || pos->list_ptr == dst);
+#endif
+
+    LIST_LENGTH_TYPE count = 0;
+    if (src != dst) {
+        for (listitem_t* elem = first;; elem = elem->next) {
+            assert(elem != NULL);
+            list_internal_stamp(elem, dst);
+            count++;
+            if (elem == last) {
+                break;
+            }
+        }
+    }
+
+    list_internal_cut(src, first, last, count);
+    list_internal_paste(dst, pos, first, last, count);
+}
+
+#if !LIST_COMPACT
+void list_restamp(list_t* l) {
+    assert(l != NULL);
+
+    LIST_ITER(elem, l->first) { elem->list_ptr = l; }
+}
+#endif
+
+void list_pool_init(list_pool_t* pool, void* memory, size_t capacity, size_t object_size, size_t offset) {
+    assert(pool != NULL);
+    assert(memory != NULL || capacity == 0);
+    assert(offset + sizeof(listitem_t) <= object_size);
+
+    pool->memory = memory;
+    pool->object_size = object_size;
+    pool->offset = offset;
+    pool->capacity = capacity;
+    pool->used = 0;
+}
+
+void* list_pool_alloc(list_pool_t* pool) {
+    assert(pool != NULL);
+
+    if (pool->used == pool->capacity) {
+        return NULL;
+    }
+    return pool->memory + pool->used++ * pool->object_size;
+}
+
+void list_pool_reset(list_pool_t* pool) {
+    assert(pool != NULL);
+
+    pool->used = 0;
+}
+
+bool list_pool_contains(list_pool_t* pool, void* object) {
+    assert(pool != NULL);
+
+    char* o = object;
+    return o >= pool->memory && o < pool->memory + pool->used * pool->object_size &&
+           (size_t)(o - pool->memory) % pool->object_size == 0;
+}
+
+bool list_defragment(list_t* l, list_pool_t* pool, void (*relocate)(void* old, void* new, void* userdata),
+                     void* userdata) {
+    assert(l != NULL);
+    assert(pool != NULL);
+
+    if (pool->capacity - pool->used < l->length) {
+        return false;
+    }
+
+    listitem_t* prev = NULL;
+    listitem_t* elem = l->first;
+    while (elem != NULL) {
+        char* old = (char*)elem - pool->offset;
+        char* new = list_pool_alloc(pool);
+        memcpy(new, old, pool->object_size);
+
+        listitem_t* copy = (listitem_t*)(new + pool->offset);
+        copy->prev = prev;
+        if (prev != NULL) {
+            prev->next = copy;
+        } else {
+            l->first = copy;
+        }
+        prev = copy;
+        // the old item is never written, its next pointer is still valid
+        elem = elem->next;
+
+        if (relocate != NULL) {
+            relocate(old, new, userdata);
+        }
+    }
+    if (prev != NULL) {
+        prev->next = NULL;
+    }
+    l->last = prev;
+    return true;
+}
+
+void list_insert_before(list_t* l, listitem_t* pos, listitem_t* i) {
+    assert(l != NULL);
+    assert(i != NULL);
+    assert(!listitem_in_list(i));
+
+    if (pos == NULL) {
+        list_push(l, i);
+        return;
+    }
+
+    list_internal_stamp(i, l);
+    i->prev = pos->prev;
+    i->next = pos;
+    if (pos->prev != NULL) {
+        pos->prev->next = i;
+    } else {
+        l->first = i;
+    }
+    pos->prev = i;
+    l->length++;
+}
+
 listitem_t* list_shift(list_t* l) {
     assert(l != NULL);
 
@@ -374,9 +1069,7 @@ listitem_t* list_shift(list_t* l) {
     }
 
     // cleanup item
-    i->prev = NULL;
-    i->next = NULL;
-    i->list_ptr = NULL;
+    list_internal_clear(i);
 
     return i;
 }
@@ -388,6 +1081,18 @@ listitem_t* list_get(list_t* l, LIST_LENGTH_TYPE index) {
         return NULL;
     }
 
+    // walk from the closer end, see ilist.h for O(log n) positional access
+    if (index >= l->length / 2) {
+        LIST_LENGTH_TYPE idx = l->length - 1;
+        LIST_ITER_REVERSE(elem, l->last) {
+            if (idx == index) {
+                return elem;
+            }
+            idx--;
+        }
+        return NULL;
+    }
+
     LIST_LENGTH_TYPE idx = 0;
     LIST_ITER(elem, l->first) {
         if (idx == index) {
@@ -406,11 +1111,22 @@ listitem_t* list_remove_index(list_t* l, LIST_LENGTH_TYPE index) {
         return NULL;
     }
 
-    listitem_unlink(i);
+    list_unlink(l, i);
     return i;
 }
 
-bool list_contains(list_t* l, listitem_t* i) { return i->list_ptr == l; }
+bool list_contains(list_t* l, listitem_t* i) {
+#if LIST_COMPACT
+    LIST_ITER(elem, l->first) {
+        if (elem == i) {
+            return true;
+        }
+    }
+    return false;
+#else
+    return i->list_ptr == l;
+#endif
+}
 
 void list_foreach(list_t* l, void (*iter)(listitem_t*, void*), void* userdata) {
     assert(l != NULL);
@@ -418,6 +1134,12 @@ void list_foreach(list_t* l, void (*iter)(listitem_t*, void*), void* userdata) {
     LIST_ITER(elem, l->first) { iter(elem, userdata); }
 }
 
+void list_foreach_prefetch(list_t* l, void (*iter)(listitem_t*, void*), void* userdata, size_t offset) {
+    assert(l != NULL);
+
+    LIST_ITER_PREFETCH_DATA(elem, l->first, offset) { iter(elem, userdata); }
+}
+
 void list_foreach_reverse(list_t* l, void (*iter)(listitem_t*, void*), void* userdata) {
     assert(l != NULL);
 
@@ -438,18 +1160,30 @@ void list_data_to_array(list_t* l, void** array, size_t offset) {
     LIST_ITER(elem, l->first) { array[i++] = (void*)(((char*)elem) - ((char*)offset)); }
 }
 
-void listitem_init(listitem_t* i) {
-    i->list_ptr = NULL;
-    i->prev = NULL;
-    i->next = NULL;
-}
+void listitem_init(listitem_t* i) { list_internal_clear(i); }
 
-bool listitem_in_list(listitem_t* i) { return i->list_ptr != NULL; }
+bool listitem_in_list(listitem_t* i) {
+#if LIST_COMPACT
+    return i->next != i;
+#else
+    return i->list_ptr != NULL;
+#endif
+}
 
+#if !LIST_COMPACT
 void listitem_unlink(listitem_t* i) {
     assert(listitem_in_list(i));
 
-    list_t* l = i->list_ptr;
+    list_unlink(i->list_ptr, i);
+}
+#endif
+
+void list_unlink(list_t* l, listitem_t* i) {
+    assert(l != NULL);
+    assert(listitem_in_list(i));
+#if !LIST_COMPACT
+    assert(i->list_ptr == l);
+#endif
 
     if (l->first == i) {
         l->first = i->next;
@@ -469,9 +1203,7 @@ void listitem_unlink(listitem_t* i) {
 
     l->length--;
 
-    i->prev = NULL;
-    i->next = NULL;
-    i->list_ptr = NULL;
+    list_internal_clear(i);
 }
 
 #endif
@@ -0,0 +1,243 @@
+/*
+
+# Singly Linked List
+
+A zero allocation singly linked list with 8 byte items for stacks and FIFO queues. Items can be added to both ends but
+only removed from the front, there is no unlink from the middle and the items do not know their list. Use list.h if
+these are needed.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting IMPL_SLIST before. Do this only once e.g. in main.c
+
+```
+#define IMPL_SLIST
+#include "slist.h"
+```
+
+After that include slist.h like a normal header everywhere the declarations are needed
+```
+#include "slist.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    int id;
+    SLISTITEM_PROP();
+} job;
+
+slist_t queue;
+slist_init(&queue);
+
+job a = {0}, b = {0};
+slist_append(&queue, SLISTITEM_OF(job, &a));
+slist_append(&queue, SLISTITEM_OF(job, &b));
+
+job* next = SLIST_POP(job, &queue);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_SLIST_H
+#define DS_SLIST_H
+#include <stddef.h>
+
+/**
+ * Type to the lengths.
+ */
+#define SLIST_LENGTH_TYPE unsigned int
+
+// Remove an item from the beginning of the list and return a pointer to the struct holding the item.
+#define SLIST_POP_s(type, list, property_name) \
+    ((list)->first != NULL ? SLISTITEM_AS_s(type, slist_pop(list), property_name) : NULL)
+
+// Remove an item from the beginning of the list and return a pointer to the struct holding the item using the default
+// item property name.
+#define SLIST_POP(type, list) SLIST_POP_s(type, list, default_slist_item_name)
+
+/**
+ * Inject a slistitem_t property with a given name into a struct.
+ */
+#define SLISTITEM_PROP_s(item_name) slistitem_t item_name
+
+/**
+ * Inject a slistitem_t struct with the default property name into a struct.
+ */
+#define SLISTITEM_PROP() SLISTITEM_PROP_s(default_slist_item_name)
+
+/**
+ * Convert a type + pointer + property name to a list item.
+ */
+#define SLISTITEM_OF_s(type, data_ptr, item_name) (slistitem_t*)(((char*)data_ptr) + offsetof(type, item_name))
+
+/**
+ * Convert a type + pointer to a list item using the default property name.
+ */
+#define SLISTITEM_OF(type, data_ptr) SLISTITEM_OF_s(type, data_ptr, default_slist_item_name)
+
+/**
+ * Convert a slistitem_t to a pointer to its holding struct using the offset of the given property's name.
+ */
+#define SLISTITEM_AS_s(type, ptr, property_name) ((type*)(((char*)ptr) - ((char*)offsetof(type, property_name))))
+
+/**
+ * Convert a slistitem_t to a pointer to its holding struct using the offset of the default property name.
+ */
+#define SLISTITEM_AS(type, ptr) SLISTITEM_AS_s(type, ptr, default_slist_item_name)
+
+/**
+ * Iterate over the items of a list.
+ */
+#define SLIST_ITER(iter_name, begin) for (slistitem_t* iter_name = begin; iter_name != NULL; iter_name = iter_name->next)
+
+typedef struct slistitem_s {
+    struct slistitem_s* next;
+} slistitem_t;
+
+typedef struct {
+    slistitem_t* first;
+    slistitem_t* last;
+    SLIST_LENGTH_TYPE length;
+} slist_t;
+
+/**
+ * Initialize a list.
+ */
+void slist_init(slist_t* l);
+
+/**
+ * Returns the number of items in the list.
+ */
+SLIST_LENGTH_TYPE slist_length(slist_t* l);
+
+/**
+ * Add an item to the beginning of the list.
+ */
+void slist_push(slist_t* l, slistitem_t* i);
+
+/**
+ * Remove an item from the beginning of the list and return it or NULL if the list is empty.
+ */
+slistitem_t* slist_pop(slist_t* l);
+
+/**
+ * Add an item to the end of the list.
+ */
+void slist_append(slist_t* l, slistitem_t* i);
+
+/**
+ * Move all items of src to the end of dst, src is empty afterwards. Runtime O(1).
+ */
+void slist_splice_all(slist_t* dst, slist_t* src);
+
+/**
+ * Initialize a list item.
+ */
+void slistitem_init(slistitem_t* i);
+
+#if defined(IMPL_SLIST) || defined(_CLANGD)
+#include <assert.h>
+
+void slist_init(slist_t* l) {
+    assert(l != NULL);
+
+    l->first = NULL;
+    l->last = NULL;
+    l->length = 0;
+}
+
+SLIST_LENGTH_TYPE slist_length(slist_t* l) {
+    assert(l != NULL);
+
+    return l->length;
+}
+
+void slist_push(slist_t* l, slistitem_t* i) {
+    assert(l != NULL);
+    assert(i != NULL);
+
+    i->next = l->first;
+    if (l->first == NULL) {
+        l->last = i;
+    }
+    l->first = i;
+    l->length++;
+}
+
+slistitem_t* slist_pop(slist_t* l) {
+    assert(l != NULL);
+
+    slistitem_t* i = l->first;
+    if (i == NULL) {
+        return NULL;
+    }
+
+    l->first = i->next;
+    if (l->first == NULL) {
+        l->last = NULL;
+    }
+    l->length--;
+
+    i->next = NULL;
+    return i;
+}
+
+void slist_append(slist_t* l, slistitem_t* i) {
+    assert(l != NULL);
+    assert(i != NULL);
+
+    i->next = NULL;
+    if (l->last != NULL) {
+        l->last->next = i;
+    } else {
+        l->first = i;
+    }
+    l->last = i;
+    l->length++;
+}
+
+void slist_splice_all(slist_t* dst, slist_t* src) {
+    assert(dst != NULL);
+    assert(src != NULL);
+    assert(dst != src);
+
+    if (src->first == NULL) {
+        return;
+    }
+
+    if (dst->last != NULL) {
+        dst->last->next = src->first;
+    } else {
+        dst->first = src->first;
+    }
+    dst->last = src->last;
+    dst->length += src->length;
+    slist_init(src);
+}
+
+void slistitem_init(slistitem_t* i) {
+    assert(i != NULL);
+
+    i->next = NULL;
+}
+
+#endif
+#endif
@@ -0,0 +1,355 @@
+/*
+
+# Sorted List
+
+A list_t which is kept sorted by a comparison function and has a sparse skip index over its items for O(log n)
+expected sorted inserts, removals and seeks instead of the linear scan of list_insert_sorted.
+
+The items are plain listitem_t chained in sorted order in `sl.list`, so LIST_ITER and LIST_ITER_REVERSE work unchanged
+and the item structs need no extra properties. About every fourth item additionally gets a tower of index nodes
+(allocated by the sorted list), every index level links about a quarter of the nodes of the level below it.
+
+Items must only be added and removed with the sortlist functions, the index is not updated by the list.h functions.
+
+## Usage
+
+### Include
+
+To generate the implementations include the header with setting IMPL_SORTLIST before. Do this only once e.g. in
+main.c. The implementation of list.h is needed as well.
+
+```
+#define IMPL_LIST
+#include "list.h"
+#define IMPL_SORTLIST
+#include "sortlist.h"
+```
+
+After that include sortlist.h like a normal header everywhere the declarations are needed
+```
+#include "sortlist.h"
+```
+
+### Basic Usage
+
+```
+typedef struct {
+    int priority;
+    LISTITEM_PROP();
+} job;
+
+bool job_before(listitem_t* i, listitem_t* j) {
+    return LISTITEM_AS(job, i)->priority < LISTITEM_AS(job, j)->priority;
+}
+
+sortlist_t queue;
+sortlist_init(&queue, job_before);
+
+job a = {.priority = 3}, b = {.priority = 1};
+sortlist_insert(&queue, LISTITEM_OF(job, &a));
+sortlist_insert(&queue, LISTITEM_OF(job, &b));
+
+LIST_ITER(elem, queue.list.first) {
+    ...
+}
+
+job* next = LISTITEM_AS(job, sortlist_shift(&queue));
+sortlist_destroy(&queue);
+```
+
+## License APGL
+
+Copyright (C) 2024 Mario Aichinger <aichingm@gmail.com>
+
+This program is free software: you can redistribute it and/or modify it under the terms of the GNU Affero General Public
+License as published by the Free Software Foundation, version 3.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Affero General Public License for more
+details.
+
+You should have received a copy of the GNU Affero General Public License along with this program. If not, see
+<https://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef DS_SORTLIST_H
+#define DS_SORTLIST_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include "list.h"
+
+/**
+ * The maximum number of index levels, enough for 4^SORTLIST_MAX_LEVEL items.
+ */
+#define SORTLIST_MAX_LEVEL 16
+
+typedef struct sortlist_index_s {
+    listitem_t* item;
+    struct sortlist_index_s* next;  // the next index node on the same level
+    struct sortlist_index_s* down;  // the index node of the same item one level below, NULL on the lowest level
+} sortlist_index_t;
+
+typedef struct {
+    list_t list;
+    sortlist_index_t* heads[SORTLIST_MAX_LEVEL];  // the first index node of every level, level 0 is the lowest
+    size_t levels;  // the number of levels which contain at least one index node
+    size_t index_nodes;
+    uint64_t random;
+    bool (*cmp)(listitem_t* i, listitem_t* j);
+} sortlist_t;
+
+/**
+ * Initialize a sorted list. cmp takes two items and returns true if i must be placed before j, like for
+ * list_insert_sorted.
+ */
+void sortlist_init(sortlist_t* sl, bool (*cmp)(listitem_t* i, listitem_t* j));
+
+/**
+ * Free the index of the sorted list, the items are not touched but must not be used with the sorted list anymore.
+ */
+void sortlist_destroy(sortlist_t* sl);
+
+/**
+ * Returns the number of items in the list.
+ */
+LIST_LENGTH_TYPE sortlist_length(sortlist_t* sl);
+
+/**
+ * Insert an item in front of the first item it must be placed before, equal items keep their insertion order. Runtime
+ * O(log n) expected.
+ */
+void sortlist_insert(sortlist_t* sl, listitem_t* i);
+
+/**
+ * Remove an item from the sorted list. Runtime O(log n) expected plus the number of items equal to i.
+ */
+void sortlist_remove(sortlist_t* sl, listitem_t* i);
+
+/**
+ * Remove the first item of the list and return it or NULL if the list is empty. Runtime O(1) expected.
+ */
+listitem_t* sortlist_shift(sortlist_t* sl);
+
+/**
+ * Remove the last item of the list and return it or NULL if the list is empty. Runtime O(log n) expected.
+ */
+listitem_t* sortlist_pop(sortlist_t* sl);
+
+/**
+ * Return the first item of the list which key must not be placed before or NULL if there is none. key does not need to
+ * be in the list, it is only passed to cmp. Runtime O(log n) expected.
+ */
+listitem_t* sortlist_seek(sortlist_t* sl, listitem_t* key);
+
+/**
+ * Return the number of allocated index nodes.
+ */
+size_t sortlist_stats_index_nodes(sortlist_t* sl);
+
+#if defined(IMPL_SORTLIST) || defined(_CLANGD)
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * internal use only: return the next random number.
+ */
+uint64_t sortlist_internal_random(sortlist_t* sl) {
+    // xorshift
+    sl->random ^= sl->random << 13;
+    sl->random ^= sl->random >> 7;
+    sl->random ^= sl->random << 17;
+    return sl->random;
+}
+
+/**
+ * internal use only: return the first index node at level or the one after n.
+ */
+sortlist_index_t* sortlist_internal_next(sortlist_t* sl, sortlist_index_t* n, size_t level) {
+    return n != NULL ? n->next : sl->heads[level];
+}
+
+/**
+ * internal use only: descend the index and store the last node of every level for which before returns true in pred
+ * (NULL if there is none). Return the first item of the list from which the search has to continue.
+ */
+listitem_t* sortlist_internal_search(sortlist_t* sl, listitem_t* i, bool strict, sortlist_index_t** pred) {
+    sortlist_index_t* n = NULL;
+    for (size_t level = sl->levels; level-- > 0;) {
+        sortlist_index_t* next = sortlist_internal_next(sl, n, level);
+        // strict: advance past items before i, otherwise past items i is not placed before
+        while (next != NULL && (strict ? sl->cmp(next->item, i) : !sl->cmp(i, next->item))) {
+            n = next;
+            next = n->next;
+        }
+        pred[level] = n;
+        if (n != NULL && level > 0) {
+            n = n->down;
+        }
+    }
+    return n != NULL ? n->item : sl->list.first;
+}
+
+/**
+ * internal use only: unlink the index nodes of i from every level.
+ */
+void sortlist_internal_unindex(sortlist_t* sl, listitem_t* i, sortlist_index_t** pred) {
+    for (size_t level = 0; level < sl->levels; level++) {
+        // skip the equal items in front of i on this level
+        sortlist_index_t* n = pred[level];
+        sortlist_index_t* next = sortlist_internal_next(sl, n, level);
+        while (next != NULL && next->item != i && !sl->cmp(i, next->item)) {
+            n = next;
+            next = n->next;
+        }
+        if (next == NULL || next->item != i) {
+            // towers have no gaps, i is not on any higher level either
+            break;
+        }
+
+        if (n != NULL) {
+            n->next = next->next;
+        } else {
+            sl->heads[level] = next->next;
+        }
+        free(next);
+        sl->index_nodes--;
+    }
+
+    while (sl->levels > 0 && sl->heads[sl->levels - 1] == NULL) {
+        sl->levels--;
+    }
+}
+
+void sortlist_init(sortlist_t* sl, bool (*cmp)(listitem_t* i, listitem_t* j)) {
+    assert(sl != NULL);
+    assert(cmp != NULL);
+
+    memset(sl, 0, sizeof(sortlist_t));
+    list_init(&sl->list);
+    sl->random = 0x9E3779B97F4A7C15ull;
+    sl->cmp = cmp;
+}
+
+void sortlist_destroy(sortlist_t* sl) {
+    assert(sl != NULL);
+
+    for (size_t level = 0; level < sl->levels; level++) {
+        sortlist_index_t* n = sl->heads[level];
+        while (n != NULL) {
+            sortlist_index_t* next = n->next;
+            free(n);
+            n = next;
+        }
+    }
+    memset(sl, 0, sizeof(sortlist_t));
+}
+
+LIST_LENGTH_TYPE sortlist_length(sortlist_t* sl) {
+    assert(sl != NULL);
+
+    return sl->list.length;
+}
+
+void sortlist_insert(sortlist_t* sl, listitem_t* i) {
+    assert(sl != NULL);
+    assert(i != NULL);
+    assert(!listitem_in_list(i));
+
+    sortlist_index_t* pred[SORTLIST_MAX_LEVEL];
+    listitem_t* curr = sortlist_internal_search(sl, i, false, pred);
+    while (curr != NULL && !sl->cmp(i, curr)) {
+        curr = curr->next;
+    }
+
+    list_insert_before(&sl->list, curr, i);
+
+    // every level is reached with a probability of 1/4 from the level below
+    uint64_t random = sortlist_internal_random(sl);
+    size_t height = 0;
+    while (height < SORTLIST_MAX_LEVEL && (random & 3) == 0) {
+        height++;
+        random >>= 2;
+    }
+
+    sortlist_index_t* down = NULL;
+    for (size_t level = 0; level < height; level++) {
+        sortlist_index_t* n = malloc(sizeof(sortlist_index_t));
+        assert(n != NULL);
+        n->item = i;
+        n->down = down;
+
+        sortlist_index_t* p = level < sl->levels ? pred[level] : NULL;
+        if (p != NULL) {
+            n->next = p->next;
+            p->next = n;
+        } else {
+            n->next = sl->heads[level];
+            sl->heads[level] = n;
+        }
+        down = n;
+        sl->index_nodes++;
+    }
+    if (height > sl->levels) {
+        sl->levels = height;
+    }
+}
+
+void sortlist_remove(sortlist_t* sl, listitem_t* i) {
+    assert(sl != NULL);
+    assert(i != NULL);
+    assert(listitem_in_list(i));
+
+    sortlist_index_t* pred[SORTLIST_MAX_LEVEL];
+    sortlist_internal_search(sl, i, true, pred);
+    sortlist_internal_unindex(sl, i, pred);
+    list_unlink(&sl->list, i);
+}
+
+listitem_t* sortlist_shift(sortlist_t* sl) {
+    assert(sl != NULL);
+
+    listitem_t* i = sl->list.first;
+    if (i == NULL) {
+        return NULL;
+    }
+
+    // the index nodes of the first item are the heads of their levels
+    sortlist_index_t* pred[SORTLIST_MAX_LEVEL] = {0};
+    sortlist_internal_unindex(sl, i, pred);
+    list_unlink(&sl->list, i);
+    return i;
+}
+
+listitem_t* sortlist_pop(sortlist_t* sl) {
+    assert(sl != NULL);
+
+    listitem_t* i = sl->list.last;
+    if (i != NULL) {
+        sortlist_remove(sl, i);
+    }
+    return i;
+}
+
+listitem_t* sortlist_seek(sortlist_t* sl, listitem_t* key) {
+    assert(sl != NULL);
+    assert(key != NULL);
+
+    sortlist_index_t* pred[SORTLIST_MAX_LEVEL];
+    listitem_t* curr = sortlist_internal_search(sl, key, true, pred);
+    while (curr != NULL && sl->cmp(curr, key)) {
+        curr = curr->next;
+    }
+    return curr;
+}
+
+size_t sortlist_stats_index_nodes(sortlist_t* sl) {
+    assert(sl != NULL);
+
+    return sl->index_nodes;
+}
+
+#endif
+#endif
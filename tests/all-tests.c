@@ -8,13 +8,88 @@
 #define IMPL_HMAP
 #include "src/hmap.h"
 
+#define IMPL_HMAP_RCU
+#include "src/hmap_rcu.h"
+
+#define IMPL_HMAP_COMBINE
+#include "src/hmap_combine.h"
+
+#define IMPL_HMAP_SHARD
+#include "src/hmap_shard.h"
+
+#define IMPL_HMAP_CUCKOO
+#include "src/hmap_cuckoo.h"
+
+#define IMPL_HMAP_HOPSCOTCH
+#include "src/hmap_hopscotch.h"
+
+#define IMPL_HMAP_FROZEN
+#include "src/hmap_frozen.h"
+
+#define IMPL_HMAP_MAPPED
+#include "src/hmap_mapped.h"
+
+#define IMPL_HSET
+#include "src/hset.h"
+
+#define IMPL_CFILTER
+#include "src/cfilter.h"
+
+#define IMPL_HMAP_DISK
+#include "src/hmap_disk.h"
+
+#define IMPL_HMAP_WAL
+#include "src/hmap_wal.h"
+
+#define IMPL_ILIST
+#include "src/ilist.h"
+
+#define IMPL_SORTLIST
+#include "src/sortlist.h"
+
+#define IMPL_CLIST
+#include "src/clist.h"
+
+#define IMPL_SLIST
+#include "src/slist.h"
+
 // include tests
 #include "tests/list.h"
 #include "tests/hmap.h"
+#include "tests/hmap_rcu.h"
+#include "tests/hmap_combine.h"
+#include "tests/hmap_shard.h"
+#include "tests/hmap_cuckoo.h"
+#include "tests/hmap_hopscotch.h"
+#include "tests/hmap_frozen.h"
+#include "tests/hmap_mapped.h"
+#include "tests/hset.h"
+#include "tests/cfilter.h"
+#include "tests/hmap_disk.h"
+#include "tests/hmap_wal.h"
+#include "tests/ilist.h"
+#include "tests/sortlist.h"
+#include "tests/clist.h"
+#include "tests/slist.h"
 
 TEST_LIST = {
     LIST_TESTS,
     HMAP_TESTS,
+    HMAP_RCU_TESTS,
+    HMAP_COMBINE_TESTS,
+    HMAP_SHARD_TESTS,
+    HMAP_CUCKOO_TESTS,
+    HMAP_HOPSCOTCH_TESTS,
+    HMAP_FROZEN_TESTS,
+    HMAP_MAPPED_TESTS,
+    HSET_TESTS,
+    CFILTER_TESTS,
+    HMAP_DISK_TESTS,
+    HMAP_WAL_TESTS,
+    ILIST_TESTS,
+    SORTLIST_TESTS,
+    CLIST_TESTS,
+    SLIST_TESTS,
     {NULL, NULL}
 };
 
@@ -0,0 +1,152 @@
+#include "acutest.h"
+
+#include "src/cfilter.h"
+
+#define CFILTER_TESTS \
+    { "cfilter init", test_cfilter_init }, \
+    { "cfilter add has", test_cfilter_add_has }, \
+    { "cfilter false positives", test_cfilter_false_positives }, \
+    { "cfilter delete", test_cfilter_delete }, \
+    { "cfilter duplicates", test_cfilter_duplicates }, \
+    { "cfilter full", test_cfilter_full }
+
+void test_cfilter_init() {
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, 1000);
+
+    TEST_ASSERT(cfilter_length(&f) == 0);
+    TEST_ASSERT(cfilter_capacity(&f) * CFILTER_MAX_LOAD >= 1000);
+    TEST_ASSERT(cfilter_stats_false_positive_rate(&f) == 0);
+
+    size_t key = 1;
+    TEST_ASSERT(!cfilter_has(&f, &key));
+    TEST_ASSERT(!cfilter_delete(&f, &key));
+
+    cfilter_destroy(&f);
+}
+
+void test_cfilter_add_has() {
+    size_t n = 100000;
+
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, n);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(cfilter_add(&f, &i));
+    }
+    TEST_ASSERT(cfilter_length(&f) == n);
+
+    // no false negatives
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(cfilter_has(&f, &i));
+    }
+
+    cfilter_destroy(&f);
+}
+
+void test_cfilter_false_positives() {
+    size_t n = 100000;
+
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, n);
+    for (size_t i = 0; i < n; i++) {
+        cfilter_add(&f, &i);
+    }
+
+    size_t false_positives = 0;
+    for (size_t i = n; i < 11 * n; i++) {
+        false_positives += cfilter_has(&f, &i);
+    }
+
+    // observed and estimated rate are both around 1e-4
+    float rate = false_positives / (10.f * n);
+    float estimate = cfilter_stats_false_positive_rate(&f);
+    TEST_ASSERT(estimate > 0);
+    TEST_ASSERT(rate < 3 * estimate);
+    TEST_MSG("rate: %f, estimate: %f", rate, estimate);
+
+    cfilter_destroy(&f);
+}
+
+void test_cfilter_delete() {
+    size_t n = 10000;
+
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, n);
+    for (size_t i = 0; i < n; i++) {
+        cfilter_add(&f, &i);
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(cfilter_delete(&f, &i));
+    }
+    TEST_ASSERT(cfilter_length(&f) == n / 2);
+
+    size_t present = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 2 == 1) {
+            TEST_ASSERT(cfilter_has(&f, &i));
+        } else {
+            present += cfilter_has(&f, &i);
+        }
+    }
+    TEST_ASSERT(present < 10);
+
+    for (size_t i = 1; i < n; i += 2) {
+        TEST_ASSERT(cfilter_delete(&f, &i));
+    }
+    TEST_ASSERT(cfilter_length(&f) == 0);
+    for (size_t i = 0; i < cfilter_capacity(&f); i++) {
+        TEST_ASSERT(f.fingerprints[i] == 0);
+    }
+
+    cfilter_destroy(&f);
+}
+
+void test_cfilter_duplicates() {
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, 100);
+
+    size_t key = 42;
+    TEST_ASSERT(cfilter_add(&f, &key));
+    TEST_ASSERT(cfilter_add(&f, &key));
+    TEST_ASSERT(cfilter_length(&f) == 2);
+
+    TEST_ASSERT(cfilter_delete(&f, &key));
+    TEST_ASSERT(cfilter_has(&f, &key));
+    TEST_ASSERT(cfilter_delete(&f, &key));
+    TEST_ASSERT(!cfilter_has(&f, &key));
+
+    cfilter_destroy(&f);
+}
+
+void test_cfilter_full() {
+    cfilter_t f;
+    cfilter_init(&f, hmap_hash_size_t, 1000);
+
+    size_t added = 0;
+    while (cfilter_add(&f, &added)) {
+        added++;
+    }
+
+    // the kick sequence fills close to all slots before it fails
+    TEST_ASSERT(added <= cfilter_capacity(&f));
+    TEST_ASSERT(cfilter_stats_load_factor(&f) > 0.9f);
+    TEST_MSG("load: %f", cfilter_stats_load_factor(&f));
+    for (size_t i = 0; i < added; i++) {
+        TEST_ASSERT(cfilter_has(&f, &i));
+    }
+
+    // deletes make room again
+    for (size_t i = 0; i < added; i += 10) {
+        TEST_ASSERT(cfilter_delete(&f, &i));
+    }
+    for (size_t i = 0; i < added; i += 10) {
+        TEST_ASSERT(cfilter_add(&f, &i));
+    }
+    for (size_t i = 0; i < added; i++) {
+        TEST_ASSERT(cfilter_has(&f, &i));
+    }
+
+    cfilter_destroy(&f);
+}
@@ -0,0 +1,172 @@
+#include "acutest.h"
+
+#include "src/clist.h"
+
+#define CLIST_TESTS \
+    { "clist empty", test_clist_empty }, \
+    { "clist push pop", test_clist_push_pop }, \
+    { "clist unshift shift", test_clist_unshift_shift }, \
+    { "clist insert", test_clist_insert }, \
+    { "clist unlink", test_clist_unlink }, \
+    { "clist iter reverse", test_clist_iter_reverse }, \
+    { "clist macros", test_clist_macros }
+
+typedef struct {
+    int x;
+    CLISTITEM_PROP();
+} clist_item_t;
+
+/**
+ * Check both directions of the ring against the expected x values.
+ */
+void clist_check(clist_t* l, int* expected, size_t length) {
+    TEST_ASSERT(clist_length(l) == length);
+    TEST_ASSERT(clist_is_empty(l) == (length == 0));
+
+    size_t index = 0;
+    CLIST_ITER(elem, l) {
+        TEST_ASSERT(index < length);
+        TEST_ASSERT(CLISTITEM_AS(clist_item_t, elem)->x == expected[index]);
+        TEST_ASSERT(elem->next->prev == elem);
+        TEST_ASSERT(clistitem_in_list(elem));
+        index++;
+    }
+    TEST_ASSERT(index == length);
+    TEST_ASSERT(l->head.next->prev == &l->head);
+    TEST_ASSERT(l->head.prev->next == &l->head);
+}
+
+void clist_items(clist_item_t* items, int n) {
+    for (int i = 0; i < n; i++) {
+        items[i].x = i;
+        clistitem_init(CLISTITEM_OF(clist_item_t, &items[i]));
+    }
+}
+
+void test_clist_empty() {
+    clist_t l;
+    clist_init(&l);
+
+    clist_check(&l, NULL, 0);
+    TEST_ASSERT(clist_first(&l) == NULL);
+    TEST_ASSERT(clist_last(&l) == NULL);
+    TEST_ASSERT(clist_pop(&l) == NULL);
+    TEST_ASSERT(clist_shift(&l) == NULL);
+    clist_check(&l, NULL, 0);
+}
+
+void test_clist_push_pop() {
+    clist_item_t items[3];
+    clist_items(items, 3);
+    clist_t l;
+    clist_init(&l);
+
+    for (int i = 0; i < 3; i++) {
+        clist_push(&l, CLISTITEM_OF(clist_item_t, &items[i]));
+    }
+    clist_check(&l, (int[]){0, 1, 2}, 3);
+    TEST_ASSERT(clist_first(&l) == CLISTITEM_OF(clist_item_t, &items[0]));
+    TEST_ASSERT(clist_last(&l) == CLISTITEM_OF(clist_item_t, &items[2]));
+
+    TEST_ASSERT(clist_pop(&l) == CLISTITEM_OF(clist_item_t, &items[2]));
+    TEST_ASSERT(!clistitem_in_list(CLISTITEM_OF(clist_item_t, &items[2])));
+    TEST_ASSERT(clist_pop(&l) == CLISTITEM_OF(clist_item_t, &items[1]));
+    TEST_ASSERT(clist_pop(&l) == CLISTITEM_OF(clist_item_t, &items[0]));
+    TEST_ASSERT(clist_pop(&l) == NULL);
+    clist_check(&l, NULL, 0);
+}
+
+void test_clist_unshift_shift() {
+    clist_item_t items[3];
+    clist_items(items, 3);
+    clist_t l;
+    clist_init(&l);
+
+    for (int i = 0; i < 3; i++) {
+        clist_unshift(&l, CLISTITEM_OF(clist_item_t, &items[i]));
+    }
+    clist_check(&l, (int[]){2, 1, 0}, 3);
+
+    TEST_ASSERT(clist_shift(&l) == CLISTITEM_OF(clist_item_t, &items[2]));
+    TEST_ASSERT(clist_shift(&l) == CLISTITEM_OF(clist_item_t, &items[1]));
+    TEST_ASSERT(clist_shift(&l) == CLISTITEM_OF(clist_item_t, &items[0]));
+    TEST_ASSERT(clist_shift(&l) == NULL);
+    clist_check(&l, NULL, 0);
+}
+
+void test_clist_insert() {
+    clist_item_t items[4];
+    clist_items(items, 4);
+    clist_t l;
+    clist_init(&l);
+
+    clist_push(&l, CLISTITEM_OF(clist_item_t, &items[0]));
+    clist_insert_after(CLISTITEM_OF(clist_item_t, &items[0]), CLISTITEM_OF(clist_item_t, &items[1]));
+    clist_insert_before(CLISTITEM_OF(clist_item_t, &items[0]), CLISTITEM_OF(clist_item_t, &items[2]));
+    clist_insert_before(CLISTITEM_OF(clist_item_t, &items[1]), CLISTITEM_OF(clist_item_t, &items[3]));
+    clist_check(&l, (int[]){2, 0, 3, 1}, 4);
+
+    // inserting relative to the head pushes and unshifts
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[2]));
+    clist_insert_before(&l.head, CLISTITEM_OF(clist_item_t, &items[2]));
+    clist_check(&l, (int[]){0, 3, 1, 2}, 4);
+}
+
+void test_clist_unlink() {
+    clist_item_t items[5];
+    clist_items(items, 5);
+    clist_t l;
+    clist_init(&l);
+
+    for (int i = 0; i < 5; i++) {
+        clist_push(&l, CLISTITEM_OF(clist_item_t, &items[i]));
+    }
+
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[2]));
+    clist_check(&l, (int[]){0, 1, 3, 4}, 4);
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[0]));
+    clist_check(&l, (int[]){1, 3, 4}, 3);
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[4]));
+    clist_check(&l, (int[]){1, 3}, 2);
+
+    // unlinking an unlinked item changes nothing
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[4]));
+    TEST_ASSERT(!clistitem_in_list(CLISTITEM_OF(clist_item_t, &items[4])));
+    clist_check(&l, (int[]){1, 3}, 2);
+
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[1]));
+    clistitem_unlink(CLISTITEM_OF(clist_item_t, &items[3]));
+    clist_check(&l, NULL, 0);
+}
+
+void test_clist_iter_reverse() {
+    clist_item_t items[4];
+    clist_items(items, 4);
+    clist_t l;
+    clist_init(&l);
+
+    for (int i = 0; i < 4; i++) {
+        clist_push(&l, CLISTITEM_OF(clist_item_t, &items[i]));
+    }
+
+    int x = 4;
+    CLIST_ITER_REVERSE(elem, &l) {
+        TEST_ASSERT(CLISTITEM_AS(clist_item_t, elem)->x == --x);
+    }
+    TEST_ASSERT(x == 0);
+}
+
+void test_clist_macros() {
+    clist_item_t items[2];
+    clist_items(items, 2);
+    clist_t l;
+    clist_init(&l);
+
+    TEST_ASSERT(CLIST_POP(clist_item_t, &l) == NULL);
+    TEST_ASSERT(CLIST_SHIFT(clist_item_t, &l) == NULL);
+
+    clist_push(&l, CLISTITEM_OF(clist_item_t, &items[0]));
+    clist_push(&l, CLISTITEM_OF(clist_item_t, &items[1]));
+    TEST_ASSERT(CLIST_POP(clist_item_t, &l) == &items[1]);
+    TEST_ASSERT(CLIST_SHIFT(clist_item_t, &l) == &items[0]);
+}
@@ -0,0 +1,26 @@
+#include "tests/acutest.h"
+
+// built with -DLIST_COMPACT=1, LIST_COMPACT changes the layout of listitem_t and has to be the same for every
+// translation unit, so the compact mode gets its own test binary
+
+#if !LIST_COMPACT
+#error "compact-tests.c has to be built with -DLIST_COMPACT=1"
+#endif
+
+// include implementations
+
+#define IMPL_LIST
+#include "src/list.h"
+
+#define IMPL_SORTLIST
+#include "src/sortlist.h"
+
+// include tests
+#include "tests/list_compact.h"
+#include "tests/sortlist.h"
+
+TEST_LIST = {
+    LIST_COMPACT_TESTS,
+    SORTLIST_TESTS,
+    {NULL, NULL}
+};
@@ -1,3 +1,5 @@
+#include <stdatomic.h>
+
 #include "acutest.h"
 
 #include "src/hmap.h"
@@ -20,12 +22,27 @@
     { "hmap delete full same hash collision", test_hmap_delete_full_same_hash_collision }, \
     { "hmap delete out of order hash collision", test_hmap_delete_out_of_order_hash_collision }, \
     { "hmap delete from collisions with different collisions inside", test_hmap_delete_from_collisions_with_different_collisions_inside }, \
+    { "hmap delete wrapped collisions", test_hmap_delete_wrapped_collisions }, \
     { "hmap managed capacity", test_hmap_managed_capacity }, \
     { "hmap managed min capacity", test_hmap_managed_min_capacity }, \
     { "hmap rehash", test_hmap_rehash }, \
     { "hmap rehash to", test_hmap_rehash_to }, \
     { "hmap foreach", test_hmap_foreach }, \
-    { "hmap iter", test_hmap_iter }
+    { "hmap iter", test_hmap_iter }, \
+    { "hmap allocator", test_hmap_allocator }, \
+    { "hmap set many", test_hmap_set_many }, \
+    { "hmap build parallel", test_hmap_build_parallel }, \
+    { "hmap build parallel overwrite", test_hmap_build_parallel_overwrite }, \
+    { "hmap build parallel bad hash", test_hmap_build_parallel_bad_hash }, \
+    { "hmap build parallel unmanaged", test_hmap_build_parallel_unmanaged }, \
+    { "hmap foreach parallel", test_hmap_foreach_parallel }, \
+    { "hmap reduce parallel", test_hmap_reduce_parallel }, \
+    { "hmap multi add get", test_hmap_multi_add_get }, \
+    { "hmap multi delete item", test_hmap_multi_delete_item }, \
+    { "hmap multi delete", test_hmap_multi_delete }, \
+    { "hmap filter", test_hmap_filter }, \
+    { "hmap filter deletes", test_hmap_filter_deletes }, \
+    { "hmap filter disable", test_hmap_filter_disable }
 
 #define ZERO(x) x={0}
 
@@ -57,6 +74,14 @@ bool hmap_equals_str(void* a, void* b) {
     return strcmp(a, b) == 0;
 }
 
+size_t hmap_hash_size_t(void* ptr) {
+    return *(size_t*)ptr;
+}
+
+bool hmap_equals_size_t(void* a, void* b) {
+    return *(size_t*)a == *(size_t*)b;
+}
+
 typedef struct {
     char* data;
     hmapitem_t item;
@@ -492,6 +517,29 @@ void test_hmap_delete_from_collisions_with_different_collisions_inside() {
     hmap_destroy(&m);
 }
 
+void test_hmap_delete_wrapped_collisions() {
+    implicit_hmapitem_t ZERO(a), ZERO(b), ZERO(c), ZERO(d);
+    hmap_t ZERO(m);
+    hmap_init_unmanaged(&m, hmap_hash_first_char_value, hmap_equals_str, 8);
+
+    // h_2 and h_3 wrap around the end, h_3 is placed behind a_1 although its home slot lies before the one of a_1
+    HMAP_SET(implicit_hmapitem_t, &m, "h_1", &a);
+    HMAP_SET(implicit_hmapitem_t, &m, "h_2", &b);
+    HMAP_SET(implicit_hmapitem_t, &m, "a_1", &c);
+    HMAP_SET(implicit_hmapitem_t, &m, "h_3", &d);
+    TEST_ASSERT(m.data[2] == &d.default_hmap_item_name);
+
+    hmap_delete(&m, "a_1");
+
+    TEST_ASSERT(m.data[7] == &a.default_hmap_item_name);
+    TEST_ASSERT(m.data[0] == &b.default_hmap_item_name);
+    TEST_ASSERT(m.data[1] == &d.default_hmap_item_name);
+    TEST_ASSERT(m.data[2] == NULL);
+    TEST_ASSERT(&d == HMAP_GET(implicit_hmapitem_t, &m, "h_3"));
+
+    hmap_destroy(&m);
+}
+
 struct named_thing {
     char name;
     HMAPITEM_PROP();
@@ -724,3 +772,503 @@ void test_hmap_iter() {
     hmap_destroy(&m);
 }
 
+struct hmap_numbered {
+    size_t number;
+    HMAPITEM_PROP();
+};
+
+/**
+ * Allocate n numbered items, the number of the ith item is first + i * step. Use the numbers as keys with
+ * hmap_hash_size_t and hmap_equals_size_t.
+ */
+struct hmap_numbered* hmap_numbered_range(size_t n, size_t first, size_t step) {
+    struct hmap_numbered* numbered = calloc(n, sizeof(struct hmap_numbered));
+    for (size_t i = 0; i < n; i++) {
+        numbered[i].number = first + i * step;
+    }
+    return numbered;
+}
+
+/**
+ * hmap_foreach callback adding up size_t keys in the size_t userdata points to.
+ */
+void hmap_sum_keys(void* key, hmapitem_t* i, void* userdata) {
+    ((void)i);
+    *(size_t*)userdata += *(size_t*)key;
+}
+
+struct hmap_numbered* hmap_numbered_items(size_t n, void*** keys, hmapitem_t*** items) {
+    struct hmap_numbered* numbered = hmap_numbered_range(n, 0, 1);
+    *keys = calloc(n, sizeof(void*));
+    *items = calloc(n, sizeof(hmapitem_t*));
+    for (size_t i = 0; i < n; i++) {
+        (*keys)[i] = &numbered[i].number;
+        (*items)[i] = HMAPITEM_OF(struct hmap_numbered, &numbered[i]);
+    }
+    return numbered;
+}
+
+struct hmap_allocations {
+    size_t allocated;
+    size_t released;
+};
+
+void* hmap_counting_alloc(size_t size, void* userdata) {
+    ((struct hmap_allocations*)userdata)->allocated += size;
+    return calloc(1, size);
+}
+
+void hmap_counting_release(void* ptr, size_t size, void* userdata) {
+    ((struct hmap_allocations*)userdata)->released += size;
+    free(ptr);
+}
+
+void test_hmap_allocator() {
+    size_t n = 100;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    struct hmap_allocations allocations = {0};
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_set(&m, keys[0], items[0]);
+
+    // the existing slot array is moved
+    hmap_allocator(&m, hmap_counting_alloc, hmap_counting_release, &allocations);
+    TEST_ASSERT(allocations.allocated == HMAP_INITIAL_CAPACITY * sizeof(hmapitem_t*));
+    TEST_ASSERT(allocations.released == 0);
+    TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, keys[0]) == &numbered[0]);
+
+    for (size_t i = 1; i < n; i++) {
+        hmap_set(&m, keys[i], items[i]);
+    }
+    TEST_ASSERT(allocations.released == allocations.allocated - hmap_capacity(&m) * sizeof(hmapitem_t*));
+
+    hmap_destroy(&m);
+    TEST_ASSERT(allocations.released == allocations.allocated);
+
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void test_hmap_set_many() {
+    size_t n = 1000;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+    numbered[n - 1].number = 0;
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+
+    hmap_set_many(&m, keys, items, n);
+
+    TEST_ASSERT(hmap_length(&m) == n - 1);
+    TEST_ASSERT(hmap_capacity(&m) == 2048);
+    TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &numbered[0].number) == &numbered[n - 1]);
+    for (size_t i = 1; i < n - 1; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &numbered[i]);
+    }
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void test_hmap_build_parallel() {
+    size_t n = 10000;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+
+    // some associations exist before the bulk build
+    for (size_t i = 0; i < 100; i++) {
+        hmap_set(&m, keys[i], items[i]);
+    }
+
+    TEST_ASSERT(hmap_build_parallel(&m, keys + 100, items + 100, n - 100, 4) == 0);
+
+    TEST_ASSERT(hmap_length(&m) == n);
+    TEST_ASSERT(hmap_stats_load_factor(&m) <= .6);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &numbered[i]);
+        TEST_ASSERT(hmapitem_in_map(items[i], &m));
+        TEST_ASSERT(items[i]->key == keys[i]);
+    }
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void test_hmap_build_parallel_overwrite() {
+    size_t n = 1000;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    // every key appears twice, the later item has to win like with sequential hmap_set calls
+    for (size_t i = n / 2; i < n; i++) {
+        numbered[i].number = i - n / 2;
+    }
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+
+    TEST_ASSERT(hmap_build_parallel(&m, keys, items, n, 3) == 0);
+
+    TEST_ASSERT(hmap_length(&m) == n / 2);
+    for (size_t i = 0; i < n / 2; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &numbered[i + n / 2]);
+        TEST_ASSERT(!hmapitem_in_map(items[i], &m));
+        TEST_ASSERT(items[i]->key == NULL);
+    }
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void test_hmap_build_parallel_bad_hash() {
+    size_t n = 200;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_bad_same, hmap_equals_size_t);
+
+    // all items share one home slot and overflow the region of their thread
+    TEST_ASSERT(hmap_build_parallel(&m, keys, items, n, 8) == 0);
+
+    TEST_ASSERT(hmap_length(&m) == n);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &numbered[i]);
+    }
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void test_hmap_build_parallel_unmanaged() {
+    size_t n = 64;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    hmap_t ZERO(m);
+    hmap_init_unmanaged(&m, hmap_hash_size_t, hmap_equals_size_t, 64);
+
+    TEST_ASSERT(hmap_build_parallel(&m, keys, items, n, 5) == 0);
+
+    TEST_ASSERT(hmap_length(&m) == n);
+    TEST_ASSERT(hmap_capacity(&m) == 64);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &numbered[i]);
+    }
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+void hmap_iter_atomic_sum(void* key, hmapitem_t* item, void* userdata) {
+    struct hmap_numbered* n = HMAPITEM_AS(struct hmap_numbered, item);
+    atomic_size_t* sum = userdata;
+
+    atomic_fetch_add(sum, *(size_t*)key == n->number ? n->number : 0);
+}
+
+void test_hmap_foreach_parallel() {
+    size_t n = 10000;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < n; i++) {
+        hmap_set(&m, keys[i], items[i]);
+    }
+
+    atomic_size_t sum = 0;
+    hmap_foreach_parallel(&m, hmap_iter_atomic_sum, &sum, 4);
+    TEST_ASSERT(sum == (n * (n - 1)) / 2);
+
+    hmap_destroy(&m);
+
+    // more threads than cache lines
+    hmap_init_unmanaged(&m, hmap_hash_size_t, hmap_equals_size_t, 32);
+    for (size_t i = 0; i < 32; i++) {
+        hmapitem_init(items[i]);
+        hmap_set(&m, keys[i], items[i]);
+    }
+
+    sum = 0;
+    hmap_foreach_parallel(&m, hmap_iter_atomic_sum, &sum, 16);
+    TEST_ASSERT(sum == (32 * (32 - 1)) / 2);
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+struct hmap_accumulator {
+    size_t count;
+    size_t sum;
+    char padding[HMAP_CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+};
+
+void hmap_iter_accumulate(void* key, hmapitem_t* item, void* accumulator) {
+    ((void)key);
+    struct hmap_accumulator* a = accumulator;
+
+    a->count++;
+    a->sum += HMAPITEM_AS(struct hmap_numbered, item)->number;
+}
+
+void test_hmap_reduce_parallel() {
+    size_t n = 10000;
+    void** keys;
+    hmapitem_t** items;
+    struct hmap_numbered* numbered = hmap_numbered_items(n, &keys, &items);
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < n; i++) {
+        hmap_set(&m, keys[i], items[i]);
+    }
+
+    struct hmap_accumulator accumulators[3];
+    memset(accumulators, 0, sizeof(accumulators));
+    hmap_reduce_parallel(&m, hmap_iter_accumulate, accumulators, sizeof(struct hmap_accumulator), 3);
+
+    size_t count = 0, sum = 0;
+    for (int t = 0; t < 3; t++) {
+        count += accumulators[t].count;
+        sum += accumulators[t].sum;
+    }
+
+    TEST_ASSERT(count == n);
+    TEST_ASSERT(sum == (n * (n - 1)) / 2);
+
+    hmap_destroy(&m);
+    free(numbered);
+    free(keys);
+    free(items);
+}
+
+struct hmap_tagged {
+    size_t key;
+    size_t tag;
+    HMAPMULTIITEM_PROP();
+};
+
+void test_hmap_multi_add_get() {
+    size_t n = 300;
+    struct hmap_tagged* tagged = calloc(n, sizeof(struct hmap_tagged));
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < n; i++) {
+        tagged[i].key = i % 10;
+        tagged[i].tag = i;
+        hmap_multi_add(&m, &tagged[i].key, HMAPMULTIITEM_OF(struct hmap_tagged, &tagged[i]));
+    }
+
+    // one slot per key, all duplicates behind it
+    TEST_ASSERT(hmap_length(&m) == 10);
+    for (size_t k = 0; k < 10; k++) {
+        TEST_ASSERT(hmap_multi_count(&m, &k) == n / 10);
+
+        size_t tags = 0;
+        HMAP_MULTI_ITER(i, &m, &k) {
+            struct hmap_tagged* t = HMAPMULTIITEM_AS(struct hmap_tagged, i);
+            TEST_ASSERT(t->key == k);
+            TEST_ASSERT(hmapitem_in_map(&i->item, &m));
+            tags += t->tag;
+        }
+        TEST_ASSERT(tags == (n / 10) * k + 10 * ((n / 10) * (n / 10 - 1)) / 2);
+    }
+
+    size_t missing = 10;
+    TEST_ASSERT(hmap_multi_get(&m, &missing) == NULL);
+    TEST_ASSERT(hmap_multi_count(&m, &missing) == 0);
+
+    hmap_destroy(&m);
+    free(tagged);
+}
+
+void test_hmap_multi_delete_item() {
+    struct hmap_tagged tagged[4] = {{.key = 1, .tag = 0}, {.key = 1, .tag = 1}, {.key = 1, .tag = 2}, {.key = 2}};
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < 4; i++) {
+        hmap_multi_add(&m, &tagged[i].key, HMAPMULTIITEM_OF(struct hmap_tagged, &tagged[i]));
+    }
+
+    // delete the item held in the slot, the next one takes its place
+    hmapmultiitem_t* head = hmap_multi_get(&m, &tagged[0].key);
+    TEST_ASSERT(hmap_multi_delete_item(&m, head));
+    TEST_ASSERT(!hmapitem_in_map(&head->item, &m));
+    TEST_ASSERT(!hmap_multi_delete_item(&m, head));
+    TEST_ASSERT(hmap_multi_count(&m, &tagged[0].key) == 2);
+
+    // delete an item linked behind the slot
+    hmapmultiitem_t* second = hmap_multi_get(&m, &tagged[0].key)->next;
+    TEST_ASSERT(hmap_multi_delete_item(&m, second));
+    TEST_ASSERT(hmap_multi_count(&m, &tagged[0].key) == 1);
+
+    // delete the last item of the key
+    TEST_ASSERT(hmap_multi_delete_item(&m, hmap_multi_get(&m, &tagged[0].key)));
+    TEST_ASSERT(hmap_multi_get(&m, &tagged[0].key) == NULL);
+    TEST_ASSERT(hmap_length(&m) == 1);
+
+    TEST_ASSERT(hmap_multi_get(&m, &tagged[3].key) == HMAPMULTIITEM_OF(struct hmap_tagged, &tagged[3]));
+
+    hmap_destroy(&m);
+}
+
+void test_hmap_multi_delete() {
+    struct hmap_tagged tagged[3] = {{.key = 1}, {.key = 1}, {.key = 1}};
+
+    hmap_t ZERO(m);
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < 3; i++) {
+        hmap_multi_add(&m, &tagged[i].key, HMAPMULTIITEM_OF(struct hmap_tagged, &tagged[i]));
+    }
+
+    size_t count = 0;
+    for (hmapmultiitem_t* i = hmap_multi_delete(&m, &tagged[0].key); i != NULL; i = i->next) {
+        TEST_ASSERT(!hmapitem_in_map(&i->item, &m));
+        count++;
+    }
+    TEST_ASSERT(count == 3);
+    TEST_ASSERT(hmap_length(&m) == 0);
+    TEST_ASSERT(hmap_multi_delete(&m, &tagged[0].key) == NULL);
+
+    hmap_destroy(&m);
+}
+
+size_t hmap_filter_equals_calls = 0;
+
+bool hmap_equals_size_t_counted(void* a, void* b) {
+    hmap_filter_equals_calls++;
+    return *(size_t*)a == *(size_t*)b;
+}
+
+struct hmap_filtered {
+    size_t key;
+    HMAPITEM_PROP();
+};
+
+void test_hmap_filter() {
+    size_t n = 5000;
+    struct hmap_filtered* entries = calloc(n, sizeof(struct hmap_filtered));
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t_counted);
+    hmap_filter(&m, true);
+
+    // the map grows several times while being filled, the filter follows
+    for (size_t i = 0; i < n; i++) {
+        entries[i].key = i * 2;
+        hmap_set(&m, &entries[i].key, HMAPITEM_OF(struct hmap_filtered, &entries[i]));
+    }
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_filtered, &m, &entries[i].key) == &entries[i]);
+    }
+
+    float rate = hmap_stats_filter_false_positive_rate(&m);
+    TEST_ASSERT(rate > 0);
+    TEST_ASSERT(rate < 0.05f);
+
+    // missing keys are rejected by the filter before any key is compared
+    hmap_filter_equals_calls = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 2 + 1;
+        TEST_ASSERT(hmap_get(&m, &key) == NULL);
+    }
+    TEST_ASSERT(hmap_filter_equals_calls < n / 10);
+
+    hmap_destroy(&m);
+    free(entries);
+}
+
+void test_hmap_filter_deletes() {
+    size_t n = 1000;
+    struct hmap_filtered* entries = calloc(n, sizeof(struct hmap_filtered));
+
+    hmap_t m;
+    hmap_init_unmanaged(&m, hmap_hash_size_t, hmap_equals_size_t, 4 * n);
+    hmap_filter(&m, true);
+
+    for (size_t i = 0; i < n; i++) {
+        entries[i].key = i;
+        hmap_set(&m, &entries[i].key, HMAPITEM_OF(struct hmap_filtered, &entries[i]));
+    }
+    float full = hmap_stats_filter_false_positive_rate(&m);
+
+    // deleted keys stay in the filter until a quarter of the capacity has been deleted
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_delete(&m, &entries[i].key) == HMAPITEM_OF(struct hmap_filtered, &entries[i]));
+        TEST_ASSERT(!hmap_has(&m, &entries[i].key));
+    }
+    TEST_ASSERT(hmap_stats_filter_false_positive_rate(&m) == full);
+
+    hmap_set(&m, &entries[0].key, HMAPITEM_OF(struct hmap_filtered, &entries[0]));
+    TEST_ASSERT(hmap_delete(&m, &entries[0].key) != NULL);
+    TEST_ASSERT(hmap_stats_filter_false_positive_rate(&m) == 0);
+
+    for (size_t i = 0; i < n; i += 3) {
+        hmap_set(&m, &entries[i].key, HMAPITEM_OF(struct hmap_filtered, &entries[i]));
+    }
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_has(&m, &entries[i].key) == (i % 3 == 0));
+    }
+
+    hmap_destroy(&m);
+    free(entries);
+}
+
+void test_hmap_filter_disable() {
+    size_t n = 100;
+    struct hmap_filtered* entries = calloc(n, sizeof(struct hmap_filtered));
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    TEST_ASSERT(hmap_stats_filter_false_positive_rate(&m) == 1);
+
+    // enabling a filter on a filled map adds the present keys
+    for (size_t i = 0; i < n; i++) {
+        entries[i].key = i;
+        hmap_set(&m, &entries[i].key, HMAPITEM_OF(struct hmap_filtered, &entries[i]));
+    }
+    hmap_filter(&m, true);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_has(&m, &entries[i].key));
+    }
+
+    hmap_filter(&m, false);
+    TEST_ASSERT(m.filter == NULL);
+    TEST_ASSERT(hmap_stats_filter_false_positive_rate(&m) == 1);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_has(&m, &entries[i].key));
+    }
+
+    hmap_destroy(&m);
+    free(entries);
+}
@@ -0,0 +1,179 @@
+#include <threads.h>
+
+#include "acutest.h"
+
+#include "src/hmap_combine.h"
+
+#define HMAP_COMBINE_TESTS \
+    { "hmap combine set", test_hmap_combine_set }, \
+    { "hmap combine get pending", test_hmap_combine_get_pending }, \
+    { "hmap combine register", test_hmap_combine_register }, \
+    { "hmap combine lock", test_hmap_combine_lock }, \
+    { "hmap combine concurrent", test_hmap_combine_concurrent }
+
+void test_hmap_combine_set() {
+    size_t n = 3 * HMAP_COMBINE_BUFFER_CAPACITY;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 1);
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_combine_t c;
+    hmap_combine_init(&c, &m, 2);
+    hmap_combine_buffer_t* b = hmap_combine_register(&c);
+
+    for (size_t i = 0; i < HMAP_COMBINE_BUFFER_CAPACITY; i++) {
+        hmap_combine_set(&c, b, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // a full buffer is not flushed before the next insert
+    TEST_ASSERT(hmap_length(&m) == 0);
+    TEST_ASSERT(hmap_combine_stats_flushes(&c) == 0);
+
+    for (size_t i = HMAP_COMBINE_BUFFER_CAPACITY; i < n; i++) {
+        hmap_combine_set(&c, b, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    TEST_ASSERT(hmap_length(&m) == 2 * HMAP_COMBINE_BUFFER_CAPACITY);
+    TEST_ASSERT(hmap_combine_stats_flushes(&c) == 2);
+
+    hmap_combine_unregister(&c, b);
+    TEST_ASSERT(hmap_length(&m) == n);
+    TEST_ASSERT(hmap_stats_load_factor(&m) <= .6);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &i) == &entries[i]);
+    }
+
+    hmap_combine_destroy(&c);
+    hmap_destroy(&m);
+    free(entries);
+}
+
+void test_hmap_combine_get_pending() {
+    struct hmap_numbered* entries = hmap_numbered_range(3, 0, 1);
+    entries[2].number = 0;
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_combine_t c;
+    hmap_combine_init(&c, &m, 2);
+    hmap_combine_buffer_t* writer = hmap_combine_register(&c);
+    hmap_combine_buffer_t* other = hmap_combine_register(&c);
+
+    size_t key = 0;
+    hmap_combine_set(&c, writer, &entries[0].number, HMAPITEM_OF(struct hmap_numbered, &entries[0]));
+    TEST_ASSERT(hmap_combine_get(&c, writer, &key) == HMAPITEM_OF(struct hmap_numbered, &entries[0]));
+    TEST_ASSERT(hmap_combine_get(&c, other, &key) == NULL);
+
+    // the newest pending insert wins
+    hmap_combine_set(&c, writer, &entries[2].number, HMAPITEM_OF(struct hmap_numbered, &entries[2]));
+    TEST_ASSERT(hmap_combine_get(&c, writer, &key) == HMAPITEM_OF(struct hmap_numbered, &entries[2]));
+
+    hmap_combine_flush(&c);
+    TEST_ASSERT(hmap_length(&m) == 1);
+    TEST_ASSERT(hmap_combine_get(&c, other, &key) == HMAPITEM_OF(struct hmap_numbered, &entries[2]));
+    TEST_ASSERT(!hmapitem_in_map(HMAPITEM_OF(struct hmap_numbered, &entries[0]), &m));
+
+    hmap_combine_destroy(&c);
+    hmap_destroy(&m);
+    free(entries);
+}
+
+void test_hmap_combine_register() {
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_combine_t c;
+    hmap_combine_init(&c, &m, 2);
+
+    hmap_combine_buffer_t* a = hmap_combine_register(&c);
+    hmap_combine_buffer_t* b = hmap_combine_register(&c);
+    TEST_ASSERT(a != NULL);
+    TEST_ASSERT(b != NULL);
+    TEST_ASSERT(a != b);
+    TEST_ASSERT(hmap_combine_register(&c) == NULL);
+
+    hmap_combine_unregister(&c, a);
+    TEST_ASSERT(hmap_combine_register(&c) == a);
+
+    hmap_combine_destroy(&c);
+    hmap_destroy(&m);
+}
+
+void test_hmap_combine_lock() {
+    struct hmap_numbered* entries = hmap_numbered_range(2, 0, 1);
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_combine_t c;
+    hmap_combine_init(&c, &m, 1);
+    hmap_combine_buffer_t* b = hmap_combine_register(&c);
+
+    hmap_combine_set(&c, b, &entries[0].number, HMAPITEM_OF(struct hmap_numbered, &entries[0]));
+    hmap_combine_set(&c, b, &entries[1].number, HMAPITEM_OF(struct hmap_numbered, &entries[1]));
+
+    hmap_t* locked = hmap_combine_lock(&c);
+    TEST_ASSERT(locked == &m);
+    TEST_ASSERT(hmap_length(locked) == 2);
+    hmap_delete(locked, &entries[0].number);
+    hmap_combine_unlock(&c);
+
+    size_t key = 0;
+    TEST_ASSERT(hmap_combine_get(&c, b, &key) == NULL);
+
+    hmap_combine_destroy(&c);
+    hmap_destroy(&m);
+    free(entries);
+}
+
+typedef struct {
+    hmap_combine_t* c;
+    struct hmap_numbered* entries;
+    size_t n;
+    size_t missing;
+} hmap_combine_writer_args_t;
+
+int hmap_combine_write_loop(void* arg) {
+    hmap_combine_writer_args_t* a = arg;
+    hmap_combine_buffer_t* b = hmap_combine_register(a->c);
+
+    for (size_t i = 0; i < a->n; i++) {
+        hmap_combine_set(a->c, b, &a->entries[i].number, HMAPITEM_OF(struct hmap_numbered, &a->entries[i]));
+        if (hmap_combine_get(a->c, b, &a->entries[i].number) != HMAPITEM_OF(struct hmap_numbered, &a->entries[i])) {
+            a->missing++;
+        }
+    }
+
+    hmap_combine_unregister(a->c, b);
+    return 0;
+}
+
+void test_hmap_combine_concurrent() {
+    size_t n = 10000;
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_combine_t c;
+    hmap_combine_init(&c, &m, 4);
+
+    thrd_t threads[4];
+    hmap_combine_writer_args_t args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t] = (hmap_combine_writer_args_t){.c = &c, .entries = hmap_numbered_range(n, t * n, 1), .n = n};
+        TEST_ASSERT(thrd_create(&threads[t], hmap_combine_write_loop, &args[t]) == thrd_success);
+    }
+
+    for (int t = 0; t < 4; t++) {
+        thrd_join(threads[t], NULL);
+    }
+
+    TEST_ASSERT(hmap_length(&m) == 4 * n);
+    for (int t = 0; t < 4; t++) {
+        TEST_ASSERT(args[t].missing == 0);
+        for (size_t i = 0; i < n; i++) {
+            TEST_ASSERT(hmapitem_in_map(HMAPITEM_OF(struct hmap_numbered, &args[t].entries[i]), &m));
+        }
+        free(args[t].entries);
+    }
+
+    hmap_combine_destroy(&c);
+    hmap_destroy(&m);
+}
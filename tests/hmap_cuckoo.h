@@ -0,0 +1,179 @@
+#include "acutest.h"
+
+#include "src/hmap_cuckoo.h"
+
+#define HMAP_CUCKOO_TESTS \
+    { "hmap cuckoo init", test_hmap_cuckoo_init }, \
+    { "hmap cuckoo set get delete", test_hmap_cuckoo_set_get_delete }, \
+    { "hmap cuckoo overwrite", test_hmap_cuckoo_overwrite }, \
+    { "hmap cuckoo high load", test_hmap_cuckoo_high_load }, \
+    { "hmap cuckoo grow", test_hmap_cuckoo_grow }, \
+    { "hmap cuckoo constant hash", test_hmap_cuckoo_constant_hash }, \
+    { "hmap cuckoo foreach", test_hmap_cuckoo_foreach }
+
+void test_hmap_cuckoo_init() {
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_size_t, hmap_equals_size_t);
+
+    TEST_ASSERT(hmap_cuckoo_length(&c) == 0);
+    TEST_ASSERT(hmap_cuckoo_capacity(&c) >= HMAP_INITIAL_CAPACITY);
+    TEST_ASSERT(((uintptr_t)c.buckets) % HMAP_CACHE_LINE_SIZE == 0);
+
+    size_t key = 1;
+    TEST_ASSERT(hmap_cuckoo_get(&c, &key) == NULL);
+    TEST_ASSERT(hmap_cuckoo_delete(&c, &key) == NULL);
+
+    hmap_cuckoo_destroy(&c);
+}
+
+void test_hmap_cuckoo_set_get_delete() {
+    size_t n = 1000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_size_t, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_cuckoo_set(&c, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_cuckoo_length(&c) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 3;
+        TEST_ASSERT(HMAP_CUCKOO_GET(struct hmap_numbered, &c, &key) == &entries[i]);
+        key++;
+        TEST_ASSERT(!hmap_cuckoo_has(&c, &key));
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        size_t key = i * 3;
+        TEST_ASSERT(hmap_cuckoo_delete(&c, &key) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        TEST_ASSERT(!hmapitem_in_cuckoo(HMAPITEM_OF(struct hmap_numbered, &entries[i]), &c));
+        TEST_ASSERT(hmap_cuckoo_delete(&c, &key) == NULL);
+    }
+    TEST_ASSERT(hmap_cuckoo_length(&c) == n / 2);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 3;
+        TEST_ASSERT(hmap_cuckoo_has(&c, &key) == (i % 2 == 1));
+    }
+
+    hmap_cuckoo_destroy(&c);
+    free(entries);
+}
+
+void test_hmap_cuckoo_overwrite() {
+    struct hmap_numbered a = {.number = 5};
+    struct hmap_numbered b = {.number = 5};
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_size_t, hmap_equals_size_t);
+
+    hmap_cuckoo_set(&c, &a.number, HMAPITEM_OF(struct hmap_numbered, &a));
+    hmap_cuckoo_set(&c, &b.number, HMAPITEM_OF(struct hmap_numbered, &b));
+
+    TEST_ASSERT(hmap_cuckoo_length(&c) == 1);
+    TEST_ASSERT(HMAP_CUCKOO_GET(struct hmap_numbered, &c, &a.number) == &b);
+    TEST_ASSERT(!hmapitem_in_cuckoo(HMAPITEM_OF(struct hmap_numbered, &a), &c));
+    TEST_ASSERT(hmapitem_in_cuckoo(HMAPITEM_OF(struct hmap_numbered, &b), &c));
+
+    hmap_cuckoo_destroy(&c);
+}
+
+void test_hmap_cuckoo_high_load() {
+    size_t n = 4000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init_capacity(&c, hmap_hash_size_t, hmap_equals_size_t, n / 2);
+    size_t capacity = hmap_cuckoo_capacity(&c);
+    size_t fill = (size_t)(capacity * HMAP_CUCKOO_MAX_LOAD);
+
+    TEST_ASSERT(fill <= n);
+    for (size_t i = 0; i < fill; i++) {
+        hmap_cuckoo_set(&c, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // the displacement search fills the table up to the maximum load without growing
+    TEST_ASSERT(hmap_cuckoo_capacity(&c) == capacity);
+    TEST_ASSERT(hmap_cuckoo_stats_load_factor(&c) > 0.9f);
+    TEST_ASSERT(hmap_cuckoo_stats_stash_length(&c) == 0);
+
+    for (size_t i = 0; i < hmap_cuckoo_length(&c); i++) {
+        TEST_ASSERT(hmap_cuckoo_get(&c, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    hmap_cuckoo_destroy(&c);
+    free(entries);
+}
+
+void test_hmap_cuckoo_grow() {
+    size_t n = 10000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_cuckoo_max_load(&c, 0.5f);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_cuckoo_set(&c, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        TEST_ASSERT(hmap_cuckoo_stats_load_factor(&c) <= 0.5f);
+    }
+    TEST_ASSERT(hmap_cuckoo_length(&c) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_cuckoo_get(&c, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    hmap_cuckoo_destroy(&c);
+    free(entries);
+}
+
+void test_hmap_cuckoo_constant_hash() {
+    size_t n = 50;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_bad_same, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_cuckoo_set(&c, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_cuckoo_length(&c) == n);
+    TEST_ASSERT(hmap_cuckoo_stats_stash_length(&c) > 0);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_cuckoo_get(&c, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hmap_cuckoo_delete(&c, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_cuckoo_has(&c, &entries[i].number) == (i % 2 == 1));
+    }
+
+    hmap_cuckoo_destroy(&c);
+    free(entries);
+}
+
+void test_hmap_cuckoo_foreach() {
+    size_t n = 100;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_cuckoo_t c;
+    hmap_cuckoo_init(&c, hmap_hash_size_t, hmap_equals_size_t);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        hmap_cuckoo_set(&c, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        expected += entries[i].number;
+    }
+
+    size_t sum = 0;
+    hmap_cuckoo_foreach(&c, hmap_sum_keys, &sum);
+    TEST_ASSERT(sum == expected);
+
+    hmap_cuckoo_destroy(&c);
+    free(entries);
+}
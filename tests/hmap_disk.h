@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "acutest.h"
+
+#include "src/hmap_disk.h"
+
+#define HMAP_DISK_TESTS \
+    { "hmap disk set get delete", test_hmap_disk_set_get_delete }, \
+    { "hmap disk overwrite", test_hmap_disk_overwrite }, \
+    { "hmap disk memory budget", test_hmap_disk_memory_budget }, \
+    { "hmap disk write back error", test_hmap_disk_write_back_error }, \
+    { "hmap disk colliding keys", test_hmap_disk_colliding_keys }, \
+    { "hmap disk reopen", test_hmap_disk_reopen }
+
+void hmap_disk_test_directory(char* directory) {
+    strcpy(directory, "/tmp/hmap_disk_XXXXXX");
+    TEST_ASSERT(mkdtemp(directory) != NULL);
+}
+
+void hmap_disk_test_remove(char* directory, size_t partitions) {
+    char path[64];
+    for (size_t k = 0; k < partitions; k++) {
+        sprintf(path, "%s/%06zu.hmap", directory, k);
+        unlink(path);
+    }
+    TEST_ASSERT(rmdir(directory) == 0);
+}
+
+size_t hmap_disk_test_key(char* key, size_t i) {
+    return (size_t)sprintf(key, "key-%zu", i);
+}
+
+void test_hmap_disk_set_get_delete() {
+    char directory[32];
+    hmap_disk_test_directory(directory);
+
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 8, 1 << 20) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == 0);
+
+    size_t n = 1000;
+    char key[32];
+    for (size_t i = 0; i < n; i++) {
+        uint64_t value = i * 3;
+        TEST_ASSERT(hmap_disk_set(&d, key, hmap_disk_test_key(key, i), &value, sizeof(value)) == 0);
+    }
+    TEST_ASSERT(hmap_disk_length(&d) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t value_length = 0;
+        const uint64_t* value = hmap_disk_get(&d, key, hmap_disk_test_key(key, i), &value_length);
+        TEST_ASSERT(value != NULL);
+        TEST_ASSERT(value_length == sizeof(uint64_t));
+        TEST_ASSERT(*value == i * 3);
+    }
+    TEST_ASSERT(!hmap_disk_has(&d, "key-", 4));
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hmap_disk_delete(&d, key, hmap_disk_test_key(key, i)) == 1);
+    }
+    TEST_ASSERT(hmap_disk_delete(&d, key, hmap_disk_test_key(key, 0)) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == n / 2);
+
+    size_t length = 0;
+    for (size_t k = 0; k < 8; k++) {
+        length += hmap_disk_stats_partition_length(&d, k);
+    }
+    TEST_ASSERT(length == n / 2);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_disk_has(&d, key, hmap_disk_test_key(key, i)) == (i % 2 == 1));
+    }
+
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+    hmap_disk_test_remove(directory, 8);
+}
+
+void test_hmap_disk_overwrite() {
+    char directory[32];
+    hmap_disk_test_directory(directory);
+
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 4, 1 << 20) == 0);
+
+    TEST_ASSERT(hmap_disk_set(&d, "a", 1, "short", 5) == 0);
+    TEST_ASSERT(hmap_disk_set(&d, "a", 1, "a longer value", 14) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == 1);
+
+    size_t value_length = 0;
+    const char* value = hmap_disk_get(&d, "a", 1, &value_length);
+    TEST_ASSERT(value_length == 14);
+    TEST_ASSERT(memcmp(value, "a longer value", 14) == 0);
+
+    // empty values are values
+    TEST_ASSERT(hmap_disk_set(&d, "b", 1, NULL, 0) == 0);
+    TEST_ASSERT(hmap_disk_has(&d, "b", 1));
+
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+    hmap_disk_test_remove(directory, 4);
+}
+
+void test_hmap_disk_memory_budget() {
+    char directory[32];
+    hmap_disk_test_directory(directory);
+
+    // far less memory than the entries take
+    size_t budget = 64 * 1024;
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 64, budget) == 0);
+
+    size_t n = 20000;
+    char key[32];
+    char value[64];
+    for (size_t i = 0; i < n; i++) {
+        memset(value, (int)(i % 256), sizeof(value));
+        TEST_ASSERT(hmap_disk_set(&d, key, hmap_disk_test_key(key, i), value, sizeof(value)) == 0);
+        TEST_ASSERT(hmap_disk_stats_resident_bytes(&d) <= budget);
+    }
+    TEST_ASSERT(hmap_disk_length(&d) == n);
+    TEST_ASSERT(hmap_disk_stats_evictions(&d) > 0);
+    TEST_ASSERT(hmap_disk_stats_loads(&d) > 0);
+    TEST_ASSERT(hmap_disk_stats_resident_partitions(&d) < 64);
+
+    // cold partitions are read through their mapping and are not loaded
+    size_t loads = hmap_disk_stats_loads(&d);
+    for (size_t i = 0; i < n; i++) {
+        size_t value_length = 0;
+        const unsigned char* v = hmap_disk_get(&d, key, hmap_disk_test_key(key, i), &value_length);
+        TEST_ASSERT(v != NULL);
+        TEST_ASSERT(value_length == sizeof(value));
+        TEST_ASSERT(v[0] == i % 256 && v[sizeof(value) - 1] == i % 256);
+    }
+    TEST_ASSERT(hmap_disk_stats_loads(&d) == loads);
+
+    // shrinking the budget evicts all partitions
+    TEST_ASSERT(hmap_disk_memory_budget(&d, 0) == 0);
+    TEST_ASSERT(hmap_disk_stats_resident_partitions(&d) == 0);
+    TEST_ASSERT(hmap_disk_stats_resident_bytes(&d) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == n);
+
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+    hmap_disk_test_remove(directory, 64);
+}
+
+void test_hmap_disk_write_back_error() {
+    char directory[32];
+    hmap_disk_test_directory(directory);
+
+    // every set evicts the other partition
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 2, 0) == 0);
+    char key[32];
+    TEST_ASSERT(hmap_disk_set(&d, key, hmap_disk_test_key(key, 0), "a", 1) == 0);
+    size_t first = hmap_disk_stats_partition_length(&d, 0) == 1 ? 0 : 1;
+
+    // a directory in place of the temporary segment file makes writing the first partition fail
+    char tmp[64];
+    sprintf(tmp, "%s/%06zu.hmap.tmp", directory, first);
+    TEST_ASSERT(mkdir(tmp, 0755) == 0);
+
+    size_t i = 1;
+    while (hmap_disk_stats_partition_length(&d, 1 - first) == 0) {
+        TEST_ASSERT(hmap_disk_set(&d, key, hmap_disk_test_key(key, i++), "b", 1) == 0);
+    }
+    TEST_ASSERT(hmap_disk_write_back_error(&d) != 0);
+    TEST_ASSERT(hmap_disk_write_back_error(&d) == 0);
+    TEST_ASSERT(hmap_disk_stats_partition_resident(&d, first));
+    TEST_ASSERT(hmap_disk_has(&d, key, hmap_disk_test_key(key, i - 1)));
+    TEST_ASSERT(hmap_disk_has(&d, key, hmap_disk_test_key(key, 0)));
+
+    // the partition is written once the cause is gone
+    TEST_ASSERT(rmdir(tmp) == 0);
+    TEST_ASSERT(hmap_disk_memory_budget(&d, 0) == 0);
+    TEST_ASSERT(hmap_disk_stats_resident_partitions(&d) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == i);
+
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+    hmap_disk_test_remove(directory, 2);
+}
+
+void test_hmap_disk_colliding_keys() {
+    // two keys with the same 64 bit FNV-1a hash value, so they share a partition and a hash in the resident map
+    const unsigned char a[8] = {0xed, 0xae, 0xcd, 0xed, 0x9b, 0xb1, 0x88, 0x15};
+    const unsigned char b[8] = {0xec, 0xc0, 0x0f, 0x8b, 0x74, 0x0d, 0x39, 0x6e};
+    TEST_ASSERT(hmap_mapped_hash_bytes(a, sizeof(a)) == hmap_mapped_hash_bytes(b, sizeof(b)));
+
+    char directory[32];
+    hmap_disk_test_directory(directory);
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 4, 1 << 20) == 0);
+    TEST_ASSERT(hmap_disk_set(&d, a, sizeof(a), "a", 1) == 0);
+    TEST_ASSERT(hmap_disk_set(&d, b, sizeof(b), "b", 1) == 0);
+
+    // the partition is written back and evicted, lookups go through its segment file
+    TEST_ASSERT(hmap_disk_memory_budget(&d, 0) == 0);
+    TEST_ASSERT(hmap_disk_stats_resident_partitions(&d) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == 2);
+    const char* value = hmap_disk_get(&d, a, sizeof(a), NULL);
+    TEST_ASSERT(value != NULL && *value == 'a');
+    value = hmap_disk_get(&d, b, sizeof(b), NULL);
+    TEST_ASSERT(value != NULL && *value == 'b');
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+
+    TEST_ASSERT(hmap_disk_open(&d, directory, 4, 1 << 20) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == 2);
+    TEST_ASSERT(hmap_disk_delete(&d, a, sizeof(a)) == 1);
+    value = hmap_disk_get(&d, b, sizeof(b), NULL);
+    TEST_ASSERT(value != NULL && *value == 'b');
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+
+    hmap_disk_test_remove(directory, 4);
+}
+
+void test_hmap_disk_reopen() {
+    char directory[32];
+    hmap_disk_test_directory(directory);
+
+    hmap_disk_t d;
+    TEST_ASSERT(hmap_disk_open(&d, directory, 16, 1 << 20) == 0);
+
+    size_t n = 500;
+    char key[32];
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_disk_set(&d, key, hmap_disk_test_key(key, i), &i, sizeof(i)) == 0);
+    }
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+
+    TEST_ASSERT(hmap_disk_open(&d, directory, 16, 1 << 20) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == n);
+    TEST_ASSERT(hmap_disk_stats_resident_partitions(&d) == 0);
+    for (size_t i = 0; i < n; i++) {
+        const size_t* value = hmap_disk_get(&d, key, hmap_disk_test_key(key, i), NULL);
+        TEST_ASSERT(value != NULL && *value == i);
+    }
+
+    TEST_ASSERT(hmap_disk_delete(&d, key, hmap_disk_test_key(key, 0)) == 1);
+    TEST_ASSERT(hmap_disk_stats_loads(&d) == 1);
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+
+    TEST_ASSERT(hmap_disk_open(&d, directory, 16, 1 << 20) == 0);
+    TEST_ASSERT(hmap_disk_length(&d) == n - 1);
+    TEST_ASSERT(!hmap_disk_has(&d, key, hmap_disk_test_key(key, 0)));
+    TEST_ASSERT(hmap_disk_close(&d) == 0);
+
+    hmap_disk_test_remove(directory, 16);
+}
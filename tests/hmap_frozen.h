@@ -0,0 +1,113 @@
+#include "acutest.h"
+
+#include "src/hmap_frozen.h"
+
+#define HMAP_FROZEN_TESTS \
+    { "hmap freeze", test_hmap_freeze }, \
+    { "hmap freeze empty", test_hmap_freeze_empty }, \
+    { "hmap freeze identical hashes", test_hmap_freeze_identical_hashes }, \
+    { "hmap frozen foreach", test_hmap_frozen_foreach }
+
+size_t hmap_frozen_hash_even(void* ptr) {
+    return *(size_t*)ptr / 2;
+}
+
+struct hmap_numbered* hmap_frozen_entries(hmap_t* m, size_t n) {
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 7);
+    for (size_t i = 0; i < n; i++) {
+        hmap_set(m, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    return entries;
+}
+
+void test_hmap_freeze() {
+    size_t n = 10000;
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    struct hmap_numbered* entries = hmap_frozen_entries(&m, n);
+
+    hmap_frozen_t f;
+    TEST_ASSERT(hmap_freeze(&m, &f) == 0);
+
+    // the items moved to the frozen map
+    TEST_ASSERT(hmap_length(&m) == 0);
+    TEST_ASSERT(!hmap_has(&m, &entries[0].number));
+    TEST_ASSERT(hmap_frozen_length(&f) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 7;
+        TEST_ASSERT(HMAP_FROZEN_GET(struct hmap_numbered, &f, &key) == &entries[i]);
+        TEST_ASSERT(!hmapitem_in_map(HMAPITEM_OF(struct hmap_numbered, &entries[i]), &m));
+        key++;
+        TEST_ASSERT(!hmap_frozen_has(&f, &key));
+    }
+
+    // a minimal perfect hash has no empty slots
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(f.items[i] != NULL);
+    }
+
+    hmap_frozen_destroy(&f);
+    hmap_destroy(&m);
+    free(entries);
+}
+
+void test_hmap_freeze_empty() {
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+
+    hmap_frozen_t f;
+    TEST_ASSERT(hmap_freeze(&m, &f) == 0);
+    TEST_ASSERT(hmap_frozen_length(&f) == 0);
+
+    size_t key = 3;
+    TEST_ASSERT(hmap_frozen_get(&f, &key) == NULL);
+
+    hmap_frozen_destroy(&f);
+    hmap_destroy(&m);
+}
+
+void test_hmap_freeze_identical_hashes() {
+    hmap_t m;
+    hmap_init(&m, hmap_frozen_hash_even, hmap_equals_size_t);
+
+    struct hmap_numbered a = {.number = 4};
+    struct hmap_numbered b = {.number = 5};
+    hmap_set(&m, &a.number, HMAPITEM_OF(struct hmap_numbered, &a));
+    hmap_set(&m, &b.number, HMAPITEM_OF(struct hmap_numbered, &b));
+
+    hmap_frozen_t f;
+    TEST_ASSERT(hmap_freeze(&m, &f) == -1);
+
+    // the map is left untouched
+    TEST_ASSERT(hmap_length(&m) == 2);
+    TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &a.number) == &a);
+    TEST_ASSERT(HMAP_GET(struct hmap_numbered, &m, &b.number) == &b);
+
+    hmap_destroy(&m);
+}
+
+void test_hmap_frozen_foreach() {
+    size_t n = 100;
+
+    hmap_t m;
+    hmap_init(&m, hmap_hash_size_t, hmap_equals_size_t);
+    struct hmap_numbered* entries = hmap_frozen_entries(&m, n);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        expected += entries[i].number;
+    }
+
+    hmap_frozen_t f;
+    TEST_ASSERT(hmap_freeze(&m, &f) == 0);
+
+    size_t sum = 0;
+    hmap_frozen_foreach(&f, hmap_sum_keys, &sum);
+    TEST_ASSERT(sum == expected);
+
+    hmap_frozen_destroy(&f);
+    hmap_destroy(&m);
+    free(entries);
+}
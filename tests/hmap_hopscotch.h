@@ -0,0 +1,222 @@
+#include "acutest.h"
+
+#include "src/hmap_hopscotch.h"
+
+#define HMAP_HOPSCOTCH_TESTS \
+    { "hmap hopscotch init", test_hmap_hopscotch_init }, \
+    { "hmap hopscotch set get delete", test_hmap_hopscotch_set_get_delete }, \
+    { "hmap hopscotch overwrite", test_hmap_hopscotch_overwrite }, \
+    { "hmap hopscotch high load", test_hmap_hopscotch_high_load }, \
+    { "hmap hopscotch grow", test_hmap_hopscotch_grow }, \
+    { "hmap hopscotch constant hash", test_hmap_hopscotch_constant_hash }, \
+    { "hmap hopscotch delete keeps positions", test_hmap_hopscotch_delete_keeps_positions }, \
+    { "hmap hopscotch foreach", test_hmap_hopscotch_foreach }
+
+void test_hmap_hopscotch_init() {
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_size_t, hmap_equals_size_t);
+
+    TEST_ASSERT(hmap_hopscotch_length(&h) == 0);
+    TEST_ASSERT(hmap_hopscotch_capacity(&h) >= HMAP_INITIAL_CAPACITY);
+
+    size_t key = 1;
+    TEST_ASSERT(hmap_hopscotch_get(&h, &key) == NULL);
+    TEST_ASSERT(hmap_hopscotch_delete(&h, &key) == NULL);
+
+    hmap_hopscotch_destroy(&h);
+}
+
+void test_hmap_hopscotch_set_get_delete() {
+    size_t n = 1000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_size_t, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_hopscotch_length(&h) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 3;
+        TEST_ASSERT(HMAP_HOPSCOTCH_GET(struct hmap_numbered, &h, &key) == &entries[i]);
+        key++;
+        TEST_ASSERT(!hmap_hopscotch_has(&h, &key));
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        size_t key = i * 3;
+        TEST_ASSERT(hmap_hopscotch_delete(&h, &key) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        TEST_ASSERT(!hmapitem_in_hopscotch(HMAPITEM_OF(struct hmap_numbered, &entries[i]), &h));
+        TEST_ASSERT(hmap_hopscotch_delete(&h, &key) == NULL);
+    }
+    TEST_ASSERT(hmap_hopscotch_length(&h) == n / 2);
+
+    for (size_t i = 0; i < n; i++) {
+        size_t key = i * 3;
+        TEST_ASSERT(hmap_hopscotch_has(&h, &key) == (i % 2 == 1));
+    }
+
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
+
+void test_hmap_hopscotch_overwrite() {
+    struct hmap_numbered a = {.number = 5};
+    struct hmap_numbered b = {.number = 5};
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_size_t, hmap_equals_size_t);
+
+    hmap_hopscotch_set(&h, &a.number, HMAPITEM_OF(struct hmap_numbered, &a));
+    hmap_hopscotch_set(&h, &b.number, HMAPITEM_OF(struct hmap_numbered, &b));
+
+    TEST_ASSERT(hmap_hopscotch_length(&h) == 1);
+    TEST_ASSERT(HMAP_HOPSCOTCH_GET(struct hmap_numbered, &h, &a.number) == &b);
+    TEST_ASSERT(!hmapitem_in_hopscotch(HMAPITEM_OF(struct hmap_numbered, &a), &h));
+    TEST_ASSERT(hmapitem_in_hopscotch(HMAPITEM_OF(struct hmap_numbered, &b), &h));
+
+    hmap_hopscotch_destroy(&h);
+}
+
+void test_hmap_hopscotch_high_load() {
+    size_t n = 4000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init_capacity(&h, hmap_hash_size_t, hmap_equals_size_t, n / 2);
+    size_t capacity = hmap_hopscotch_capacity(&h);
+    size_t fill = (size_t)(capacity * HMAP_HOPSCOTCH_MAX_LOAD);
+
+    TEST_ASSERT(fill <= n);
+    for (size_t i = 0; i < fill; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // hopping items closer to their home slot fills the table up to the maximum load without growing
+    TEST_ASSERT(hmap_hopscotch_capacity(&h) == capacity);
+    TEST_ASSERT(hmap_hopscotch_stats_load_factor(&h) > HMAP_HOPSCOTCH_MAX_LOAD - 0.01f);
+    TEST_ASSERT(hmap_hopscotch_stats_stash_length(&h) == 0);
+
+    for (size_t i = 0; i < hmap_hopscotch_length(&h); i++) {
+        TEST_ASSERT(hmap_hopscotch_get(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
+
+void test_hmap_hopscotch_grow() {
+    size_t n = 10000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_size_t, hmap_equals_size_t);
+    hmap_hopscotch_max_load(&h, 0.5f);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        TEST_ASSERT(hmap_hopscotch_stats_load_factor(&h) <= 0.5f);
+    }
+    TEST_ASSERT(hmap_hopscotch_length(&h) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_hopscotch_get(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
+
+void test_hmap_hopscotch_constant_hash() {
+    size_t n = 50;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_bad_same, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_hopscotch_length(&h) == n);
+    TEST_ASSERT(hmap_hopscotch_stats_stash_length(&h) > 0);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_hopscotch_get(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hmap_hopscotch_delete(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_hopscotch_has(&h, &entries[i].number) == (i % 2 == 1));
+    }
+
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
+
+void test_hmap_hopscotch_delete_keeps_positions() {
+    size_t n = 500;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init_capacity(&h, hmap_hash_size_t, hmap_equals_size_t, n);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    size_t slots = h.capacity + HMAP_HOPSCOTCH_NEIGHBORHOOD - 1;
+    hmap_hopscotch_slot_t* before = malloc(slots * sizeof(hmap_hopscotch_slot_t));
+    memcpy(before, h.slots, slots * sizeof(hmap_hopscotch_slot_t));
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hmap_hopscotch_delete(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // deleting only empties the slot of the deleted item, all other items stay where they are
+    for (size_t s = 0; s < slots; s++) {
+        if (h.slots[s].item != NULL) {
+            TEST_ASSERT(h.slots[s].item == before[s].item);
+        }
+    }
+    for (size_t i = 1; i < n; i += 2) {
+        TEST_ASSERT(hmap_hopscotch_get(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // the freed slots are reused
+    for (size_t i = 0; i < n; i += 2) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_hopscotch_length(&h) == n);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_hopscotch_get(&h, &entries[i].number) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    free(before);
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
+
+void test_hmap_hopscotch_foreach() {
+    size_t n = 100;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 3);
+
+    hmap_hopscotch_t h;
+    hmap_hopscotch_init(&h, hmap_hash_size_t, hmap_equals_size_t);
+
+    size_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        hmap_hopscotch_set(&h, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        expected += entries[i].number;
+    }
+
+    size_t sum = 0;
+    hmap_hopscotch_foreach(&h, hmap_sum_keys, &sum);
+    TEST_ASSERT(sum == expected);
+
+    hmap_hopscotch_destroy(&h);
+    free(entries);
+}
@@ -0,0 +1,200 @@
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "acutest.h"
+
+#include "src/hmap_mapped.h"
+
+#define HMAP_MAPPED_TESTS \
+    { "hmap mapped write open get", test_hmap_mapped_write_open_get }, \
+    { "hmap mapped empty", test_hmap_mapped_empty }, \
+    { "hmap mapped invalid file", test_hmap_mapped_invalid_file }, \
+    { "hmap mapped foreach", test_hmap_mapped_foreach }, \
+    { "hmap mapped keyed hash", test_hmap_mapped_keyed_hash }
+
+typedef struct {
+    char name[16];
+    uint64_t population;
+    HMAPITEM_PROP();
+} hmap_mapped_entry_t;
+
+size_t hmap_mapped_test_hash(void* ptr) {
+    return hmap_mapped_hash_bytes(ptr, strlen(ptr));
+}
+
+bool hmap_mapped_test_equals(void* a, void* b) {
+    return strcmp(a, b) == 0;
+}
+
+size_t hmap_mapped_test_key_bytes(void* key, const void** bytes) {
+    *bytes = key;
+    return strlen(key);
+}
+
+size_t hmap_mapped_test_value_bytes(void* item, const void** bytes) {
+    hmap_mapped_entry_t* e = HMAPITEM_AS(hmap_mapped_entry_t, item);
+    *bytes = &e->population;
+    return sizeof(e->population);
+}
+
+void hmap_mapped_test_path(char* path) {
+    strcpy(path, "/tmp/hmap_mapped_XXXXXX");
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    close(fd);
+}
+
+void test_hmap_mapped_write_open_get() {
+    size_t n = 5000;
+    hmap_mapped_entry_t* entries = calloc(n, sizeof(hmap_mapped_entry_t));
+
+    hmap_t m;
+    hmap_init(&m, hmap_mapped_test_hash, hmap_mapped_test_equals);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(entries[i].name, sizeof(entries[i].name), "city-%zu", i);
+        entries[i].population = i * 1000;
+        hmap_set(&m, entries[i].name, HMAPITEM_OF(hmap_mapped_entry_t, &entries[i]));
+    }
+
+    char path[32];
+    hmap_mapped_test_path(path);
+    TEST_ASSERT(hmap_mapped_write(&m, path, hmap_mapped_test_key_bytes, hmap_mapped_test_value_bytes) == 0);
+
+    // the mapped file does not depend on the map or its items anymore
+    hmap_destroy(&m);
+    free(entries);
+
+    hmap_mapped_t mp;
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == 0);
+    TEST_ASSERT(hmap_mapped_length(&mp) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "city-%zu", i);
+
+        size_t value_length = 0;
+        const uint64_t* population = hmap_mapped_get(&mp, name, strlen(name), &value_length);
+        TEST_ASSERT(population != NULL);
+        TEST_ASSERT(((uintptr_t)population) % 8 == 0);
+        TEST_ASSERT(value_length == sizeof(uint64_t));
+        TEST_ASSERT(*population == i * 1000);
+    }
+
+    TEST_ASSERT(!hmap_mapped_has(&mp, "city-", 5));
+    TEST_ASSERT(!hmap_mapped_has(&mp, "town-1", 6));
+    TEST_ASSERT(!hmap_mapped_has(&mp, "city-99999", 10));
+
+    hmap_mapped_close(&mp);
+    unlink(path);
+}
+
+void test_hmap_mapped_empty() {
+    hmap_t m;
+    hmap_init(&m, hmap_mapped_test_hash, hmap_mapped_test_equals);
+
+    char path[32];
+    hmap_mapped_test_path(path);
+    TEST_ASSERT(hmap_mapped_write(&m, path, hmap_mapped_test_key_bytes, hmap_mapped_test_value_bytes) == 0);
+    hmap_destroy(&m);
+
+    hmap_mapped_t mp;
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == 0);
+    TEST_ASSERT(hmap_mapped_length(&mp) == 0);
+    TEST_ASSERT(hmap_mapped_get(&mp, "a", 1, NULL) == NULL);
+
+    hmap_mapped_close(&mp);
+    unlink(path);
+}
+
+void test_hmap_mapped_invalid_file() {
+    char path[32];
+    hmap_mapped_test_path(path);
+
+    hmap_mapped_t mp;
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == -1);
+    TEST_ASSERT(errno == EINVAL);
+
+    FILE* file = fopen(path, "wb");
+    char garbage[256] = "definitely not a mapped map";
+    fwrite(garbage, 1, sizeof(garbage), file);
+    fclose(file);
+
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == -1);
+    TEST_ASSERT(errno == EINVAL);
+
+    unlink(path);
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == -1);
+    TEST_ASSERT(errno == ENOENT);
+}
+
+void hmap_mapped_test_sum(const void* key, size_t key_length, const void* value, size_t value_length, void* userdata) {
+    TEST_ASSERT(strncmp(key, "city-", 5) == 0 && key_length > 5);
+    TEST_ASSERT(value_length == sizeof(uint64_t));
+    *(uint64_t*)userdata += *(const uint64_t*)value;
+}
+
+void test_hmap_mapped_foreach() {
+    size_t n = 100;
+    hmap_mapped_entry_t* entries = calloc(n, sizeof(hmap_mapped_entry_t));
+
+    hmap_t m;
+    hmap_init(&m, hmap_mapped_test_hash, hmap_mapped_test_equals);
+    for (size_t i = 0; i < n; i++) {
+        snprintf(entries[i].name, sizeof(entries[i].name), "city-%zu", i);
+        entries[i].population = i;
+        hmap_set(&m, entries[i].name, HMAPITEM_OF(hmap_mapped_entry_t, &entries[i]));
+    }
+
+    char path[32];
+    hmap_mapped_test_path(path);
+    TEST_ASSERT(hmap_mapped_write(&m, path, hmap_mapped_test_key_bytes, hmap_mapped_test_value_bytes) == 0);
+    hmap_destroy(&m);
+    free(entries);
+
+    hmap_mapped_t mp;
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == 0);
+    uint64_t sum = 0;
+    hmap_mapped_foreach(&mp, hmap_mapped_test_sum, &sum);
+    TEST_ASSERT(sum == n * (n - 1) / 2);
+
+    hmap_mapped_close(&mp);
+    unlink(path);
+}
+
+void test_hmap_mapped_keyed_hash() {
+    // reference values of SipHash-2-4 for the key 00 01 .. 0f and the messages 00 01 .. of length 0, 7, 8 and 15
+    uint64_t key[2] = {UINT64_C(0x0706050403020100), UINT64_C(0x0f0e0d0c0b0a0908)};
+    unsigned char message[15];
+    for (size_t i = 0; i < sizeof(message); i++) {
+        message[i] = (unsigned char)i;
+    }
+    TEST_ASSERT(hmap_mapped_hash_bytes_keyed(message, 0, key) == (size_t)UINT64_C(0x726fdb47dd0e0e31));
+    TEST_ASSERT(hmap_mapped_hash_bytes_keyed(message, 7, key) == (size_t)UINT64_C(0xab0200f58b01d137));
+    TEST_ASSERT(hmap_mapped_hash_bytes_keyed(message, 8, key) == (size_t)UINT64_C(0x93f5f5799a932462));
+    TEST_ASSERT(hmap_mapped_hash_bytes_keyed(message, 15, key) == (size_t)UINT64_C(0xa129ca6149be45e5));
+
+    // every write draws a new hash key
+    hmap_t m;
+    hmap_init(&m, hmap_mapped_test_hash, hmap_mapped_test_equals);
+    hmap_mapped_entry_t entry = {.name = "city", .population = 1};
+    hmap_set(&m, entry.name, HMAPITEM_OF(hmap_mapped_entry_t, &entry));
+
+    char path[32];
+    hmap_mapped_test_path(path);
+    hmap_mapped_t mp;
+    TEST_ASSERT(hmap_mapped_write(&m, path, hmap_mapped_test_key_bytes, hmap_mapped_test_value_bytes) == 0);
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == 0);
+    uint64_t first[2] = {mp.header->hash_key[0], mp.header->hash_key[1]};
+    hmap_mapped_close(&mp);
+
+    TEST_ASSERT(hmap_mapped_write(&m, path, hmap_mapped_test_key_bytes, hmap_mapped_test_value_bytes) == 0);
+    TEST_ASSERT(hmap_mapped_open(&mp, path) == 0);
+    TEST_ASSERT(mp.header->hash_key[0] != first[0] || mp.header->hash_key[1] != first[1]);
+    const uint64_t* population = hmap_mapped_get(&mp, "city", 4, NULL);
+    TEST_ASSERT(population != NULL && *population == 1);
+    hmap_mapped_close(&mp);
+
+    hmap_destroy(&m);
+    unlink(path);
+}
@@ -0,0 +1,179 @@
+#include <stdatomic.h>
+#include <threads.h>
+
+#include "acutest.h"
+
+#include "src/hmap_rcu.h"
+
+#define HMAP_RCU_TESTS \
+    { "hmap rcu publish", test_hmap_rcu_publish }, \
+    { "hmap rcu grace period", test_hmap_rcu_grace_period }, \
+    { "hmap rcu register", test_hmap_rcu_register }, \
+    { "hmap rcu concurrent readers", test_hmap_rcu_concurrent_readers }
+
+#define HMAP_RCU_KEYS 64
+
+typedef struct {
+    size_t key;
+    size_t version;
+    HMAPITEM_PROP();
+} hmap_rcu_entry_t;
+
+typedef struct {
+    hmap_t map;
+    hmap_rcu_entry_t entries[HMAP_RCU_KEYS];
+} hmap_rcu_version_t;
+
+hmap_t* hmap_rcu_build_version(size_t version) {
+    hmap_rcu_version_t* v = calloc(1, sizeof(hmap_rcu_version_t));
+    hmap_init(&v->map, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < HMAP_RCU_KEYS; i++) {
+        v->entries[i].key = i;
+        v->entries[i].version = version;
+        HMAP_SET(hmap_rcu_entry_t, &v->map, &v->entries[i].key, &v->entries[i]);
+    }
+    return &v->map;
+}
+
+void hmap_rcu_count_reclaim(hmap_t* m, void* userdata) {
+    atomic_size_t* reclaimed = userdata;
+    hmap_destroy(m);
+    free(m);
+    atomic_fetch_add(reclaimed, 1);
+}
+
+void test_hmap_rcu_publish() {
+    atomic_size_t reclaimed = 0;
+    hmap_rcu_t r;
+    hmap_rcu_init(&r, hmap_rcu_build_version(1), hmap_rcu_count_reclaim, &reclaimed);
+
+    hmap_rcu_reader_t* reader = hmap_rcu_register(&r);
+    TEST_ASSERT(reader != NULL);
+
+    size_t key = 7;
+    hmap_t* m = hmap_rcu_read_lock(&r, reader);
+    TEST_ASSERT(HMAP_GET(hmap_rcu_entry_t, m, &key)->version == 1);
+    hmap_rcu_read_unlock(reader);
+
+    hmap_rcu_publish(&r, hmap_rcu_build_version(2));
+    TEST_ASSERT(reclaimed == 1);
+
+    m = hmap_rcu_read_lock(&r, reader);
+    TEST_ASSERT(m == hmap_rcu_current(&r));
+    TEST_ASSERT(HMAP_GET(hmap_rcu_entry_t, m, &key)->version == 2);
+    hmap_rcu_read_unlock(reader);
+
+    hmap_rcu_unregister(reader);
+    hmap_rcu_destroy(&r);
+    TEST_ASSERT(reclaimed == 2);
+}
+
+void test_hmap_rcu_grace_period() {
+    atomic_size_t reclaimed = 0;
+    hmap_rcu_t r;
+    hmap_rcu_init(&r, hmap_rcu_build_version(1), hmap_rcu_count_reclaim, &reclaimed);
+
+    hmap_rcu_reader_t* slow = hmap_rcu_register(&r);
+    hmap_rcu_reader_t* fast = hmap_rcu_register(&r);
+
+    size_t key = 3;
+    hmap_t* old = hmap_rcu_read_lock(&r, slow);
+
+    hmap_rcu_publish(&r, hmap_rcu_build_version(2));
+    hmap_rcu_publish(&r, hmap_rcu_build_version(3));
+
+    // the slow reader still uses version 1, version 2 was retired after it too
+    TEST_ASSERT(reclaimed == 0);
+    TEST_ASSERT(HMAP_GET(hmap_rcu_entry_t, old, &key)->version == 1);
+
+    // a reader entering now can not see the retired versions but does not release them either
+    hmap_t* m = hmap_rcu_read_lock(&r, fast);
+    TEST_ASSERT(HMAP_GET(hmap_rcu_entry_t, m, &key)->version == 3);
+    TEST_ASSERT(hmap_rcu_reclaim(&r) == 2);
+
+    hmap_rcu_read_unlock(slow);
+    TEST_ASSERT(hmap_rcu_reclaim(&r) == 0);
+    TEST_ASSERT(reclaimed == 2);
+
+    hmap_rcu_read_unlock(fast);
+    hmap_rcu_destroy(&r);
+    TEST_ASSERT(reclaimed == 3);
+}
+
+void test_hmap_rcu_register() {
+    atomic_size_t reclaimed = 0;
+    hmap_rcu_t r;
+    hmap_rcu_init(&r, NULL, hmap_rcu_count_reclaim, &reclaimed);
+
+    hmap_rcu_reader_t* readers[HMAP_RCU_MAX_READERS];
+    for (size_t i = 0; i < HMAP_RCU_MAX_READERS; i++) {
+        readers[i] = hmap_rcu_register(&r);
+        TEST_ASSERT(readers[i] != NULL);
+    }
+    TEST_ASSERT(hmap_rcu_register(&r) == NULL);
+
+    hmap_rcu_unregister(readers[5]);
+    TEST_ASSERT(hmap_rcu_register(&r) == readers[5]);
+
+    TEST_ASSERT(hmap_rcu_read_lock(&r, readers[0]) == NULL);
+    hmap_rcu_read_unlock(readers[0]);
+
+    hmap_rcu_destroy(&r);
+    TEST_ASSERT(reclaimed == 0);
+}
+
+typedef struct {
+    hmap_rcu_t* r;
+    atomic_bool* stop;
+    atomic_size_t* inconsistent;
+} hmap_rcu_reader_args_t;
+
+int hmap_rcu_read_loop(void* arg) {
+    hmap_rcu_reader_args_t* a = arg;
+    hmap_rcu_reader_t* reader = hmap_rcu_register(a->r);
+
+    while (!atomic_load(a->stop)) {
+        hmap_t* m = hmap_rcu_read_lock(a->r, reader);
+        size_t version = 0;
+        for (size_t key = 0; key < HMAP_RCU_KEYS; key++) {
+            hmap_rcu_entry_t* e = HMAP_GET(hmap_rcu_entry_t, m, &key);
+            if (e == NULL || (version != 0 && e->version != version)) {
+                atomic_fetch_add(a->inconsistent, 1);
+            }
+            version = e != NULL ? e->version : version;
+        }
+        hmap_rcu_read_unlock(reader);
+    }
+
+    hmap_rcu_unregister(reader);
+    return 0;
+}
+
+void test_hmap_rcu_concurrent_readers() {
+    atomic_size_t reclaimed = 0;
+    atomic_size_t inconsistent = 0;
+    atomic_bool stop = false;
+    hmap_rcu_t r;
+    hmap_rcu_init(&r, hmap_rcu_build_version(1), hmap_rcu_count_reclaim, &reclaimed);
+
+    hmap_rcu_reader_args_t args = {.r = &r, .stop = &stop, .inconsistent = &inconsistent};
+    thrd_t threads[4];
+    for (int t = 0; t < 4; t++) {
+        TEST_ASSERT(thrd_create(&threads[t], hmap_rcu_read_loop, &args) == thrd_success);
+    }
+
+    for (size_t version = 2; version <= 200; version++) {
+        hmap_rcu_publish(&r, hmap_rcu_build_version(version));
+    }
+
+    atomic_store(&stop, true);
+    for (int t = 0; t < 4; t++) {
+        thrd_join(threads[t], NULL);
+    }
+
+    hmap_rcu_synchronize(&r);
+    TEST_ASSERT(reclaimed == 199);
+    TEST_ASSERT(inconsistent == 0);
+
+    hmap_rcu_destroy(&r);
+}
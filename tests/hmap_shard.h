@@ -0,0 +1,159 @@
+#include <threads.h>
+
+#include "acutest.h"
+
+#include "src/hmap_shard.h"
+
+#define HMAP_SHARD_TESTS \
+    { "hmap sharded init", test_hmap_sharded_init }, \
+    { "hmap sharded set get delete", test_hmap_sharded_set_get_delete }, \
+    { "hmap sharded distribution", test_hmap_sharded_distribution }, \
+    { "hmap sharded foreach node", test_hmap_sharded_foreach_node }, \
+    { "hmap sharded concurrent", test_hmap_sharded_concurrent }
+
+void test_hmap_sharded_init() {
+    hmap_sharded_t s;
+    hmap_sharded_init(&s, hmap_hash_size_t, hmap_equals_size_t, 8);
+
+    TEST_ASSERT(hmap_sharded_nodes(&s) >= 1);
+    TEST_ASSERT(hmap_sharded_length(&s) == 0);
+    TEST_ASSERT(hmap_sharded_current_node() >= 0);
+
+    // shards are spread round robin
+    for (size_t i = 0; i < 8; i++) {
+        TEST_ASSERT(hmap_sharded_shard_node(&s, i) == (int)(i % hmap_sharded_nodes(&s)));
+        TEST_ASSERT(((uintptr_t)&s.shards[i]) % HMAP_CACHE_LINE_SIZE == 0);
+    }
+
+    hmap_sharded_destroy(&s);
+}
+
+void test_hmap_sharded_set_get_delete() {
+    size_t n = 1000;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 1);
+
+    hmap_sharded_t s;
+    hmap_sharded_init(&s, hmap_hash_size_t, hmap_equals_size_t, 4);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_sharded_set(&s, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_sharded_length(&s) == n);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_sharded_get(&s, &i) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+        TEST_ASSERT(hmap_sharded_key_node(&s, &i) == hmap_sharded_shard_node(&s, hmap_sharded_shard_of(&s, &i)));
+    }
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hmap_sharded_delete(&s, &i) == HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+    TEST_ASSERT(hmap_sharded_length(&s) == n / 2);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hmap_sharded_has(&s, &i) == (i % 2 == 1));
+    }
+
+    size_t key = 1;
+    hmap_t* m = hmap_sharded_lock(&s, &key);
+    TEST_ASSERT(hmapitem_in_map(HMAPITEM_OF(struct hmap_numbered, &entries[1]), m));
+    hmap_sharded_unlock(&s, &key);
+
+    hmap_sharded_destroy(&s);
+    free(entries);
+}
+
+void test_hmap_sharded_distribution() {
+    size_t n = 4096;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 1);
+
+    hmap_sharded_t s;
+    hmap_sharded_init(&s, hmap_hash_size_t, hmap_equals_size_t, 16);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_sharded_set(&s, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    // sequential keys must neither pile up in a few shards nor in a few slots of a shard
+    for (size_t i = 0; i < 16; i++) {
+        hmap_t* m = &s.shards[i].map;
+        TEST_ASSERT(hmap_length(m) > n / 16 / 2);
+        TEST_ASSERT(hmap_length(m) < n / 16 * 2);
+        TEST_ASSERT(hmap_stats_load_factor(m) <= .6);
+    }
+
+    hmap_sharded_destroy(&s);
+    free(entries);
+}
+
+void hmap_shard_count(void* key, hmapitem_t* item, void* userdata) {
+    ((void)key);
+    ((void)item);
+    (*(size_t*)userdata)++;
+}
+
+void test_hmap_sharded_foreach_node() {
+    size_t n = 500;
+    struct hmap_numbered* entries = hmap_numbered_range(n, 0, 1);
+
+    hmap_sharded_t s;
+    hmap_sharded_init(&s, hmap_hash_size_t, hmap_equals_size_t, 8);
+
+    for (size_t i = 0; i < n; i++) {
+        hmap_sharded_set(&s, &entries[i].number, HMAPITEM_OF(struct hmap_numbered, &entries[i]));
+    }
+
+    size_t count = 0;
+    for (size_t node = 0; node < hmap_sharded_nodes(&s); node++) {
+        hmap_sharded_foreach_node(&s, (int)node, hmap_shard_count, &count);
+    }
+    TEST_ASSERT(count == n);
+
+    hmap_sharded_destroy(&s);
+    free(entries);
+}
+
+typedef struct {
+    hmap_sharded_t* s;
+    struct hmap_numbered* entries;
+    size_t n;
+} hmap_shard_writer_args_t;
+
+int hmap_shard_write_loop(void* arg) {
+    hmap_shard_writer_args_t* a = arg;
+    for (size_t i = 0; i < a->n; i++) {
+        hmap_sharded_set(a->s, &a->entries[i].number, HMAPITEM_OF(struct hmap_numbered, &a->entries[i]));
+    }
+    for (size_t i = 0; i < a->n; i += 3) {
+        hmap_sharded_delete(a->s, &a->entries[i].number);
+    }
+    return 0;
+}
+
+void test_hmap_sharded_concurrent() {
+    size_t n = 3000;
+
+    hmap_sharded_t s;
+    hmap_sharded_init(&s, hmap_hash_size_t, hmap_equals_size_t, 8);
+
+    thrd_t threads[4];
+    hmap_shard_writer_args_t args[4];
+    for (int t = 0; t < 4; t++) {
+        args[t] = (hmap_shard_writer_args_t){.s = &s, .entries = hmap_numbered_range(n, t * n, 1), .n = n};
+        TEST_ASSERT(thrd_create(&threads[t], hmap_shard_write_loop, &args[t]) == thrd_success);
+    }
+
+    for (int t = 0; t < 4; t++) {
+        thrd_join(threads[t], NULL);
+    }
+
+    TEST_ASSERT(hmap_sharded_length(&s) == 4 * (n - n / 3));
+    for (int t = 0; t < 4; t++) {
+        for (size_t i = 0; i < n; i++) {
+            TEST_ASSERT(hmap_sharded_has(&s, &args[t].entries[i].number) == (i % 3 != 0));
+        }
+        free(args[t].entries);
+    }
+
+    hmap_sharded_destroy(&s);
+}
@@ -0,0 +1,466 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <threads.h>
+#include <unistd.h>
+
+#include "acutest.h"
+
+#include "src/hmap_wal.h"
+
+#define HMAP_WAL_TESTS \
+    { "hmap wal replay", test_hmap_wal_replay }, \
+    { "hmap wal last record wins", test_hmap_wal_last_record_wins }, \
+    { "hmap wal snapshot", test_hmap_wal_snapshot }, \
+    { "hmap wal snapshot threshold", test_hmap_wal_snapshot_threshold }, \
+    { "hmap wal snapshot crash before reset", test_hmap_wal_snapshot_crash_before_reset }, \
+    { "hmap wal decode failure", test_hmap_wal_decode_failure }, \
+    { "hmap wal torn tail", test_hmap_wal_torn_tail }, \
+    { "hmap wal group commit", test_hmap_wal_group_commit }
+
+typedef struct {
+    char key[32];
+    uint64_t value;
+    HMAPITEM_PROP();
+} hmap_wal_entry_t;
+
+size_t hmap_wal_test_hash(void* ptr) {
+    size_t hash = 5381;
+    for (char* c = ptr; *c != '\0'; c++) {
+        hash = hash * 33 + (size_t)*c;
+    }
+    return hash;
+}
+
+bool hmap_wal_test_equals(void* a, void* b) {
+    return strcmp(a, b) == 0;
+}
+
+size_t hmap_wal_test_key_bytes(void* key, const void** bytes) {
+    *bytes = key;
+    return strlen(key);
+}
+
+size_t hmap_wal_test_value_bytes(void* item, const void** bytes) {
+    *bytes = &HMAPITEM_AS(hmap_wal_entry_t, item)->value;
+    return sizeof(uint64_t);
+}
+
+hmapitem_t* hmap_wal_test_decode(const void* key, size_t key_length, const void* value, size_t value_length,
+                                 void** decoded_key, void* userdata) {
+    // called from the replay threads, acutest assertions are not thread safe
+    ((void)value_length);
+    ((void)userdata);
+
+    hmap_wal_entry_t* e = calloc(1, sizeof(hmap_wal_entry_t));
+    memcpy(e->key, key, key_length);
+    memcpy(&e->value, value, sizeof(uint64_t));
+    *decoded_key = e->key;
+    return HMAPITEM_OF(hmap_wal_entry_t, e);
+}
+
+hmap_wal_codec_t hmap_wal_test_codec = {hmap_wal_test_key_bytes, hmap_wal_test_value_bytes, hmap_wal_test_decode,
+                                        NULL};
+
+void hmap_wal_test_path(char* path) {
+    strcpy(path, "/tmp/hmap_wal_XXXXXX");
+    int fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    close(fd);
+    unlink(path);
+}
+
+void hmap_wal_test_remove(char* path) {
+    char snapshot[64];
+    sprintf(snapshot, "%s.snapshot", path);
+    unlink(path);
+    unlink(snapshot);
+}
+
+hmap_wal_entry_t* hmap_wal_test_entry(size_t i, uint64_t value) {
+    hmap_wal_entry_t* e = calloc(1, sizeof(hmap_wal_entry_t));
+    sprintf(e->key, "session-%zu", i);
+    e->value = value;
+    return e;
+}
+
+void hmap_wal_test_free(void* key, hmapitem_t* i, void* userdata) {
+    ((void)key);
+    ((void)userdata);
+    free(HMAPITEM_AS(hmap_wal_entry_t, i));
+}
+
+void hmap_wal_test_destroy(hmap_t* m) {
+    hmap_foreach(m, hmap_wal_test_free, NULL);
+    hmap_destroy(m);
+}
+
+/**
+ * Open the log at path into a fresh map and check that exactly the keys i < n with expected(i) != 0 are associated with
+ * expected(i).
+ */
+void hmap_wal_test_recover(char* path, size_t n, uint64_t (*expected)(size_t), size_t nthreads) {
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, nthreads) == 0);
+
+    size_t length = 0;
+    for (size_t i = 0; i < n; i++) {
+        char key[32];
+        sprintf(key, "session-%zu", i);
+        hmap_wal_entry_t* e = HMAP_GET(hmap_wal_entry_t, &m, key);
+        if (expected(i) == 0) {
+            TEST_ASSERT(e == NULL);
+        } else {
+            TEST_ASSERT(e != NULL && e->value == expected(i));
+            length++;
+        }
+    }
+    TEST_ASSERT(hmap_length(&m) == length);
+
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+}
+
+uint64_t hmap_wal_test_identity(size_t i) {
+    return i + 1;
+}
+
+void test_hmap_wal_replay() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+    TEST_ASSERT(hmap_wal_stats_replayed(&w) == 0);
+
+    size_t n = 5000;
+    for (size_t i = 0; i < n; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_commit(&w) == 0);
+    TEST_ASSERT(hmap_wal_stats_syncs(&w) == 1);
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, n, hmap_wal_test_identity, 1);
+    hmap_wal_test_recover(path, n, hmap_wal_test_identity, 4);
+    hmap_wal_test_remove(path);
+}
+
+uint64_t hmap_wal_test_last_wins(size_t i) {
+    return i % 3 == 0 ? 0 : i % 3 == 1 ? i + 1000 : i + 1;
+}
+
+void test_hmap_wal_last_record_wins() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+
+    // every third key is deleted, every third is overwritten, the overwritten items are freed right away
+    size_t n = 3000;
+    for (size_t i = 0; i < n; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    for (size_t i = 0; i < n; i++) {
+        char key[32];
+        sprintf(key, "session-%zu", i);
+        if (i % 3 == 0) {
+            free(HMAPITEM_AS(hmap_wal_entry_t, hmap_wal_delete(&w, key)));
+        } else if (i % 3 == 1) {
+            hmap_wal_entry_t* old = HMAPITEM_AS(hmap_wal_entry_t, hmap_wal_get(&w, key));
+            hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1000);
+            hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+            free(old);
+        }
+    }
+    TEST_ASSERT(hmap_wal_delete(&w, "missing") == NULL);
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, n, hmap_wal_test_last_wins, 3);
+    hmap_wal_test_remove(path);
+}
+
+uint64_t hmap_wal_test_after_snapshot(size_t i) {
+    return i < 100 ? i + 1 : i < 200 ? i + 2 : 0;
+}
+
+void test_hmap_wal_snapshot() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 2) == 0);
+
+    for (size_t i = 0; i < 100; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_commit(&w) == 0);
+    size_t log_bytes = hmap_wal_stats_log_bytes(&w);
+    TEST_ASSERT(log_bytes > 100 * sizeof(uint64_t));
+
+    TEST_ASSERT(hmap_wal_snapshot(&w) == 0);
+    TEST_ASSERT(hmap_wal_stats_log_bytes(&w) == sizeof(HMAP_WAL_MAGIC) - 1);
+
+    // mutations after the snapshot go to the log again
+    for (size_t i = 100; i < 200; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 2);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, 300, hmap_wal_test_after_snapshot, 2);
+    hmap_wal_test_remove(path);
+}
+
+void test_hmap_wal_snapshot_threshold() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+    hmap_wal_snapshot_threshold(&w, 4096);
+
+    // the same keys are set over and over, the log stays bounded
+    for (size_t round = 0; round < 50; round++) {
+        for (size_t i = 0; i < 10; i++) {
+            char key[32];
+            sprintf(key, "session-%zu", i);
+            hmap_wal_entry_t* old = HMAP_GET(hmap_wal_entry_t, &m, key);
+            hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+            hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+            free(old);
+        }
+        TEST_ASSERT(hmap_wal_commit(&w) == 0);
+        TEST_ASSERT(hmap_wal_stats_log_bytes(&w) <= 4096);
+    }
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, 10, hmap_wal_test_identity, 1);
+    hmap_wal_test_remove(path);
+}
+
+// set to a log path to let hmap_wal_test_capture_key_bytes copy the log file the next time it is called
+char* hmap_wal_test_capture_path = NULL;
+char* hmap_wal_test_captured = NULL;
+size_t hmap_wal_test_captured_length = 0;
+
+/**
+ * Key bytes of the snapshot codec: the snapshot is encoded after the buffered records are synced and before the log is
+ * reset, which makes it the place to capture the log a crash right after the rename would leave behind.
+ */
+size_t hmap_wal_test_capture_key_bytes(void* key, const void** bytes) {
+    if (hmap_wal_test_capture_path != NULL) {
+        TEST_ASSERT(hmap_wal_internal_read_file(hmap_wal_test_capture_path, &hmap_wal_test_captured,
+                                                &hmap_wal_test_captured_length) == 0);
+        hmap_wal_test_capture_path = NULL;
+    }
+    return hmap_wal_test_key_bytes(key, bytes);
+}
+
+uint64_t hmap_wal_test_before_reset(size_t i) {
+    return i % 4 == 0 || i >= 150 ? 0 : i < 50 ? i + 2 : i + 1;
+}
+
+void test_hmap_wal_snapshot_crash_before_reset() {
+    char path[32];
+    hmap_wal_test_path(path);
+    hmap_wal_codec_t codec = hmap_wal_test_codec;
+    codec.key_bytes = hmap_wal_test_capture_key_bytes;
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &codec, 1) == 0);
+
+    for (size_t i = 0; i < 100; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_commit(&w) == 0);
+
+    // buffered only: overwrite committed keys, delete committed keys and add new ones
+    for (size_t i = 0; i < 150; i++) {
+        char key[32];
+        sprintf(key, "session-%zu", i);
+        hmapitem_t* old = hmap_wal_get(&w, key);
+        if (i % 4 == 0) {
+            old = hmap_wal_delete(&w, key);
+        } else if (i < 50 || i >= 100) {
+            hmap_wal_entry_t* e = hmap_wal_test_entry(i, i < 50 ? i + 2 : i + 1);
+            hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+        } else {
+            old = NULL;
+        }
+        if (old != NULL) {
+            free(HMAPITEM_AS(hmap_wal_entry_t, old));
+        }
+    }
+
+    hmap_wal_test_capture_path = path;
+    TEST_ASSERT(hmap_wal_snapshot(&w) == 0);
+    TEST_ASSERT(hmap_wal_test_captured != NULL);
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    // the snapshot was renamed into place but the log was not reset yet
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    TEST_ASSERT(fd >= 0);
+    TEST_ASSERT(write(fd, hmap_wal_test_captured, hmap_wal_test_captured_length) ==
+                (ssize_t)hmap_wal_test_captured_length);
+    close(fd);
+    free(hmap_wal_test_captured);
+    hmap_wal_test_captured = NULL;
+
+    hmap_wal_test_recover(path, 200, hmap_wal_test_before_reset, 2);
+    hmap_wal_test_remove(path);
+}
+
+hmapitem_t* hmap_wal_test_decode_odd(const void* key, size_t key_length, const void* value, size_t value_length,
+                                     void** decoded_key, void* userdata) {
+    uint64_t v;
+    memcpy(&v, value, sizeof(uint64_t));
+    return v % 2 == 1 ? NULL : hmap_wal_test_decode(key, key_length, value, value_length, decoded_key, userdata);
+}
+
+void test_hmap_wal_decode_failure() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+    for (size_t i = 0; i < 100; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_codec_t codec = hmap_wal_test_codec;
+    codec.decode = hmap_wal_test_decode_odd;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    errno = 0;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &codec, 4) == -1);
+    TEST_ASSERT(errno == EINVAL);
+    TEST_ASSERT(hmap_length(&m) < 100);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_remove(path);
+}
+
+uint64_t hmap_wal_test_torn(size_t i) {
+    return i < 10 || i == 20 ? i + 1 : 0;
+}
+
+void test_hmap_wal_torn_tail() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+    for (size_t i = 0; i < 10; i++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(i, i + 1);
+        hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    }
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    // a crash in the middle of a write leaves the beginning of a record
+    struct stat st;
+    TEST_ASSERT(stat(path, &st) == 0);
+    int fd = open(path, O_WRONLY | O_APPEND);
+    char torn[20] = {1, 0, 0, 0, 7, 7, 7, 7, 10};
+    TEST_ASSERT(write(fd, torn, sizeof(torn)) == sizeof(torn));
+    close(fd);
+
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+    TEST_ASSERT(hmap_wal_stats_replayed(&w) == 10);
+    TEST_ASSERT(hmap_wal_stats_log_bytes(&w) == (size_t)st.st_size);
+
+    // new records follow the last complete one
+    hmap_wal_entry_t* e = hmap_wal_test_entry(20, 21);
+    hmap_wal_set(&w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, 30, hmap_wal_test_torn, 1);
+    hmap_wal_test_remove(path);
+}
+
+#define HMAP_WAL_TEST_THREADS 4
+#define HMAP_WAL_TEST_COMMITS 200
+
+typedef struct {
+    hmap_wal_t* w;
+    size_t id;
+} hmap_wal_test_committer_t;
+
+int hmap_wal_test_committer(void* arg) {
+    hmap_wal_test_committer_t* c = arg;
+    for (size_t k = 0; k < HMAP_WAL_TEST_COMMITS; k++) {
+        hmap_wal_entry_t* e = hmap_wal_test_entry(c->id * HMAP_WAL_TEST_COMMITS + k, 1);
+        hmap_wal_set(c->w, e->key, HMAPITEM_OF(hmap_wal_entry_t, e));
+        if (hmap_wal_commit(c->w) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint64_t hmap_wal_test_one(size_t i) {
+    ((void)i);
+    return 1;
+}
+
+void test_hmap_wal_group_commit() {
+    char path[32];
+    hmap_wal_test_path(path);
+
+    hmap_t m;
+    hmap_init(&m, hmap_wal_test_hash, hmap_wal_test_equals);
+    hmap_wal_t w;
+    TEST_ASSERT(hmap_wal_open(&w, &m, path, &hmap_wal_test_codec, 1) == 0);
+
+    thrd_t threads[HMAP_WAL_TEST_THREADS];
+    hmap_wal_test_committer_t committers[HMAP_WAL_TEST_THREADS];
+    for (size_t t = 0; t < HMAP_WAL_TEST_THREADS; t++) {
+        committers[t] = (hmap_wal_test_committer_t){&w, t};
+        TEST_ASSERT(thrd_create(&threads[t], hmap_wal_test_committer, &committers[t]) == thrd_success);
+    }
+    for (size_t t = 0; t < HMAP_WAL_TEST_THREADS; t++) {
+        int result;
+        thrd_join(threads[t], &result);
+        TEST_ASSERT(result == 0);
+    }
+
+    // every commit returned durable, but no more syncs than commits were needed
+    TEST_ASSERT(hmap_wal_stats_syncs(&w) <= HMAP_WAL_TEST_THREADS * HMAP_WAL_TEST_COMMITS);
+    TEST_MSG("syncs: %zu", hmap_wal_stats_syncs(&w));
+    TEST_ASSERT(hmap_wal_close(&w) == 0);
+    hmap_wal_test_destroy(&m);
+
+    hmap_wal_test_recover(path, HMAP_WAL_TEST_THREADS * HMAP_WAL_TEST_COMMITS, hmap_wal_test_one, 4);
+    hmap_wal_test_remove(path);
+}
@@ -0,0 +1,177 @@
+#include "acutest.h"
+
+#include "src/hset.h"
+
+#define HSET_TESTS \
+    { "hset init", test_hset_init }, \
+    { "hset add has delete", test_hset_add_has_delete }, \
+    { "hset add duplicate", test_hset_add_duplicate }, \
+    { "hset delete collisions", test_hset_delete_collisions }, \
+    { "hset full", test_hset_full }, \
+    { "hset managed capacity", test_hset_managed_capacity }, \
+    { "hset iter", test_hset_iter }
+
+size_t hset_hash_mod_4(void* ptr) {
+    return *(size_t*)ptr % 4;
+}
+
+size_t* hset_numbers(size_t n) {
+    size_t* numbers = malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++) {
+        numbers[i] = i;
+    }
+    return numbers;
+}
+
+void test_hset_init() {
+    hset_t s;
+    hset_init(&s, hmap_hash_size_t, hmap_equals_size_t);
+
+    TEST_ASSERT(hset_length(&s) == 0);
+    TEST_ASSERT(hset_capacity(&s) == HMAP_INITIAL_CAPACITY);
+
+    size_t key = 1;
+    TEST_ASSERT(!hset_has(&s, &key));
+    TEST_ASSERT(hset_delete(&s, &key) == NULL);
+
+    hset_destroy(&s);
+}
+
+void test_hset_add_has_delete() {
+    size_t n = 1000;
+    size_t* numbers = hset_numbers(n);
+
+    hset_t s;
+    hset_init(&s, hmap_hash_size_t, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hset_add(&s, &numbers[i]));
+    }
+    TEST_ASSERT(hset_length(&s) == n);
+
+    for (size_t i = 0; i < n; i += 2) {
+        TEST_ASSERT(hset_delete(&s, &i) == &numbers[i]);
+    }
+    TEST_ASSERT(hset_length(&s) == n / 2);
+
+    for (size_t i = 0; i < n + 10; i++) {
+        TEST_ASSERT(hset_has(&s, &i) == (i < n && i % 2 == 1));
+    }
+
+    hset_destroy(&s);
+    free(numbers);
+}
+
+void test_hset_add_duplicate() {
+    size_t a = 7, b = 7;
+
+    hset_t s;
+    hset_init(&s, hmap_hash_size_t, hmap_equals_size_t);
+
+    TEST_ASSERT(hset_add(&s, &a));
+    TEST_ASSERT(!hset_add(&s, &b));
+    TEST_ASSERT(hset_length(&s) == 1);
+
+    // the first key is kept, which makes the set usable for interning
+    TEST_ASSERT(hset_get(&s, &b) == &a);
+
+    hset_destroy(&s);
+}
+
+void test_hset_delete_collisions() {
+    size_t n = 12;
+    size_t* numbers = hset_numbers(n);
+
+    // every hash collides with two other keys and the probe sequences wrap around the end of the table
+    hset_t s;
+    hset_init_unmanaged(&s, hset_hash_mod_4, hmap_equals_size_t, 13);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hset_add(&s, &numbers[i]));
+    }
+
+    for (size_t first = 0; first < n; first++) {
+        TEST_ASSERT(hset_delete(&s, &numbers[first]) == &numbers[first]);
+        for (size_t i = 0; i < n; i++) {
+            TEST_ASSERT(hset_has(&s, &i) == (i != first));
+        }
+        TEST_ASSERT(hset_add(&s, &numbers[first]));
+    }
+
+    hset_destroy(&s);
+    free(numbers);
+}
+
+void test_hset_full() {
+    size_t n = 8;
+    size_t* numbers = hset_numbers(n + 1);
+
+    hset_t s;
+    hset_init_unmanaged(&s, hset_hash_mod_4, hmap_equals_size_t, n);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hset_add(&s, &numbers[i]));
+    }
+    TEST_ASSERT(hset_length(&s) == hset_capacity(&s));
+
+    // probing for an absent key stops after one cycle through the full table
+    TEST_ASSERT(!hset_has(&s, &numbers[n]));
+    TEST_ASSERT(hset_get(&s, &numbers[n]) == NULL);
+    TEST_ASSERT(hset_delete(&s, &numbers[n]) == NULL);
+    TEST_ASSERT(!hset_add(&s, &numbers[n]));
+    TEST_ASSERT(hset_length(&s) == n);
+
+    TEST_ASSERT(hset_delete(&s, &numbers[3]) == &numbers[3]);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT(hset_has(&s, &i) == (i != 3));
+    }
+    TEST_ASSERT(hset_add(&s, &numbers[n]));
+    TEST_ASSERT(hset_has(&s, &numbers[n]));
+
+    hset_destroy(&s);
+    free(numbers);
+}
+
+void test_hset_managed_capacity() {
+    size_t n = 100;
+    size_t* numbers = hset_numbers(n);
+
+    hset_t s;
+    hset_init(&s, hmap_hash_size_t, hmap_equals_size_t);
+
+    for (size_t i = 0; i < n; i++) {
+        hset_add(&s, &numbers[i]);
+        TEST_ASSERT(hset_stats_load_factor(&s) <= s.managed_max_load);
+    }
+    size_t grown = hset_capacity(&s);
+    TEST_ASSERT(grown > HMAP_INITIAL_CAPACITY);
+
+    for (size_t i = 0; i < n; i++) {
+        hset_delete(&s, &numbers[i]);
+    }
+    TEST_ASSERT(hset_capacity(&s) == HMAP_INITIAL_CAPACITY);
+
+    hset_destroy(&s);
+    free(numbers);
+}
+
+void test_hset_iter() {
+    size_t n = 50;
+    size_t* numbers = hset_numbers(n);
+
+    hset_t s;
+    hset_init(&s, hmap_hash_size_t, hmap_equals_size_t);
+    for (size_t i = 0; i < n; i++) {
+        hset_add(&s, &numbers[i]);
+    }
+
+    size_t sum = 0;
+    HSET_ITER(entry, &s) {
+        if (*entry != NULL) {
+            sum += *(size_t*)*entry;
+        }
+    }
+    TEST_ASSERT(sum == n * (n - 1) / 2);
+
+    hset_destroy(&s);
+    free(numbers);
+}
@@ -0,0 +1,309 @@
+#include "acutest.h"
+
+#include "src/ilist.h"
+
+#define ILIST_TESTS \
+    { "ilist push pop", test_ilist_push_pop }, \
+    { "ilist unshift shift", test_ilist_unshift_shift }, \
+    { "ilist get", test_ilist_get }, \
+    { "ilist insert at", test_ilist_insert_at }, \
+    { "ilist remove index", test_ilist_remove_index }, \
+    { "ilist index of", test_ilist_index_of }, \
+    { "ilist list iter", test_ilist_list_iter }, \
+    { "ilist random operations", test_ilist_random_operations }
+
+typedef struct {
+    int x;
+    ILISTITEM_PROP();
+} ilist_item_t;
+
+/**
+ * Check the chain against the expected values and the treap invariants of all indexed items.
+ */
+void ilist_check(ilist_t* il, int* expected, LIST_LENGTH_TYPE length) {
+    TEST_ASSERT(ilist_length(il) == length);
+
+    LIST_LENGTH_TYPE index = 0;
+    LIST_LENGTH_TYPE indexed = 0;
+    ILIST_ITER(elem, il) {
+        TEST_ASSERT(index < length);
+        TEST_ASSERT(ILISTITEM_AS(ilist_item_t, elem)->x == expected[index]);
+        index++;
+
+        if (elem->state != ILIST_INDEXED) {
+            continue;
+        }
+        indexed++;
+        TEST_ASSERT(elem->size == 1 + ilist_internal_size(elem->left) + ilist_internal_size(elem->right));
+        TEST_ASSERT(elem->parent == NULL || elem->parent->priority >= elem->priority);
+        TEST_ASSERT(elem->parent != NULL || il->root == elem);
+    }
+    TEST_ASSERT(index == length);
+    TEST_ASSERT(ilist_internal_size(il->root) == indexed);
+    TEST_ASSERT(il->head_pending + il->tail_pending + indexed == length);
+}
+
+/**
+ * Initialize n items with x = 0..n-1.
+ */
+ilist_item_t* ilist_items(LIST_LENGTH_TYPE n) {
+    ilist_item_t* items = malloc(n * sizeof(ilist_item_t));
+    for (LIST_LENGTH_TYPE i = 0; i < n; i++) {
+        ilistitem_init(ILISTITEM_OF(ilist_item_t, &items[i]));
+        items[i].x = i;
+    }
+    return items;
+}
+
+void test_ilist_push_pop() {
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(3);
+
+    for (int i = 0; i < 3; i++) {
+        ilist_push(&il, ILISTITEM_OF(ilist_item_t, &items[i]));
+    }
+    int expected[] = {0, 1, 2};
+    ilist_check(&il, expected, 3);
+
+    TEST_ASSERT(ilist_pop(&il) == ILISTITEM_OF(ilist_item_t, &items[2]));
+    TEST_ASSERT(ilist_get(&il, 1) == ILISTITEM_OF(ilist_item_t, &items[1]));
+    TEST_ASSERT(ilist_pop(&il) == ILISTITEM_OF(ilist_item_t, &items[1]));
+    TEST_ASSERT(ilist_pop(&il) == ILISTITEM_OF(ilist_item_t, &items[0]));
+    TEST_ASSERT(ilist_pop(&il) == NULL);
+    ilist_check(&il, expected, 0);
+    TEST_ASSERT(il.root == NULL);
+    TEST_ASSERT(!ilistitem_in_list(ILISTITEM_OF(ilist_item_t, &items[0])));
+
+    free(items);
+}
+
+void test_ilist_unshift_shift() {
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(3);
+
+    for (int i = 0; i < 3; i++) {
+        ilist_unshift(&il, ILISTITEM_OF(ilist_item_t, &items[i]));
+    }
+    int expected[] = {2, 1, 0};
+    ilist_check(&il, expected, 3);
+
+    TEST_ASSERT(ilist_shift(&il) == ILISTITEM_OF(ilist_item_t, &items[2]));
+    TEST_ASSERT(ilist_index_of(&il, ILISTITEM_OF(ilist_item_t, &items[0])) == 1);
+    TEST_ASSERT(ilist_shift(&il) == ILISTITEM_OF(ilist_item_t, &items[1]));
+    TEST_ASSERT(ilist_shift(&il) == ILISTITEM_OF(ilist_item_t, &items[0]));
+    TEST_ASSERT(ilist_shift(&il) == NULL);
+    TEST_ASSERT(il.root == NULL);
+
+    free(items);
+}
+
+void test_ilist_get() {
+    LIST_LENGTH_TYPE n = 1000;
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(n);
+
+    // grow the list from the middle towards both ends
+    for (LIST_LENGTH_TYPE i = 0; i < n / 2; i++) {
+        ilist_push(&il, ILISTITEM_OF(ilist_item_t, &items[n / 2 + i]));
+        ilist_unshift(&il, ILISTITEM_OF(ilist_item_t, &items[n / 2 - 1 - i]));
+    }
+
+    for (LIST_LENGTH_TYPE i = 0; i < n; i++) {
+        TEST_ASSERT(ILIST_GET(ilist_item_t, &il, i) == &items[i]);
+    }
+    TEST_ASSERT(ilist_get(&il, n) == NULL);
+    TEST_ASSERT(ILIST_GET(ilist_item_t, &il, n) == NULL);
+    TEST_ASSERT(il.head_pending == 0 && il.tail_pending == 0);
+
+    // pending items on both sides of the index
+    ilist_item_t* more = ilist_items(2);
+    ilist_unshift(&il, ILISTITEM_OF(ilist_item_t, &more[0]));
+    ilist_push(&il, ILISTITEM_OF(ilist_item_t, &more[1]));
+    TEST_ASSERT(ILIST_GET(ilist_item_t, &il, 0) == &more[0]);
+    TEST_ASSERT(ILIST_GET(ilist_item_t, &il, 1) == &items[0]);
+    TEST_ASSERT(ILIST_GET(ilist_item_t, &il, n) == &items[n - 1]);
+    TEST_ASSERT(ILIST_GET(ilist_item_t, &il, n + 1) == &more[1]);
+
+    free(more);
+    free(items);
+}
+
+void test_ilist_insert_at() {
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(6);
+
+    ilist_insert_at(&il, 0, ILISTITEM_OF(ilist_item_t, &items[0]));
+    ilist_insert_at(&il, 1, ILISTITEM_OF(ilist_item_t, &items[1]));
+    ilist_insert_at(&il, 1, ILISTITEM_OF(ilist_item_t, &items[2]));
+    ilist_insert_at(&il, 0, ILISTITEM_OF(ilist_item_t, &items[3]));
+    ilist_insert_at(&il, 2, ILISTITEM_OF(ilist_item_t, &items[4]));
+    ilist_insert_at(&il, 5, ILISTITEM_OF(ilist_item_t, &items[5]));
+
+    int expected[] = {3, 0, 4, 2, 1, 5};
+    ilist_check(&il, expected, 6);
+
+    LIST_LENGTH_TYPE index = 0;
+    LIST_ITER(elem, il.list.first) {
+        TEST_ASSERT(ILISTITEM_AS(ilist_item_t, elem)->x == expected[index++]);
+    }
+
+    free(items);
+}
+
+void test_ilist_remove_index() {
+    LIST_LENGTH_TYPE n = 100;
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(n);
+
+    for (LIST_LENGTH_TYPE i = 0; i < n; i++) {
+        ilist_push(&il, ILISTITEM_OF(ilist_item_t, &items[i]));
+    }
+
+    // remove every second item
+    for (LIST_LENGTH_TYPE i = 0; i < n / 2; i++) {
+        TEST_ASSERT(ilist_remove_index(&il, i) == ILISTITEM_OF(ilist_item_t, &items[2 * i]));
+    }
+    TEST_ASSERT(ilist_remove_index(&il, n / 2) == NULL);
+
+    int expected[50];
+    for (LIST_LENGTH_TYPE i = 0; i < n / 2; i++) {
+        expected[i] = 2 * i + 1;
+    }
+    ilist_check(&il, expected, n / 2);
+
+    while (ilist_length(&il) > 0) {
+        ilist_remove_index(&il, ilist_length(&il) / 2);
+    }
+    TEST_ASSERT(il.root == NULL);
+    TEST_ASSERT(il.list.first == NULL && il.list.last == NULL);
+
+    free(items);
+}
+
+void test_ilist_index_of() {
+    LIST_LENGTH_TYPE n = 1000;
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(n);
+
+    for (LIST_LENGTH_TYPE i = 0; i < n; i++) {
+        ilist_push(&il, ILISTITEM_OF(ilist_item_t, &items[i]));
+    }
+    for (LIST_LENGTH_TYPE i = 0; i < n; i++) {
+        TEST_ASSERT(ilist_index_of(&il, ILISTITEM_OF(ilist_item_t, &items[i])) == i);
+    }
+
+    ilistitem_unlink(ILISTITEM_OF(ilist_item_t, &items[0]));
+    TEST_ASSERT(ilist_index_of(&il, ILISTITEM_OF(ilist_item_t, &items[n - 1])) == n - 2);
+
+    free(items);
+}
+
+void test_ilist_list_iter() {
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(10);
+
+    for (int i = 0; i < 10; i++) {
+        ilist_push(&il, ILISTITEM_OF(ilist_item_t, &items[i]));
+    }
+    ilist_get(&il, 5);
+
+    int x = 0;
+    LIST_ITER(elem, il.list.first) {
+        TEST_ASSERT(ILISTITEM_AS(ilist_item_t, (ilistitem_t*)elem)->x == x++);
+    }
+    TEST_ASSERT(x == 10);
+    LIST_ITER_REVERSE(elem, il.list.last) {
+        TEST_ASSERT(ILISTITEM_AS(ilist_item_t, (ilistitem_t*)elem)->x == --x);
+    }
+    TEST_ASSERT(x == 0);
+
+    free(items);
+}
+
+void test_ilist_random_operations() {
+    LIST_LENGTH_TYPE n = 2000;
+    ilist_t il;
+    ilist_init(&il);
+    ilist_item_t* items = ilist_items(n);
+    int* expected = malloc(n * sizeof(int));
+    LIST_LENGTH_TYPE length = 0;
+
+    srand(7);
+    for (int round = 0; round < 20000; round++) {
+        int op = rand() % 7;
+        if (length == n) {
+            op = 4 + op % 3;
+        }
+
+        // items are reused, every item not in the list is found by scanning
+        ilist_item_t* free_item = NULL;
+        if (op < 4) {
+            for (LIST_LENGTH_TYPE i = rand() % n; free_item == NULL; i = (i + 1) % n) {
+                if (!ilistitem_in_list(ILISTITEM_OF(ilist_item_t, &items[i]))) {
+                    free_item = &items[i];
+                }
+            }
+        }
+
+        LIST_LENGTH_TYPE index = length > 0 ? rand() % length : 0;
+        switch (op) {
+        case 0:
+            ilist_push(&il, ILISTITEM_OF(ilist_item_t, free_item));
+            expected[length++] = free_item->x;
+            break;
+        case 1:
+            ilist_unshift(&il, ILISTITEM_OF(ilist_item_t, free_item));
+            memmove(&expected[1], &expected[0], length * sizeof(int));
+            expected[0] = free_item->x;
+            length++;
+            break;
+        case 2:
+        case 3:
+            index = rand() % (length + 1);
+            ilist_insert_at(&il, index, ILISTITEM_OF(ilist_item_t, free_item));
+            memmove(&expected[index + 1], &expected[index], (length - index) * sizeof(int));
+            expected[index] = free_item->x;
+            length++;
+            break;
+        case 4:
+            if (length > 0) {
+                TEST_ASSERT(ILISTITEM_AS(ilist_item_t, ilist_pop(&il))->x == expected[--length]);
+            }
+            break;
+        case 5:
+            if (length > 0) {
+                TEST_ASSERT(ILISTITEM_AS(ilist_item_t, ilist_shift(&il))->x == expected[0]);
+                memmove(&expected[0], &expected[1], --length * sizeof(int));
+            }
+            break;
+        case 6:
+            if (length > 0) {
+                ilistitem_t* i = ilist_remove_index(&il, index);
+                TEST_ASSERT(ILISTITEM_AS(ilist_item_t, i)->x == expected[index]);
+                memmove(&expected[index], &expected[index + 1], (length - index - 1) * sizeof(int));
+                length--;
+            }
+            break;
+        }
+
+        if (length > 0 && round % 10 == 0) {
+            index = rand() % length;
+            TEST_ASSERT(ILIST_GET(ilist_item_t, &il, index)->x == expected[index]);
+            TEST_ASSERT(ilist_index_of(&il, ilist_get(&il, index)) == index);
+        }
+        if (round % 1000 == 0) {
+            ilist_check(&il, expected, length);
+        }
+    }
+    ilist_check(&il, expected, length);
+
+    free(expected);
+    free(items);
+}
@@ -3,12 +3,30 @@
 #define IMPL_LIST
 #include "src/list.h"
 
+#include "tests/list_items.h"
+
 #define LIST_TESTS \
     { "list length", test_list_length }, \
     { "list push", test_list_push }, \
     { "list pop", test_list_pop }, \
     { "list unshift", test_list_unshift }, \
     { "list insert sorted", test_list_insert_sorted }, \
+    { "list sort", test_list_sort }, \
+    { "list sort stable", test_list_sort_stable }, \
+    { "list merge sorted", test_list_merge_sorted }, \
+    { "list sort parallel", test_list_sort_parallel }, \
+    { "list sort parallel skewed", test_list_sort_parallel_skewed }, \
+    { "list splice", test_list_splice }, \
+    { "list concat", test_list_concat }, \
+    { "list split at", test_list_split_at }, \
+    { "list move range", test_list_move_range }, \
+    { "list restamp", test_list_restamp }, \
+    { "list insert before", test_list_insert_before }, \
+    { "list unlink", test_list_unlink }, \
+    { "list iter prefetch", test_list_iter_prefetch }, \
+    { "list foreach prefetch", test_list_foreach_prefetch }, \
+    { "list pool", test_list_pool }, \
+    { "list defragment", test_list_defragment }, \
     { "list shift", test_list_shift }, \
     { "list get", test_list_get }, \
     { "list remove index", test_list_remove_index }, \
@@ -46,11 +64,6 @@ typedef struct {
       LISTITEM_PROP();
 } item_at_end_t;
 
-typedef struct {
-    int x;
-      LISTITEM_PROP();
-} item_t;
-
 typedef struct {
     char name[32];
     unsigned char age;
@@ -551,3 +564,471 @@ void test_listitem_unlink() {
 
 }
 
+
+typedef struct {
+    int key;
+    int order;
+    LISTITEM_PROP();
+} sort_item_t;
+
+bool cmp_sort_item(listitem_t* i, listitem_t* j) {
+    return LISTITEM_AS(sort_item_t, i)->key < LISTITEM_AS(sort_item_t, j)->key;
+}
+
+/**
+ * Check the forward and backward chain of a list sorted by key, equal keys must be in insertion order.
+ */
+void check_sorted(list_t* l, LIST_LENGTH_TYPE length) {
+    TEST_ASSERT(list_length(l) == length);
+
+    LIST_LENGTH_TYPE count = 0;
+    listitem_t* prev = NULL;
+    LIST_ITER(elem, l->first) {
+        TEST_ASSERT(elem->prev == prev);
+        TEST_ASSERT(elem->list_ptr == l);
+        if (prev != NULL) {
+            sort_item_t* a = LISTITEM_AS(sort_item_t, prev);
+            sort_item_t* b = LISTITEM_AS(sort_item_t, elem);
+            TEST_ASSERT(a->key < b->key || (a->key == b->key && a->order < b->order));
+        }
+        prev = elem;
+        count++;
+    }
+    TEST_ASSERT(l->last == prev);
+    TEST_ASSERT(count == length);
+}
+
+void test_list_sort() {
+    item_t ZERO(a), ZERO(b), ZERO(c), ZERO(d);
+    a.x = 1;
+    b.x = 2;
+    c.x = 3;
+    d.x = 4;
+    list_t l;
+    list_init(&l);
+
+    list_sort(&l, cmp_int);
+    TEST_ASSERT(l.first == NULL);
+
+    list_push(&l, LISTITEM_OF(item_t, &c));
+    list_sort(&l, cmp_int);
+    TEST_ASSERT(l.first == LISTITEM_OF(item_t, &c) && l.last == LISTITEM_OF(item_t, &c));
+
+    list_push(&l, LISTITEM_OF(item_t, &a));
+    list_push(&l, LISTITEM_OF(item_t, &d));
+    list_push(&l, LISTITEM_OF(item_t, &b));
+    list_sort(&l, cmp_int);
+
+    TEST_ASSERT(list_length(&l) == 4);
+    TEST_ASSERT(l.first == LISTITEM_OF(item_t, &a));
+    TEST_ASSERT(l.first->prev == NULL);
+    TEST_ASSERT(l.first->next == LISTITEM_OF(item_t, &b));
+    TEST_ASSERT(l.first->next->next == LISTITEM_OF(item_t, &c));
+    TEST_ASSERT(l.first->next->next->next == LISTITEM_OF(item_t, &d));
+    TEST_ASSERT(l.last == LISTITEM_OF(item_t, &d));
+    TEST_ASSERT(l.last->next == NULL);
+    TEST_ASSERT(l.last->prev == LISTITEM_OF(item_t, &c));
+    TEST_ASSERT(l.last->prev->prev == LISTITEM_OF(item_t, &b));
+    TEST_ASSERT(l.last->prev->prev->prev == LISTITEM_OF(item_t, &a));
+}
+
+void test_list_sort_stable() {
+    int n = 100003;
+    sort_item_t* items = calloc(n, sizeof(sort_item_t));
+    list_t l;
+    list_init(&l);
+
+    srand(42);
+    for (int i = 0; i < n; i++) {
+        items[i].key = rand() % 1000;
+        items[i].order = i;
+        list_push(&l, LISTITEM_OF(sort_item_t, &items[i]));
+    }
+
+    list_sort(&l, cmp_sort_item);
+    check_sorted(&l, n);
+
+    // sorting a sorted list keeps it unchanged
+    list_sort(&l, cmp_sort_item);
+    check_sorted(&l, n);
+
+    free(items);
+}
+
+void test_list_merge_sorted() {
+    int n = 1000;
+    sort_item_t* items = calloc(2 * n, sizeof(sort_item_t));
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    // the items of a have the lower order and must stay before equal items of b
+    for (int i = 0; i < n; i++) {
+        items[i].key = i / 3;
+        items[i].order = i;
+        list_push(&a, LISTITEM_OF(sort_item_t, &items[i]));
+        items[n + i].key = i / 2;
+        items[n + i].order = n + i;
+        list_push(&b, LISTITEM_OF(sort_item_t, &items[n + i]));
+    }
+
+    list_merge_sorted(&a, &b, cmp_sort_item);
+    check_sorted(&a, 2 * n);
+    TEST_ASSERT(list_length(&b) == 0);
+    TEST_ASSERT(b.first == NULL && b.last == NULL);
+
+    // merging into an empty list
+    list_merge_sorted(&b, &a, cmp_sort_item);
+    check_sorted(&b, 2 * n);
+    TEST_ASSERT(list_length(&a) == 0);
+
+    free(items);
+}
+
+void test_list_splice() {
+    item_t items[8];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    // into the middle
+    push_items(&a, items, 0, 3);
+    push_items(&b, items, 3, 5);
+    list_splice(&a, LISTITEM_OF(item_t, &items[1]), &b);
+    check_chain(&a, (int[]){0, 3, 4, 1, 2}, 5);
+    check_chain(&b, NULL, 0);
+
+    // in front of the first item
+    push_items(&b, items, 5, 6);
+    list_splice(&a, a.first, &b);
+    check_chain(&a, (int[]){5, 0, 3, 4, 1, 2}, 6);
+
+    // to the end
+    push_items(&b, items, 6, 8);
+    list_splice(&a, NULL, &b);
+    check_chain(&a, (int[]){5, 0, 3, 4, 1, 2, 6, 7}, 8);
+
+    // empty source and empty destination
+    list_splice(&a, a.first, &b);
+    check_chain(&a, (int[]){5, 0, 3, 4, 1, 2, 6, 7}, 8);
+    list_splice(&b, NULL, &a);
+    check_chain(&b, (int[]){5, 0, 3, 4, 1, 2, 6, 7}, 8);
+    check_chain(&a, NULL, 0);
+}
+
+void test_list_concat() {
+    item_t items[4];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    push_items(&a, items, 0, 2);
+    push_items(&b, items, 2, 4);
+    list_concat(&a, &b);
+    check_chain(&a, (int[]){0, 1, 2, 3}, 4);
+    check_chain(&b, NULL, 0);
+
+    listitem_unlink(LISTITEM_OF(item_t, &items[3]));
+    check_chain(&a, (int[]){0, 1, 2}, 3);
+}
+
+void test_list_split_at() {
+    item_t items[6];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    push_items(&a, items, 0, 4);
+    push_items(&b, items, 4, 6);
+    list_split_at(&a, LISTITEM_OF(item_t, &items[2]), &b);
+    check_chain(&a, (int[]){0, 1}, 2);
+    check_chain(&b, (int[]){4, 5, 2, 3}, 4);
+
+    // at the first item
+    list_split_at(&b, b.first, &a);
+    check_chain(&a, (int[]){0, 1, 4, 5, 2, 3}, 6);
+    check_chain(&b, NULL, 0);
+
+    // at the last item
+    list_split_at(&a, a.last, &b);
+    check_chain(&a, (int[]){0, 1, 4, 5, 2}, 5);
+    check_chain(&b, (int[]){3}, 1);
+}
+
+void test_list_move_range() {
+    item_t items[8];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    push_items(&a, items, 0, 6);
+    push_items(&b, items, 6, 8);
+
+    // between lists
+    list_move_range(&a, LISTITEM_OF(item_t, &items[1]), LISTITEM_OF(item_t, &items[3]), &b,
+                    LISTITEM_OF(item_t, &items[7]));
+    check_chain(&a, (int[]){0, 4, 5}, 3);
+    check_chain(&b, (int[]){6, 1, 2, 3, 7}, 5);
+
+    // within the same list, to the front and to the end
+    list_move_range(&b, LISTITEM_OF(item_t, &items[2]), LISTITEM_OF(item_t, &items[3]), &b, b.first);
+    check_chain(&b, (int[]){2, 3, 6, 1, 7}, 5);
+    list_move_range(&b, LISTITEM_OF(item_t, &items[2]), LISTITEM_OF(item_t, &items[2]), &b, NULL);
+    check_chain(&b, (int[]){3, 6, 1, 7, 2}, 5);
+
+    // a whole list
+    list_move_range(&a, a.first, a.last, &b, LISTITEM_OF(item_t, &items[1]));
+    check_chain(&a, NULL, 0);
+    check_chain(&b, (int[]){3, 6, 0, 4, 5, 1, 7, 2}, 8);
+}
+
+void test_list_restamp() {
+    item_t items[3];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+
+    // simulate a concat without restamping
+    push_items(&a, items, 0, 3);
+    LIST_ITER(elem, a.first) { elem->list_ptr = &b; }
+
+    list_restamp(&a);
+    check_chain(&a, (int[]){0, 1, 2}, 3);
+}
+
+void test_list_insert_before() {
+    item_t items[4];
+    list_t l;
+    list_init(&l);
+
+    for (int i = 0; i < 4; i++) {
+        listitem_init(LISTITEM_OF(item_t, &items[i]));
+        items[i].x = i;
+    }
+
+    list_insert_before(&l, NULL, LISTITEM_OF(item_t, &items[0]));
+    list_insert_before(&l, l.first, LISTITEM_OF(item_t, &items[1]));
+    list_insert_before(&l, LISTITEM_OF(item_t, &items[0]), LISTITEM_OF(item_t, &items[2]));
+    list_insert_before(&l, NULL, LISTITEM_OF(item_t, &items[3]));
+    check_chain(&l, (int[]){1, 2, 0, 3}, 4);
+}
+
+void test_list_unlink() {
+    item_t items[4];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 4);
+
+    list_unlink(&l, LISTITEM_OF(item_t, &items[1]));
+    TEST_ASSERT(!listitem_in_list(LISTITEM_OF(item_t, &items[1])));
+    check_chain(&l, (int[]){0, 2, 3}, 3);
+    list_unlink(&l, LISTITEM_OF(item_t, &items[0]));
+    list_unlink(&l, LISTITEM_OF(item_t, &items[3]));
+    check_chain(&l, (int[]){2}, 1);
+    list_unlink(&l, LISTITEM_OF(item_t, &items[2]));
+    check_chain(&l, NULL, 0);
+}
+
+void test_list_iter_prefetch() {
+    item_t items[2 * LIST_PREFETCH_DISTANCE + 1];
+
+    // shorter and longer than the prefetch distance
+    for (int n = 0; n <= 2 * LIST_PREFETCH_DISTANCE + 1; n++) {
+        list_t l;
+        list_init(&l);
+        push_items(&l, items, 0, n);
+
+        // the cursor running ahead is LIST_PREFETCH_DISTANCE items ahead or NULL behind the end of the list
+        int x = 0;
+        LIST_ITER_PREFETCH(elem, l.first) {
+            int ahead = x + LIST_PREFETCH_DISTANCE;
+            TEST_ASSERT(elem_ahead == (ahead < n ? LISTITEM_OF(item_t, &items[ahead]) : NULL));
+            TEST_ASSERT(LISTITEM_AS(item_t, elem)->x == x++);
+        }
+        TEST_ASSERT(x == n);
+
+        x = 0;
+        LIST_ITER_PREFETCH_DATA(elem, l.first, LISTITEM_OFFSET(item_t)) {
+            int ahead = x + LIST_PREFETCH_DISTANCE;
+            TEST_ASSERT(elem_ahead == (ahead < n ? LISTITEM_OF(item_t, &items[ahead]) : NULL));
+            TEST_ASSERT(LISTITEM_AS(item_t, elem)->x == x++);
+        }
+        TEST_ASSERT(x == n);
+    }
+}
+
+void sum_x(listitem_t* i, void* userdata) {
+    *(int*)userdata += LISTITEM_AS(item_t, i)->x;
+}
+
+void test_list_foreach_prefetch() {
+    item_t items[100];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 100);
+
+    int sum = 0;
+    list_foreach_prefetch(&l, sum_x, &sum, LISTITEM_OFFSET(item_t));
+    TEST_ASSERT(sum == 99 * 100 / 2);
+}
+
+void test_list_pool() {
+    item_t memory[4];
+    list_pool_t pool;
+    list_pool_init(&pool, memory, 4, sizeof(item_t), LISTITEM_OFFSET(item_t));
+
+    for (int i = 0; i < 4; i++) {
+        item_t* it = list_pool_alloc(&pool);
+        TEST_ASSERT(it == &memory[i]);
+        TEST_ASSERT(list_pool_contains(&pool, it));
+    }
+    TEST_ASSERT(list_pool_alloc(&pool) == NULL);
+    TEST_ASSERT(!list_pool_contains(&pool, (char*)&memory[1] + 1));
+
+    list_pool_reset(&pool);
+    TEST_ASSERT(!list_pool_contains(&pool, &memory[0]));
+    TEST_ASSERT(list_pool_alloc(&pool) == &memory[0]);
+}
+
+/**
+ * Records the new address of every relocated item in the slot given by its x.
+ */
+void record_relocation(void* old, void* new, void* userdata) {
+    item_t** moved = userdata;
+    TEST_ASSERT(((item_t*)old)->x == ((item_t*)new)->x);
+    moved[((item_t*)new)->x] = new;
+}
+
+void test_list_defragment() {
+    int n = 100;
+    item_t* from = calloc(n, sizeof(item_t));
+    item_t* to = calloc(n, sizeof(item_t));
+    item_t* moved[100] = {0};
+    list_pool_t a, b;
+    list_pool_init(&a, from, n, sizeof(item_t), LISTITEM_OFFSET(item_t));
+    list_pool_init(&b, to, n, sizeof(item_t), LISTITEM_OFFSET(item_t));
+
+    // link the objects in an order unrelated to their addresses
+    list_t l;
+    list_init(&l);
+    for (int i = 0; i < n; i++) {
+        item_t* it = list_pool_alloc(&a);
+        it->x = (i * 37) % n;
+        listitem_init(LISTITEM_OF(item_t, it));
+    }
+    for (int x = 0; x < n; x++) {
+        list_push(&l, LISTITEM_OF(item_t, &from[(x * 73) % n]));
+    }
+    int order[100];
+    int k = 0;
+    LIST_ITER(elem, l.first) { order[k++] = LISTITEM_AS(item_t, elem)->x; }
+
+    // not enough free slots
+    list_pool_t small;
+    list_pool_init(&small, to, n - 1, sizeof(item_t), LISTITEM_OFFSET(item_t));
+    TEST_ASSERT(!list_defragment(&l, &small, record_relocation, moved));
+    TEST_ASSERT(small.used == 0);
+    TEST_ASSERT(list_pool_contains(&a, LISTITEM_AS(item_t, l.first)));
+
+    TEST_ASSERT(list_defragment(&l, &b, record_relocation, moved));
+    TEST_ASSERT(b.used == (size_t)n);
+    TEST_ASSERT(list_length(&l) == (LIST_LENGTH_TYPE)n);
+
+    // the list order is the address order now
+    k = 0;
+    listitem_t* prev = NULL;
+    LIST_ITER(elem, l.first) {
+        item_t* it = LISTITEM_AS(item_t, elem);
+        TEST_ASSERT(it == &to[k]);
+        TEST_ASSERT(it->x == order[k]);
+        TEST_ASSERT(moved[it->x] == it);
+        TEST_ASSERT(elem->prev == prev);
+        TEST_ASSERT(list_contains(&l, elem));
+        prev = elem;
+        k++;
+    }
+    TEST_ASSERT(k == n);
+    TEST_ASSERT(l.last == prev);
+
+    // the old pool can be reused, the list still works
+    list_pool_reset(&a);
+    memset(from, 0xff, n * sizeof(item_t));
+    TEST_ASSERT(LIST_SHIFT(item_t, &l)->x == order[0]);
+    TEST_ASSERT(LIST_POP(item_t, &l)->x == order[n - 1]);
+    list_unlink(&l, LISTITEM_OF(item_t, &to[50]));
+    TEST_ASSERT(list_length(&l) == (LIST_LENGTH_TYPE)n - 3);
+
+    // an empty list moves nothing
+    list_t empty;
+    list_init(&empty);
+    list_pool_reset(&b);
+    TEST_ASSERT(list_defragment(&empty, &b, NULL, NULL));
+    TEST_ASSERT(b.used == 0);
+    TEST_ASSERT(empty.first == NULL && empty.last == NULL);
+
+    free(from);
+    free(to);
+}
+
+void test_list_sort_parallel() {
+    int n = 100003;
+    sort_item_t* items = calloc(n, sizeof(sort_item_t));
+
+    // odd thread counts leave a run without partner in some merge rounds
+    size_t threads[] = {1, 2, 3, 4, 7, 8};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        list_t l;
+        list_init(&l);
+
+        srand(t);
+        for (int i = 0; i < n; i++) {
+            listitem_init(LISTITEM_OF(sort_item_t, &items[i]));
+            items[i].key = rand() % 1000;
+            items[i].order = i;
+            list_push(&l, LISTITEM_OF(sort_item_t, &items[i]));
+        }
+
+        list_sort_parallel(&l, cmp_sort_item, threads[t]);
+        check_sorted(&l, n);
+    }
+
+    // short lists are sorted by list_sort
+    list_t l;
+    list_init(&l);
+    for (int i = 0; i < 10; i++) {
+        listitem_init(LISTITEM_OF(sort_item_t, &items[i]));
+        items[i].key = 10 - i;
+        items[i].order = i;
+        list_push(&l, LISTITEM_OF(sort_item_t, &items[i]));
+    }
+    list_sort_parallel(&l, cmp_sort_item, 8);
+    check_sorted(&l, 10);
+
+    free(items);
+}
+
+void test_list_sort_parallel_skewed() {
+    int n = 50000;
+    sort_item_t* items = calloc(n, sizeof(sort_item_t));
+
+    // the merges are split inside long runs of equal keys or where one side of a merge is used up
+    size_t threads[] = {2, 3, 5, 8};
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        for (int pattern = 0; pattern < 4; pattern++) {
+            list_t l;
+            list_init(&l);
+            for (int i = 0; i < n; i++) {
+                listitem_init(LISTITEM_OF(sort_item_t, &items[i]));
+                int keys[] = {0, i % 2, n - i, i < n / 2 ? 1 : 0};
+                items[i].key = keys[pattern];
+                items[i].order = i;
+                list_push(&l, LISTITEM_OF(sort_item_t, &items[i]));
+            }
+
+            list_sort_parallel(&l, cmp_sort_item, threads[t]);
+            check_sorted(&l, n);
+        }
+    }
+
+    free(items);
+}
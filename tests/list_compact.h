@@ -0,0 +1,224 @@
+#include "acutest.h"
+
+#include "src/list.h"
+
+#include "tests/list_items.h"
+
+#define LIST_COMPACT_TESTS \
+    { "list compact item size", test_list_compact_item_size }, \
+    { "list compact in list", test_list_compact_in_list }, \
+    { "list compact contains", test_list_compact_contains }, \
+    { "list compact unlink", test_list_compact_unlink }, \
+    { "list compact insert before", test_list_compact_insert_before }, \
+    { "list compact pop shift", test_list_compact_pop_shift }, \
+    { "list compact remove index", test_list_compact_remove_index }, \
+    { "list compact sort", test_list_compact_sort }, \
+    { "list compact splice", test_list_compact_splice }, \
+    { "list compact move range", test_list_compact_move_range }, \
+    { "list compact defragment", test_list_compact_defragment }
+
+/**
+ * Check that the item is unlinked, which means it is linked to itself.
+ */
+void compact_check_unlinked(item_t* item) {
+    listitem_t* i = LISTITEM_OF(item_t, item);
+    TEST_ASSERT(!listitem_in_list(i));
+    TEST_ASSERT(i->next == i && i->prev == i);
+}
+
+void test_list_compact_item_size() {
+    TEST_ASSERT(sizeof(listitem_t) == 2 * sizeof(void*));
+    TEST_ASSERT(sizeof(item_t) <= 3 * sizeof(void*));
+}
+
+void test_list_compact_in_list() {
+    item_t items[2];
+    list_t l;
+    list_init(&l);
+
+    listitem_init(LISTITEM_OF(item_t, &items[0]));
+    listitem_init(LISTITEM_OF(item_t, &items[1]));
+    compact_check_unlinked(&items[0]);
+
+    // a single item and the ends of a list have NULL links but are in the list
+    list_push(&l, LISTITEM_OF(item_t, &items[0]));
+    TEST_ASSERT(listitem_in_list(LISTITEM_OF(item_t, &items[0])));
+    list_push(&l, LISTITEM_OF(item_t, &items[1]));
+    TEST_ASSERT(listitem_in_list(LISTITEM_OF(item_t, &items[0])));
+    TEST_ASSERT(listitem_in_list(LISTITEM_OF(item_t, &items[1])));
+}
+
+void test_list_compact_contains() {
+    item_t items[6];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+    push_items(&a, items, 0, 3);
+    push_items(&b, items, 3, 5);
+    listitem_init(LISTITEM_OF(item_t, &items[5]));
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT(list_contains(&a, LISTITEM_OF(item_t, &items[i])) == (i < 3));
+        TEST_ASSERT(list_contains(&b, LISTITEM_OF(item_t, &items[i])) == (i >= 3));
+    }
+    TEST_ASSERT(!list_contains(&a, LISTITEM_OF(item_t, &items[5])));
+}
+
+void test_list_compact_unlink() {
+    item_t items[4];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 4);
+
+    list_unlink(&l, LISTITEM_OF(item_t, &items[1]));
+    compact_check_unlinked(&items[1]);
+    check_chain(&l, (int[]){0, 2, 3}, 3);
+    list_unlink(&l, LISTITEM_OF(item_t, &items[0]));
+    list_unlink(&l, LISTITEM_OF(item_t, &items[3]));
+    check_chain(&l, (int[]){2}, 1);
+    list_unlink(&l, LISTITEM_OF(item_t, &items[2]));
+    check_chain(&l, NULL, 0);
+    for (int i = 0; i < 4; i++) {
+        compact_check_unlinked(&items[i]);
+    }
+
+    // unlinked items can be added again
+    list_push(&l, LISTITEM_OF(item_t, &items[3]));
+    check_chain(&l, (int[]){3}, 1);
+}
+
+void test_list_compact_insert_before() {
+    item_t items[4];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 2);
+    listitem_init(LISTITEM_OF(item_t, &items[2]));
+    listitem_init(LISTITEM_OF(item_t, &items[3]));
+    items[2].x = 2;
+    items[3].x = 3;
+
+    list_insert_before(&l, LISTITEM_OF(item_t, &items[0]), LISTITEM_OF(item_t, &items[2]));
+    list_insert_before(&l, NULL, LISTITEM_OF(item_t, &items[3]));
+    check_chain(&l, (int[]){2, 0, 1, 3}, 4);
+}
+
+void test_list_compact_pop_shift() {
+    item_t items[3];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 3);
+
+    TEST_ASSERT(LIST_POP(item_t, &l) == &items[2]);
+    TEST_ASSERT(LIST_SHIFT(item_t, &l) == &items[0]);
+    compact_check_unlinked(&items[0]);
+    compact_check_unlinked(&items[2]);
+    check_chain(&l, (int[]){1}, 1);
+    TEST_ASSERT(LIST_POP(item_t, &l) == &items[1]);
+    compact_check_unlinked(&items[1]);
+    TEST_ASSERT(LIST_POP(item_t, &l) == NULL);
+}
+
+void test_list_compact_remove_index() {
+    item_t items[5];
+    list_t l;
+    list_init(&l);
+    push_items(&l, items, 0, 5);
+
+    TEST_ASSERT(list_remove_index(&l, 3) == LISTITEM_OF(item_t, &items[3]));
+    compact_check_unlinked(&items[3]);
+    TEST_ASSERT(list_remove_index(&l, 4) == NULL);
+    check_chain(&l, (int[]){0, 1, 2, 4}, 4);
+}
+
+bool compact_item_before(listitem_t* i, listitem_t* j) {
+    return LISTITEM_AS(item_t, i)->x < LISTITEM_AS(item_t, j)->x;
+}
+
+void test_list_compact_sort() {
+    int n = 1000;
+    item_t* items = calloc(n, sizeof(item_t));
+    list_t l;
+    list_init(&l);
+    for (int i = 0; i < n; i++) {
+        listitem_init(LISTITEM_OF(item_t, &items[i]));
+        items[i].x = (i * 7919) % n;
+        list_push(&l, LISTITEM_OF(item_t, &items[i]));
+    }
+
+    list_sort(&l, compact_item_before);
+
+    int x = 0;
+    listitem_t* prev = NULL;
+    LIST_ITER(elem, l.first) {
+        TEST_ASSERT(LISTITEM_AS(item_t, elem)->x == x++);
+        TEST_ASSERT(elem->prev == prev);
+        prev = elem;
+    }
+    TEST_ASSERT(x == n);
+    TEST_ASSERT(l.last == prev);
+
+    free(items);
+}
+
+void test_list_compact_splice() {
+    item_t items[6];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+    push_items(&a, items, 0, 3);
+    push_items(&b, items, 3, 6);
+
+    list_splice(&a, LISTITEM_OF(item_t, &items[1]), &b);
+    check_chain(&a, (int[]){0, 3, 4, 5, 1, 2}, 6);
+    check_chain(&b, NULL, 0);
+
+    list_split_at(&a, LISTITEM_OF(item_t, &items[5]), &b);
+    check_chain(&a, (int[]){0, 3, 4}, 3);
+    check_chain(&b, (int[]){5, 1, 2}, 3);
+
+    // moved items are unlinked from the list they were moved to
+    list_unlink(&b, LISTITEM_OF(item_t, &items[1]));
+    check_chain(&b, (int[]){5, 2}, 2);
+    TEST_ASSERT(list_contains(&b, LISTITEM_OF(item_t, &items[5])));
+    TEST_ASSERT(!list_contains(&a, LISTITEM_OF(item_t, &items[5])));
+}
+
+void test_list_compact_move_range() {
+    item_t items[6];
+    list_t a, b;
+    list_init(&a);
+    list_init(&b);
+    push_items(&a, items, 0, 4);
+    push_items(&b, items, 4, 6);
+
+    list_move_range(&a, LISTITEM_OF(item_t, &items[1]), LISTITEM_OF(item_t, &items[2]), &b,
+                    LISTITEM_OF(item_t, &items[5]));
+    check_chain(&a, (int[]){0, 3}, 2);
+    check_chain(&b, (int[]){4, 1, 2, 5}, 4);
+
+    list_move_range(&b, LISTITEM_OF(item_t, &items[4]), LISTITEM_OF(item_t, &items[4]), &b, NULL);
+    check_chain(&b, (int[]){1, 2, 5, 4}, 4);
+}
+
+void test_list_compact_defragment() {
+    item_t from[8], to[8];
+    list_pool_t pool;
+    list_pool_init(&pool, to, 8, sizeof(item_t), LISTITEM_OFFSET(item_t));
+
+    list_t l;
+    list_init(&l);
+    for (int i = 7; i >= 0; i--) {
+        listitem_init(LISTITEM_OF(item_t, &from[i]));
+        from[i].x = 7 - i;
+        list_push(&l, LISTITEM_OF(item_t, &from[i]));
+    }
+
+    TEST_ASSERT(list_defragment(&l, &pool, NULL, NULL));
+    check_chain(&l, (int[]){0, 1, 2, 3, 4, 5, 6, 7}, 8);
+    int k = 0;
+    LIST_ITER(elem, l.first) { TEST_ASSERT(LISTITEM_AS(item_t, elem) == &to[k++]); }
+
+    list_unlink(&l, LISTITEM_OF(item_t, &to[0]));
+    list_unlink(&l, LISTITEM_OF(item_t, &to[7]));
+    check_chain(&l, (int[]){1, 2, 3, 4, 5, 6}, 6);
+}
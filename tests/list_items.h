@@ -0,0 +1,41 @@
+#include "acutest.h"
+
+#include "src/list.h"
+
+// list items and checks shared by the default and the LIST_COMPACT test binary
+
+typedef struct {
+    int x;
+      LISTITEM_PROP();
+} item_t;
+
+/**
+ * Check the forward and backward chain and the membership of a list of item_t against the expected x values.
+ */
+void check_chain(list_t* l, int* expected, LIST_LENGTH_TYPE length) {
+    TEST_ASSERT(list_length(l) == length);
+
+    LIST_LENGTH_TYPE index = 0;
+    listitem_t* prev = NULL;
+    LIST_ITER(elem, l->first) {
+        TEST_ASSERT(index < length);
+        TEST_ASSERT(LISTITEM_AS(item_t, elem)->x == expected[index]);
+        TEST_ASSERT(elem->prev == prev);
+        TEST_ASSERT(list_contains(l, elem));
+        prev = elem;
+        index++;
+    }
+    TEST_ASSERT(l->last == prev);
+    TEST_ASSERT(index == length);
+}
+
+/**
+ * Push the items from to to-1 with x set to their index.
+ */
+void push_items(list_t* l, item_t* items, int from, int to) {
+    for (int i = from; i < to; i++) {
+        listitem_init(LISTITEM_OF(item_t, &items[i]));
+        items[i].x = i;
+        list_push(l, LISTITEM_OF(item_t, &items[i]));
+    }
+}
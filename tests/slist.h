@@ -0,0 +1,121 @@
+#include "acutest.h"
+
+#include "src/slist.h"
+
+#define SLIST_TESTS \
+    { "slist item size", test_slist_item_size }, \
+    { "slist push pop", test_slist_push_pop }, \
+    { "slist append", test_slist_append }, \
+    { "slist splice all", test_slist_splice_all }, \
+    { "slist macros", test_slist_macros }
+
+typedef struct {
+    int x;
+    SLISTITEM_PROP();
+} slist_item_t;
+
+/**
+ * Check the chain, last and length of a list against the expected x values.
+ */
+void slist_check(slist_t* l, int* expected, SLIST_LENGTH_TYPE length) {
+    TEST_ASSERT(slist_length(l) == length);
+
+    SLIST_LENGTH_TYPE index = 0;
+    slistitem_t* last = NULL;
+    SLIST_ITER(elem, l->first) {
+        TEST_ASSERT(index < length);
+        TEST_ASSERT(SLISTITEM_AS(slist_item_t, elem)->x == expected[index]);
+        last = elem;
+        index++;
+    }
+    TEST_ASSERT(index == length);
+    TEST_ASSERT(l->last == last);
+}
+
+void slist_items(slist_item_t* items, int n) {
+    for (int i = 0; i < n; i++) {
+        items[i].x = i;
+        slistitem_init(SLISTITEM_OF(slist_item_t, &items[i]));
+    }
+}
+
+void test_slist_item_size() {
+    TEST_ASSERT(sizeof(slistitem_t) == sizeof(void*));
+}
+
+void test_slist_push_pop() {
+    slist_item_t items[3];
+    slist_items(items, 3);
+    slist_t l;
+    slist_init(&l);
+
+    TEST_ASSERT(slist_pop(&l) == NULL);
+    for (int i = 0; i < 3; i++) {
+        slist_push(&l, SLISTITEM_OF(slist_item_t, &items[i]));
+    }
+    slist_check(&l, (int[]){2, 1, 0}, 3);
+
+    TEST_ASSERT(slist_pop(&l) == SLISTITEM_OF(slist_item_t, &items[2]));
+    slist_check(&l, (int[]){1, 0}, 2);
+    TEST_ASSERT(slist_pop(&l) == SLISTITEM_OF(slist_item_t, &items[1]));
+    TEST_ASSERT(slist_pop(&l) == SLISTITEM_OF(slist_item_t, &items[0]));
+    TEST_ASSERT(slist_pop(&l) == NULL);
+    slist_check(&l, NULL, 0);
+}
+
+void test_slist_append() {
+    slist_item_t items[4];
+    slist_items(items, 4);
+    slist_t l;
+    slist_init(&l);
+
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[0]));
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[1]));
+    slist_push(&l, SLISTITEM_OF(slist_item_t, &items[2]));
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[3]));
+    slist_check(&l, (int[]){2, 0, 1, 3}, 4);
+
+    // fifo order with append and pop
+    TEST_ASSERT(slist_pop(&l) == SLISTITEM_OF(slist_item_t, &items[2]));
+    TEST_ASSERT(slist_pop(&l) == SLISTITEM_OF(slist_item_t, &items[0]));
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[2]));
+    slist_check(&l, (int[]){1, 3, 2}, 3);
+}
+
+void test_slist_splice_all() {
+    slist_item_t items[5];
+    slist_items(items, 5);
+    slist_t a, b;
+    slist_init(&a);
+    slist_init(&b);
+
+    // both empty, empty source, empty destination
+    slist_splice_all(&a, &b);
+    slist_check(&a, NULL, 0);
+    slist_append(&a, SLISTITEM_OF(slist_item_t, &items[0]));
+    slist_splice_all(&a, &b);
+    slist_check(&a, (int[]){0}, 1);
+    slist_splice_all(&b, &a);
+    slist_check(&b, (int[]){0}, 1);
+    slist_check(&a, NULL, 0);
+
+    for (int i = 1; i < 5; i++) {
+        slist_append(&a, SLISTITEM_OF(slist_item_t, &items[i]));
+    }
+    slist_splice_all(&b, &a);
+    slist_check(&b, (int[]){0, 1, 2, 3, 4}, 5);
+    slist_check(&a, NULL, 0);
+}
+
+void test_slist_macros() {
+    slist_item_t items[2];
+    slist_items(items, 2);
+    slist_t l;
+    slist_init(&l);
+
+    TEST_ASSERT(SLIST_POP(slist_item_t, &l) == NULL);
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[0]));
+    slist_append(&l, SLISTITEM_OF(slist_item_t, &items[1]));
+    TEST_ASSERT(SLIST_POP(slist_item_t, &l) == &items[0]);
+    TEST_ASSERT(SLIST_POP(slist_item_t, &l) == &items[1]);
+}
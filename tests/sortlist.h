@@ -0,0 +1,211 @@
+#include "acutest.h"
+
+#include "src/sortlist.h"
+
+#define SORTLIST_TESTS \
+    { "sortlist insert", test_sortlist_insert }, \
+    { "sortlist duplicates", test_sortlist_duplicates }, \
+    { "sortlist remove", test_sortlist_remove }, \
+    { "sortlist shift pop", test_sortlist_shift_pop }, \
+    { "sortlist seek", test_sortlist_seek }, \
+    { "sortlist destroy", test_sortlist_destroy }
+
+typedef struct {
+    int key;
+    int order;
+    LISTITEM_PROP();
+} sortlist_item_t;
+
+bool sortlist_item_before(listitem_t* i, listitem_t* j) {
+    return LISTITEM_AS(sortlist_item_t, i)->key < LISTITEM_AS(sortlist_item_t, j)->key;
+}
+
+/**
+ * Check that the chain is sorted and stable and every index level is an ordered subsequence of the level below.
+ */
+void sortlist_check(sortlist_t* sl, LIST_LENGTH_TYPE length) {
+    TEST_ASSERT(sortlist_length(sl) == length);
+
+    LIST_LENGTH_TYPE count = 0;
+    listitem_t* prev = NULL;
+    LIST_ITER(elem, sl->list.first) {
+        TEST_ASSERT(elem->prev == prev);
+        if (prev != NULL) {
+            sortlist_item_t* a = LISTITEM_AS(sortlist_item_t, prev);
+            sortlist_item_t* b = LISTITEM_AS(sortlist_item_t, elem);
+            TEST_ASSERT(a->key < b->key || (a->key == b->key && a->order < b->order));
+        }
+        prev = elem;
+        count++;
+    }
+    TEST_ASSERT(sl->list.last == prev);
+    TEST_ASSERT(count == length);
+
+    size_t nodes = 0;
+    for (size_t level = 0; level < sl->levels; level++) {
+        TEST_ASSERT(sl->heads[level] != NULL);
+        listitem_t* elem = sl->list.first;
+        for (sortlist_index_t* n = sl->heads[level]; n != NULL; n = n->next) {
+            TEST_ASSERT(level == 0 || (n->down != NULL && n->down->item == n->item));
+            // the item must come later in the chain than the item of the previous node
+            while (elem != NULL && elem != n->item) {
+                elem = elem->next;
+            }
+            TEST_ASSERT(elem == n->item);
+            elem = elem->next;
+            nodes++;
+        }
+    }
+    for (size_t level = sl->levels; level < SORTLIST_MAX_LEVEL; level++) {
+        TEST_ASSERT(sl->heads[level] == NULL);
+    }
+    TEST_ASSERT(sortlist_stats_index_nodes(sl) == nodes);
+}
+
+void test_sortlist_insert() {
+    int n = 10000;
+    sortlist_item_t* items = calloc(n, sizeof(sortlist_item_t));
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        items[i].key = rand();
+        items[i].order = i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+    sortlist_check(&sl, n);
+
+    // about a third of the items are indexed over all levels
+    TEST_ASSERT(sortlist_stats_index_nodes(&sl) > (size_t)n / 4);
+    TEST_ASSERT(sortlist_stats_index_nodes(&sl) < (size_t)n / 2);
+    TEST_MSG("index nodes: %zu", sortlist_stats_index_nodes(&sl));
+
+    sortlist_destroy(&sl);
+    free(items);
+}
+
+void test_sortlist_duplicates() {
+    int n = 5000;
+    sortlist_item_t* items = calloc(n, sizeof(sortlist_item_t));
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    for (int i = 0; i < n; i++) {
+        items[i].key = (i * 7919) % 10;
+        items[i].order = i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+    sortlist_check(&sl, n);
+
+    // remove every third item, including indexed items in the middle of equal runs
+    for (int i = 0; i < n; i += 3) {
+        sortlist_remove(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+        TEST_ASSERT(!listitem_in_list(LISTITEM_OF(sortlist_item_t, &items[i])));
+    }
+    sortlist_check(&sl, n - (n + 2) / 3);
+
+    sortlist_destroy(&sl);
+    free(items);
+}
+
+void test_sortlist_remove() {
+    int n = 10000;
+    sortlist_item_t* items = calloc(n, sizeof(sortlist_item_t));
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    srand(2);
+    for (int i = 0; i < n; i++) {
+        items[i].key = rand() % 1000;
+        items[i].order = i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+
+    for (int i = 1; i < n; i += 2) {
+        sortlist_remove(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+    sortlist_check(&sl, n / 2);
+
+    for (int i = 0; i < n; i += 2) {
+        sortlist_remove(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+    sortlist_check(&sl, 0);
+    TEST_ASSERT(sl.levels == 0);
+    TEST_ASSERT(sl.list.first == NULL);
+
+    sortlist_destroy(&sl);
+    free(items);
+}
+
+void test_sortlist_shift_pop() {
+    int n = 1000;
+    sortlist_item_t* items = calloc(n, sizeof(sortlist_item_t));
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    TEST_ASSERT(sortlist_shift(&sl) == NULL);
+    TEST_ASSERT(sortlist_pop(&sl) == NULL);
+
+    for (int i = 0; i < n; i++) {
+        items[i].key = n - 1 - i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+
+    for (int i = 0; i < n / 2; i++) {
+        TEST_ASSERT(LISTITEM_AS(sortlist_item_t, sortlist_shift(&sl))->key == i);
+        TEST_ASSERT(LISTITEM_AS(sortlist_item_t, sortlist_pop(&sl))->key == n - 1 - i);
+    }
+    sortlist_check(&sl, 0);
+
+    sortlist_destroy(&sl);
+    free(items);
+}
+
+void test_sortlist_seek() {
+    int n = 1000;
+    sortlist_item_t* items = calloc(n, sizeof(sortlist_item_t));
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    // even keys only
+    for (int i = 0; i < n; i++) {
+        items[i].key = 2 * i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+
+    sortlist_item_t key = {0};
+    for (int k = -1; k < 2 * n - 1; k++) {
+        key.key = k;
+        listitem_t* found = sortlist_seek(&sl, LISTITEM_OF(sortlist_item_t, &key));
+        TEST_ASSERT(found != NULL);
+        TEST_ASSERT(LISTITEM_AS(sortlist_item_t, found)->key == (k < 0 ? 0 : (k + 1) / 2 * 2));
+    }
+    key.key = 2 * n;
+    TEST_ASSERT(sortlist_seek(&sl, LISTITEM_OF(sortlist_item_t, &key)) == NULL);
+
+    sortlist_destroy(&sl);
+    free(items);
+}
+
+void test_sortlist_destroy() {
+    sortlist_item_t items[100] = {0};
+    sortlist_t sl;
+    sortlist_init(&sl, sortlist_item_before);
+
+    for (int i = 0; i < 100; i++) {
+        items[i].key = i;
+        listitem_init(LISTITEM_OF(sortlist_item_t, &items[i]));
+        sortlist_insert(&sl, LISTITEM_OF(sortlist_item_t, &items[i]));
+    }
+    sortlist_destroy(&sl);
+
+    TEST_ASSERT(sl.list.first == NULL);
+    TEST_ASSERT(sl.levels == 0);
+    TEST_ASSERT(sortlist_stats_index_nodes(&sl) == 0);
+}